@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef CHIP8_HAS_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+#include "Audio.h"
+
+namespace {
+// Constants
+constexpr double kBeepFrequency = 440.0;
+constexpr int16_t kAmplitude = 8000;
+
+// How long the audio thread waits for the emulator to fill a period before
+// padding it with silence
+constexpr auto kUnderrunGrace = std::chrono::milliseconds(2);
+
+// Functions
+void writeLittleEndian(std::ofstream &file, uint32_t value, size_t bytes);
+
+#ifdef CHIP8_HAS_ALSA
+// Latency requested from the device buffer, in microseconds
+constexpr unsigned int kAlsaLatency = 8000;
+
+class AlsaAudioSink : public AudioSink {
+public:
+  AlsaAudioSink() {
+    if (snd_pcm_open(&this->pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0) {
+      throw std::runtime_error("Unable to open the ALSA device.");
+    }
+
+    if (snd_pcm_set_params(this->pcm, SND_PCM_FORMAT_S16,
+                           SND_PCM_ACCESS_RW_INTERLEAVED, 1, Audio::kSampleRate,
+                           1, kAlsaLatency) < 0) {
+      snd_pcm_close(this->pcm);
+      throw std::runtime_error("Unable to configure the ALSA device.");
+    }
+  }
+
+  ~AlsaAudioSink() override {
+    snd_pcm_drain(this->pcm);
+    snd_pcm_close(this->pcm);
+  }
+
+  void Write(const int16_t *samples, size_t count) override {
+    while (count > 0) {
+      auto written = snd_pcm_writei(this->pcm, samples, count);
+      if (written < 0) {
+        // Recover from underruns and suspends; give up on anything else
+        if (snd_pcm_recover(this->pcm, static_cast<int>(written), 1) < 0) {
+          return;
+        }
+
+        continue;
+      }
+
+      samples += written;
+      count -= static_cast<size_t>(written);
+    }
+  }
+
+  [[nodiscard]] bool IsRealTime() const override { return true; }
+
+private:
+  snd_pcm_t *pcm = nullptr;
+};
+#endif
+} // namespace
+
+WavAudioSink::WavAudioSink(const std::string &path)
+    : file(path, std::ios::binary) {
+  if (!this->file) {
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  // The sizes are patched in when the sink is destroyed
+  this->writeHeader();
+}
+
+WavAudioSink::~WavAudioSink() {
+  this->file.seekp(0, std::ios::beg);
+  this->writeHeader();
+}
+
+void WavAudioSink::Write(const int16_t *samples, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    writeLittleEndian(this->file, static_cast<uint16_t>(samples[i]), 2);
+  }
+
+  this->sampleCount += static_cast<uint32_t>(count);
+}
+
+void WavAudioSink::writeHeader() {
+  const uint32_t dataSize = this->sampleCount * 2;
+
+  this->file.write("RIFF", 4);
+  writeLittleEndian(this->file, 36 + dataSize, 4);
+  this->file.write("WAVE", 4);
+
+  // Format chunk: PCM, mono, 16 bits per sample
+  this->file.write("fmt ", 4);
+  writeLittleEndian(this->file, 16, 4);
+  writeLittleEndian(this->file, 1, 2);
+  writeLittleEndian(this->file, 1, 2);
+  writeLittleEndian(this->file, Audio::kSampleRate, 4);
+  writeLittleEndian(this->file, Audio::kSampleRate * 2, 4);
+  writeLittleEndian(this->file, 2, 2);
+  writeLittleEndian(this->file, 16, 2);
+
+  this->file.write("data", 4);
+  writeLittleEndian(this->file, dataSize, 4);
+}
+
+std::unique_ptr<AudioSink> CreateLiveAudioSink() {
+#ifdef CHIP8_HAS_ALSA
+  return std::make_unique<AlsaAudioSink>();
+#else
+  throw std::runtime_error("No live audio backend is available.");
+#endif
+}
+
+bool HasLiveAudioSink() {
+#ifdef CHIP8_HAS_ALSA
+  return true;
+#else
+  return false;
+#endif
+}
+
+AudioOutput::AudioOutput(std::unique_ptr<AudioSink> sink)
+    : sink(std::move(sink)), realTime(this->sink->IsRealTime()) {
+  this->thread = std::thread(&AudioOutput::drain, this);
+}
+
+AudioOutput::~AudioOutput() {
+  this->running.store(false, std::memory_order_relaxed);
+  this->thread.join();
+}
+
+void AudioOutput::Push(const int16_t *samples, size_t count) {
+  auto pushed = this->ring.Push(samples, count);
+  while (!this->realTime && pushed < count) {
+    std::this_thread::yield();
+    pushed += this->ring.Push(samples + pushed, count - pushed);
+  }
+}
+
+void AudioOutput::drain() {
+  std::array<int16_t, Audio::kPeriodSize> period;
+
+  while (this->running.load(std::memory_order_relaxed)) {
+    auto count = this->ring.Pop(period.data(), period.size());
+
+    if (count < period.size() && this->realTime) {
+      // Give the emulator a moment to catch up before the device underruns,
+      // then fill the rest of the period with silence
+      const auto deadline = std::chrono::steady_clock::now() + kUnderrunGrace;
+      while (count < period.size() &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(250));
+        count += this->ring.Pop(&period[count], period.size() - count);
+      }
+
+      std::fill(period.begin() + count, period.end(), 0);
+      count = period.size();
+    }
+
+    if (count == 0) {
+      // Nothing to do for a non-real-time sink
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    this->sink->Write(period.data(), count);
+  }
+
+  // Flush whatever is left so that recordings are complete
+  size_t count;
+  while ((count = this->ring.Pop(period.data(), period.size())) > 0) {
+    this->sink->Write(period.data(), count);
+  }
+}
+
+void ToneGenerator::Generate(int16_t *samples, size_t count,
+                             const Chip8State &state) {
+  if (state.soundTimer == 0) {
+    std::memset(samples, 0, count * sizeof(int16_t));
+    return;
+  }
+
+  // Start the pattern from its first bit
+  if (state.audioPatternLoaded != this->patternMode) {
+    this->patternMode = state.audioPatternLoaded;
+    this->phase = 0.0;
+  }
+
+  if (!this->patternMode) {
+    // Square wave beep
+    const auto step = kBeepFrequency / Audio::kSampleRate;
+    for (size_t i = 0; i < count; i++) {
+      samples[i] = (this->phase < 0.5) ? kAmplitude : -kAmplitude;
+      this->phase = std::fmod(this->phase + step, 1.0);
+    }
+
+    return;
+  }
+
+  // 128-bit pattern, most significant bit of the first byte first
+  const auto rate = 4000.0 * std::pow(2.0, (state.audioPitch - 64) / 48.0);
+  const auto step = rate / Audio::kSampleRate;
+  for (size_t i = 0; i < count; i++) {
+    const auto bit = static_cast<size_t>(this->phase);
+    const auto on =
+        (state.audioPattern.at(bit / 8) & (0x80 >> (bit % 8))) != 0;
+
+    samples[i] = on ? kAmplitude : -kAmplitude;
+    this->phase = std::fmod(this->phase + step, 128.0);
+  }
+}
+
+namespace {
+void writeLittleEndian(std::ofstream &file, uint32_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    file.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+  }
+}
+} // namespace
@@ -0,0 +1,104 @@
+#ifndef AUDIO_H_INCLUDED
+#define AUDIO_H_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Chip8State.h"
+#include "RingBuffer.h"
+
+namespace Audio {
+// All audio is 16-bit signed mono at this rate
+constexpr uint32_t kSampleRate = 48000;
+
+// Samples handed to a sink at once (~2.7 ms)
+constexpr size_t kPeriodSize = 128;
+
+// Samples that may be queued between the emulator and the sink (~10.7 ms)
+// Together with the device buffer of the live sink, this keeps the total
+// latency under 20 ms
+constexpr size_t kRingSize = 512;
+} // namespace Audio
+
+// Destination for generated samples
+// Write() is only ever called from the audio thread
+class AudioSink {
+public:
+  virtual ~AudioSink() = default;
+
+  virtual void Write(const int16_t *samples, size_t count) = 0;
+
+  // Real-time sinks are fed silence when the emulator falls behind
+  [[nodiscard]] virtual bool IsRealTime() const { return false; }
+};
+
+// Discards all samples (for machines without sound hardware)
+class NullAudioSink : public AudioSink {
+public:
+  void Write(const int16_t *, size_t) override {}
+};
+
+// Records all samples to a 16-bit PCM WAV file
+class WavAudioSink : public AudioSink {
+public:
+  explicit WavAudioSink(const std::string &path);
+  ~WavAudioSink() override;
+
+  void Write(const int16_t *samples, size_t count) override;
+
+private:
+  void writeHeader();
+
+private:
+  std::ofstream file;
+  uint32_t sampleCount = 0;
+};
+
+// Creates the sink for the platform's sound device
+// Throws if no live backend was compiled in
+std::unique_ptr<AudioSink> CreateLiveAudioSink();
+[[nodiscard]] bool HasLiveAudioSink();
+
+// Owns the sink and the thread that drains the ring buffer into it
+class AudioOutput {
+public:
+  explicit AudioOutput(std::unique_ptr<AudioSink> sink);
+  ~AudioOutput();
+
+  AudioOutput(const AudioOutput &) = delete;
+  AudioOutput &operator=(const AudioOutput &) = delete;
+
+  // Called from the emulator thread; for a real-time sink, samples that don't
+  // fit are dropped so that latency stays bounded, otherwise it waits for the
+  // sink so that recordings have no gaps
+  void Push(const int16_t *samples, size_t count);
+
+private:
+  void drain();
+
+private:
+  std::unique_ptr<AudioSink> sink;
+  bool realTime;
+  RingBuffer<int16_t, Audio::kRingSize> ring;
+  std::atomic<bool> running{true};
+  std::thread thread;
+};
+
+// Generates the sound while the sound timer is active: a square beep
+// (CHIP-8), or the 1-bit pattern loaded by F002 (XO-CHIP) played back at
+// 4000 * 2^((pitch - 64) / 48) bits per second (FX3A)
+class ToneGenerator {
+public:
+  void Generate(int16_t *samples, size_t count, const Chip8State &state);
+
+private:
+  bool patternMode = false;
+  double phase = 0.0;
+};
+
+#endif // AUDIO_H_INCLUDED
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <vector>
+
+#include "BoundsAnalysis.h"
+#include "Opcodes.h"
+
+namespace {
+// Local types
+struct Context {
+  BoundsAnalysis &analysis;
+  std::vector<uint16_t> worklist = {};
+
+  // Times the range at each instruction, and at returns, has grown
+  std::array<uint8_t, Memory::kSize> widenings = {};
+  uint8_t returnWidenings = 0;
+
+  // Values of I at the returns reached so far
+  bool returnReached = false;
+  BoundsAnalysis::Range returned = {};
+
+  // Control flow that can't be followed
+  bool outside = false;
+  bool indirect = false;
+};
+
+// Constants
+// A range that grows more often than this (I incremented in a loop) is
+// widened to every value
+constexpr uint8_t kWideningLimit = 8;
+constexpr BoundsAnalysis::Range kAnyValue = {0, 0xFFFF};
+
+// Functions
+void step(Context &context, uint16_t address);
+void flow(Context &context, size_t address, BoundsAnalysis::Range range);
+void returnTo(Context &context, size_t address);
+void join(BoundsAnalysis::Range &range, BoundsAnalysis::Range other,
+          uint8_t &widenings, bool &changed);
+bool checkAccesses(const BoundsAnalysis &analysis);
+} // namespace
+
+BoundsAnalysis BoundsAnalysis::Analyze(const Chip8State &state) {
+  BoundsAnalysis analysis;
+  analysis.memory = state.memory;
+
+  Context context{analysis};
+  context.worklist.reserve(Memory::kSize);
+  for (size_t i = 0; i < std::min<size_t>(state.SP, state.stack.size());
+       i++) {
+    returnTo(context, state.stack[i]);
+  }
+
+  flow(context, state.PC, {state.I, state.I});
+  while (!context.worklist.empty()) {
+    const auto address = context.worklist.back();
+    context.worklist.pop_back();
+    step(context, address);
+  }
+
+  for (size_t address = 0; address < Memory::kSize - 1; address++) {
+    if (analysis.instructions.test(address)) {
+      analysis.code.set(address);
+      analysis.code.set(address + 1);
+    }
+  }
+
+  analysis.proven =
+      !context.outside && !context.indirect && checkAccesses(analysis);
+  return analysis;
+}
+
+bool BoundsAnalysis::MatchesCode(const Memory &memory) const {
+  for (size_t page = 0; page < Memory::kPageCount; page++) {
+    if (memory.SharesPage(this->memory, page)) {
+      continue;
+    }
+
+    for (auto address = page * Memory::kPageSize;
+         address < (page + 1) * Memory::kPageSize; address++) {
+      if (this->code.test(address) &&
+          memory[address] != this->memory[address]) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool BoundsAnalysis::Covers(const Chip8State &state) const {
+  if (state.PC >= Memory::kSize || !this->instructions.test(state.PC) ||
+      state.I < this->ranges[state.PC].low ||
+      state.I > this->ranges[state.PC].high ||
+      state.SP > state.stack.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < state.SP; i++) {
+    if (state.stack[i] >= Memory::kSize ||
+        !this->returns.test(state.stack[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+namespace {
+void step(Context &context, uint16_t address) {
+  const auto opcode = context.analysis.memory.ReadWord(address);
+  const auto range = context.analysis.ranges[address];
+  const size_t next = address + 2;
+  const uint16_t target = opcode & 0x0FFF;
+
+  switch (Opcodes::Classify(opcode)) {
+  case Opcodes::k00EE: {
+    bool changed = !context.returnReached;
+    if (changed) {
+      context.returnReached = true;
+      context.returned = range;
+    } else {
+      join(context.returned, range, context.returnWidenings, changed);
+    }
+
+    for (size_t i = 0; changed && i < Memory::kSize; i++) {
+      if (context.analysis.returns.test(i)) {
+        flow(context, i, context.returned);
+      }
+    }
+  } break;
+
+  case Opcodes::k1NNN:
+    flow(context, target, range);
+    break;
+
+  case Opcodes::k2NNN:
+    returnTo(context, next);
+    flow(context, target, range);
+    break;
+
+  case Opcodes::k3XNN:
+  case Opcodes::k4XNN:
+  case Opcodes::k5XY0:
+  case Opcodes::k9XY0:
+  case Opcodes::kEX9E:
+  case Opcodes::kEXA1:
+    flow(context, next, range);
+    flow(context, next + 2, range);
+    break;
+
+  case Opcodes::kANNN:
+    flow(context, next, {target, target});
+    break;
+
+  case Opcodes::kBNNN:
+    // V0 could take the jump anywhere in 256 bytes
+    context.indirect = true;
+    break;
+
+  case Opcodes::kFX1E: {
+    // I is 16 bits, so it may wrap around
+    const size_t high = range.high + 0xFF;
+    flow(context, next,
+         (high <= 0xFFFF)
+             ? BoundsAnalysis::Range{range.low, static_cast<uint16_t>(high)}
+             : kAnyValue);
+  } break;
+
+  case Opcodes::kFX29:
+    flow(context, next, {0, 0xFF * 5});
+    break;
+
+  case Opcodes::kInvalid:
+    // Faults; the machine invalidates the backend if it skips the
+    // instruction
+    break;
+
+  default:
+    flow(context, next, range);
+    break;
+  }
+}
+
+void flow(Context &context, size_t address, BoundsAnalysis::Range range) {
+  if (address >= Memory::kSize - 1) {
+    context.outside = true;
+    return;
+  }
+
+  auto &analysis = context.analysis;
+  bool changed = !analysis.instructions.test(address);
+  if (changed) {
+    analysis.instructions.set(address);
+    analysis.ranges[address] = range;
+  } else {
+    join(analysis.ranges[address], range, context.widenings[address],
+         changed);
+  }
+
+  if (changed) {
+    context.worklist.push_back(static_cast<uint16_t>(address));
+  }
+}
+
+void returnTo(Context &context, size_t address) {
+  if (address >= Memory::kSize - 1) {
+    context.outside = true;
+    return;
+  }
+
+  if (!context.analysis.returns.test(address)) {
+    context.analysis.returns.set(address);
+    if (context.returnReached) {
+      flow(context, address, context.returned);
+    }
+  }
+}
+
+void join(BoundsAnalysis::Range &range, BoundsAnalysis::Range other,
+          uint8_t &widenings, bool &changed) {
+  const BoundsAnalysis::Range joined = {std::min(range.low, other.low),
+                                        std::max(range.high, other.high)};
+  if (joined.low == range.low && joined.high == range.high) {
+    return;
+  }
+
+  changed = true;
+  range = (++widenings > kWideningLimit) ? kAnyValue : joined;
+}
+
+bool checkAccesses(const BoundsAnalysis &analysis) {
+  for (size_t address = 0; address < Memory::kSize - 1; address++) {
+    if (!analysis.instructions.test(address)) {
+      continue;
+    }
+
+    const auto opcode = analysis.memory.ReadWord(address);
+    switch (Opcodes::Classify(opcode)) {
+    case Opcodes::kDXYN:
+    case Opcodes::kF002:
+    case Opcodes::kFX33:
+    case Opcodes::kFX55:
+    case Opcodes::kFX65:
+      break;
+
+    default:
+      continue;
+    }
+
+    const auto &range = analysis.ranges[address];
+    const auto access = Opcodes::GetMemoryAccess(opcode, range.high);
+    const size_t end = range.high + access.size;
+    if (end > Memory::kSize) {
+      return false;
+    }
+
+    for (size_t target = range.low; access.write && target < end; target++) {
+      if (analysis.code.test(target)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+} // namespace
@@ -0,0 +1,54 @@
+#ifndef BOUNDS_ANALYSIS_H_INCLUDED
+#define BOUNDS_ANALYSIS_H_INCLUDED
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+#include "Chip8State.h"
+#include "Memory.h"
+
+// A proof that the interpreter's range checks can't fail from a state on, so
+// that it can run without them (Interpreter::ExecuteUnchecked)
+//
+// Abstract interpretation over the interpreter's control flow: the range of I
+// is tracked at each instruction reached, the V registers may hold anything,
+// returns (00EE) may go to any call site, and a faulting instruction may be
+// skipped (TrapPolicy::kIgnore). It is proven if every instruction reached is
+// in memory, every access at I is in range, no write can reach the code, and
+// there is no BNNN jump.
+struct BoundsAnalysis {
+  // Inclusive
+  struct Range {
+    uint16_t low = 0;
+    uint16_t high = 0;
+  };
+
+  bool proven = false;
+
+  // The first byte of each instruction reached, and every byte of them
+  std::bitset<Memory::kSize> instructions;
+  std::bitset<Memory::kSize> code;
+
+  // Addresses after each call reached, and on the stack at the start
+  std::bitset<Memory::kSize> returns;
+
+  // Values of I at each instruction reached
+  std::array<Range, Memory::kSize> ranges = {};
+
+  // The memory the code was read from, which shares its pages with the
+  // states it's compared with as long as they aren't written to
+  Memory memory;
+
+  [[nodiscard]] static BoundsAnalysis Analyze(const Chip8State &state);
+
+  // Whether the code in the memory is still the analyzed one
+  [[nodiscard]] bool MatchesCode(const Memory &memory) const;
+
+  // Whether the proof holds for the state, if its code matches: the PC is at
+  // an instruction reached, with I in its range, and the stack holds only
+  // return addresses
+  [[nodiscard]] bool Covers(const Chip8State &state) const;
+};
+
+#endif // BOUNDS_ANALYSIS_H_INCLUDED
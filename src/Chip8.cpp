@@ -1,14 +1,13 @@
+#include <algorithm>
 #include <array>
-#include <cmath>
 #include <cstdint>
-#include <cstdlib>
-#include <cstring>
 #include <ctime>
-#include <fstream>
-#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "Chip8.h"
+#include "Interpreter.h"
 #include "Util.h"
 
 namespace {
@@ -21,546 +20,398 @@ constexpr std::array<uint8_t, 80> kInternalFont = {
     0x10, 0xF0, 0xF0, 0x90, 0xF0, 0x90, 0x90, 0xE0, 0x90, 0xE0, 0x90, 0xE0,
     0xF0, 0x80, 0x80, 0x80, 0xF0, 0xE0, 0x90, 0x90, 0x90, 0xE0, 0xF0, 0x80,
     0xF0, 0x80, 0xF0, 0xF0, 0x80, 0xF0, 0x80, 0x80};
-
-constexpr std::array<int, 16> kKeyMap = {
-    GLFW_KEY_X, GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_3, GLFW_KEY_Q, GLFW_KEY_W,
-    GLFW_KEY_E, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_Y, GLFW_KEY_C,
-    GLFW_KEY_4, GLFW_KEY_R, GLFW_KEY_F, GLFW_KEY_V};
-
-// Functions
-GLuint compileShader(const std::string &path, GLenum type);
-GLuint linkShader(GLuint vertexShader, GLuint fragmentShader);
 } // namespace
 
-Chip8::Chip8() {
+Chip8::Chip8() : backend(std::make_unique<VerifiedBackend>()) {
   // Copy the font to memory
-  std::memcpy(&this->memory[0], kInternalFont.data(), kInternalFont.size());
-
-  // Seed the random number generator
-  // Ideally, the RNG from the STL would be better here
-  srand(static_cast<unsigned int>(time(nullptr)));
-}
-
-Chip8::~Chip8() {
-  if (this->EBO != static_cast<GLuint>(-1)) {
-    glDeleteBuffers(1, &this->EBO);
-  }
+  // All machines share the font page until they write to it
+  static const auto fontMemory = [] {
+    Memory memory;
+    memory.Write(0, kInternalFont.data(), kInternalFont.size());
+    return memory;
+  }();
 
-  if (this->VBO != static_cast<GLuint>(-1)) {
-    glDeleteBuffers(1, &this->VBO);
-  }
-
-  if (this->VAO != static_cast<GLuint>(-1)) {
-    glDeleteVertexArrays(1, &this->VAO);
-  }
+  this->state.memory = fontMemory;
+  this->loadedState = this->state;
 
-  if (this->shader != static_cast<GLuint>(-1)) {
-    glDeleteProgram(this->shader);
-  }
-}
-
-void Chip8::InitializeGraphics() {
-  const auto vertexShader =
-      compileShader("assets/shaders/Default.vs", GL_VERTEX_SHADER);
-  const auto fragmentShader =
-      compileShader("assets/shaders/Default.fs", GL_FRAGMENT_SHADER);
-
-  this->shader = linkShader(vertexShader, fragmentShader);
-
-  constexpr std::array<float, 6 * 5> vertices = {
-      // Top left
-      -1.f,
-      1.f,
-      0.0f,
-      0.f,
-      0.f,
-      // Bottom left
-      -1.f,
-      -1.f,
-      0.0f,
-      0.f,
-      1.f,
-      // Bottom Right
-      1.0f,
-      -1.f,
-      0.0f,
-      1.f,
-      1.f,
-      // Top left
-      -1.f,
-      1.f,
-      0.0f,
-      0.f,
-      0.f,
-      // Bottom Right
-      1.0f,
-      -1.f,
-      0.0f,
-      1.f,
-      1.f,
-      // Top Right
-      1.0f,
-      1.f,
-      0.0f,
-      1.f,
-      0.f,
-  };
-
-  glGenVertexArrays(1, &this->VAO);
-  glGenBuffers(1, &this->VBO);
-  // bind the Vertex Array Object first, then bind and set vertex buffer(s), and
-  // then configure vertex attributes(s).
-  glBindVertexArray(this->VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(),
-               GL_STATIC_DRAW);
-
-  // Position attribute (x, y, z)
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-                        (void *)nullptr);
-  glEnableVertexAttribArray(0);
-
-  // Texture coordinates attribute (u, v)
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-                        (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
-
-  glGenTextures(1, &this->texture);
-  glBindTexture(GL_TEXTURE_2D, this->texture);
-
-  // Wrapping parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  // Filtering parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 32, 0, GL_RGB, GL_UNSIGNED_BYTE,
-               this->pixelBuffer.data());
+  // Seed the random number generator
+  // Use SetRandomSeed() for reproducible runs
+  this->SetRandomSeed(static_cast<uint32_t>(time(nullptr)));
 }
 
 void Chip8::LoadRom(const std::string &romPath) {
   // Read the ROM file into memory at 0x200
-  auto fileData = Util::FileReadBinary(romPath);
-  if (fileData.size() > this->memory.size() - 0x200) {
+  const auto fileData = Util::FileReadBinary(romPath);
+  this->LoadRom(fileData.data(), fileData.size());
+}
+
+void Chip8::LoadRom(const uint8_t *data, size_t size) {
+  if (size > this->state.memory.size() - 0x200) {
     throw std::runtime_error("The ROM is too large.");
   }
 
-  std::memcpy(&this->memory[0x200], &fileData[0], fileData.size());
+  this->state.memory.Write(0x200, data, size);
+  this->loadedState = this->state;
+  this->lastTrap = {};
+  this->halted = false;
+  this->backend->Invalidate();
 }
 
-void Chip8::SetCpuRate(uint16_t instructionsPerSecond) {
-  this->updateRate = instructionsPerSecond;
-  this->updateTime = 1.f / this->updateRate;
+void Chip8::Reset() {
+  this->state.Restore(this->loadedState);
+  this->keyEvents.clear();
+  this->updateAccumulator = 0.f;
+  this->lastTrap = {};
+  this->halted = false;
+  this->backend->Invalidate();
 }
 
-void Chip8::Update(GLFWwindow *window, float deltaTime) {
-  // Close the window if the ESC key is pressed
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
-  }
-
-  if (glfwGetKey(window, GLFW_KEY_PAGE_UP) == GLFW_PRESS) {
-    if (this->updateRate < std::numeric_limits<uint16_t>::max()) {
-      this->SetCpuRate(this->updateRate + 1);
-    }
-  }
+void Chip8::SetCpuRate(uint16_t instructionsPerSecond) {
+  this->updateRate = std::max<uint16_t>(instructionsPerSecond, 1);
+  this->updateTime = 1.f / this->updateRate;
 
-  if (glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS) {
-    if (this->updateRate > 0) {
-      this->SetCpuRate(this->updateRate - 1);
-    }
-  }
+  // Keep the position between two timer ticks within the new period
+  this->state.timerPhase %= this->updateRate;
 
-  for (size_t i = 0; i < 16; i++) {
-    this->keys.at(i) = (glfwGetKey(window, kKeyMap[i]) == GLFW_PRESS);
+  if (this->movieRecorder != nullptr) {
+    this->movieRecorder->RecordCpuRate(this->state.cycles, this->updateRate);
   }
+}
 
-  this->delayTimerAccumulator += deltaTime;
-  while (this->delayTimerAccumulator >= 0.f) {
-    if (this->delayTimer != 0) {
-      --this->delayTimer;
-    }
+uint16_t Chip8::GetCpuRate() const { return this->updateRate; }
 
-    this->delayTimerAccumulator -= 1.f / 60.f;
-  }
+void Chip8::SetRandomSeed(uint32_t seed) {
+  // xorshift32 gets stuck at 0
+  this->state.randomState = (seed != 0) ? seed : 1;
+  this->loadedState.randomState = this->state.randomState;
+}
 
-  // Execute CPU instructions at a constant rate
-  this->updateAccumulator += deltaTime;
-  while (this->updateAccumulator >= 0.f) {
-    this->executeOneInstruction();
-    this->updateAccumulator -= this->updateTime;
-  }
+void Chip8::SetCpuBackend(std::unique_ptr<CpuBackend> backend) {
+  this->backend = std::move(backend);
+  this->backend->Invalidate();
 }
 
-void Chip8::Draw() {
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 64, 32, GL_RGB, GL_UNSIGNED_BYTE,
-                  this->pixelBuffer.data());
+void Chip8::SetAudioOutput(AudioOutput *output) { this->audioOutput = output; }
 
-  glUseProgram(this->shader);
+void Chip8::SetLatencyProbe(LatencyProbe *probe) {
+  this->latencyProbe = probe;
+}
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, this->texture);
+void Chip8::SetTraceRecorder(TraceRecorder *recorder) {
+  this->traceRecorder = recorder;
+}
 
-  glBindVertexArray(this->VAO);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+void Chip8::SetMovieRecorder(MovieRecorder *recorder) {
+  this->movieRecorder = recorder;
 }
 
-void Chip8::executeOneInstruction() {
-  // Local lambda for invalid opcodes
-  auto invalidOpcode = [](uint16_t opcode) {
-    std::array<char, 64> buffer;
-    sprintf(buffer.data(), "Invalid opcode: 0x%02X", opcode);
-    throw std::runtime_error(buffer.data());
-  };
-
-  const uint16_t opcode =
-      this->memory.at(this->PC + 1) | (this->memory.at(this->PC) << 8);
-
-  this->PC += 2;
-
-  switch (opcode & 0xF000) {
-  case 0x0000:
-    switch (opcode) {
-    case 0x00E0:
-      std::memset(this->pixels.data(), 0, this->pixels.size());
-      std::memset(this->pixelBuffer.data(), 0, this->pixelBuffer.size());
-      break;
-
-    case 0x00EE:
-      if (this->stack.empty()) {
-        throw std::runtime_error("Corrupted stack.");
-      }
+void Chip8::SetDebugger(Debugger *debugger) { this->debugger = debugger; }
 
-      this->PC = this->stack.top();
-      this->stack.pop();
-      break;
+void Chip8::SetTrapPolicy(TrapPolicy policy) { this->trapPolicy = policy; }
 
-    default:
-      break;
-    }
-    break;
+const Trap &Chip8::GetTrap() const { return this->lastTrap; }
 
-  case 0x1000:
-    this->PC = opcode & 0x0FFF;
-    break;
+bool Chip8::IsHalted() const { return this->halted; }
 
-  case 0x2000:
-    this->stack.push(this->PC);
-    this->PC = opcode & 0x0FFF;
-    break;
+void Chip8::QueueKeyEvent(const KeyEvent &event) {
+  this->keyEvents.push_back(event);
+}
 
-  case 0x3000:
-    if (this->V.at((opcode & 0x0F00) >> 8) == (opcode & 0x00FF)) {
-      this->PC += 2;
-    }
-    break;
+void Chip8::Update(float deltaTime) {
+  this->clock += deltaTime;
 
-  case 0x4000:
-    if (this->V.at((opcode & 0x0F00) >> 8) != (opcode & 0x00FF)) {
-      this->PC += 2;
+  // Execute CPU instructions at a constant rate
+  this->updateAccumulator += deltaTime;
+  if (this->keyEvents.empty()) {
+    // Nothing to apply in between, so run all due instructions at once
+    uint64_t count = 0;
+    for (; this->updateAccumulator >= 0.f; count++) {
+      this->updateAccumulator -= this->updateTime;
     }
-    break;
 
-  case 0x5000:
-    if (this->V.at((opcode & 0x0F00) >> 8) ==
-        this->V.at((opcode & 0x00F0) >> 4)) {
-      this->PC += 2;
+    this->RunCycles(count);
+  } else {
+    while (this->updateAccumulator >= 0.f) {
+      // Apply the key events that happened before this instruction was due
+      this->applyKeyEvents(this->clock - this->updateAccumulator);
+      this->RunCycles(1);
+      this->updateAccumulator -= this->updateTime;
     }
-    break;
-
-  case 0x6000:
-    this->V.at((opcode & 0x0F00) >> 8) = opcode & 0x00FF;
-    break;
+  }
 
-  case 0x7000:
-    this->V.at((opcode & 0x0F00) >> 8) += opcode & 0x00FF;
-    break;
+  this->GenerateAudio(deltaTime);
+}
 
-  case 0x8000: {
-    switch (opcode & 0x000F) {
-    case 0x0000:
-      this->V.at((opcode & 0x0F00) >> 8) = this->V.at((opcode & 0x00F0) >> 4);
-      break;
-
-    case 0x0001:
-      this->V.at((opcode & 0x0F00) >> 8) |= this->V.at((opcode & 0x00F0) >> 4);
-      break;
-
-    case 0x0002:
-      this->V.at((opcode & 0x0F00) >> 8) &= this->V.at((opcode & 0x00F0) >> 4);
-      break;
-
-    case 0x0003:
-      this->V.at((opcode & 0x0F00) >> 8) ^= this->V.at((opcode & 0x00F0) >> 4);
-      break;
-
-    case 0x0004: {
-      int16_t sum = this->V.at((opcode & 0x0F00) >> 8) +
-                    this->V.at((opcode & 0x00F0) >> 4);
-
-      if (sum >= 256) {
-        this->V.at(0xF) = 1;
-        sum -= 256;
-      } else {
-        this->V.at(0xF) = 0;
-      }
+void Chip8::GenerateAudio(float deltaTime) {
+  // Generate the audio for the elapsed time while the sound timer is active
+  if (this->audioOutput != nullptr) {
+    std::array<int16_t, Audio::kPeriodSize> samples;
 
-      this->V.at((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(sum);
-    } break;
+    this->audioSampleAccumulator += deltaTime * Audio::kSampleRate;
+    while (this->audioSampleAccumulator >= 1.f) {
+      const auto count = std::min(
+          samples.size(), static_cast<size_t>(this->audioSampleAccumulator));
 
-    case 0x0005: {
-      int16_t diff = this->V.at((opcode & 0x0F00) >> 8) -
-                     this->V.at((opcode & 0x00F0) >> 4);
+      this->toneGenerator.Generate(samples.data(), count, this->state);
+      this->audioOutput->Push(samples.data(), count);
+      this->audioSampleAccumulator -= static_cast<float>(count);
+    }
+  }
+}
 
-      if (diff < 0) {
-        diff += 256;
-        this->V.at(0xF) = 0;
-      } else {
-        this->V.at(0xF) = 1;
-      }
+void Chip8::SetKey(uint8_t key, bool pressed) {
+  this->state.keys.at(key) = pressed;
 
-      this->V.at((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(diff);
-    } break;
+  if (this->movieRecorder != nullptr) {
+    this->movieRecorder->RecordKey(this->state.cycles, key, pressed);
+  }
+}
 
-    case 0x0006:
-      this->V.at(0xF) = this->V.at((opcode & 0x0F00) >> 8) & 0x1;
-      this->V.at((opcode & 0x0F00) >> 8) >>= 1;
-      break;
+void Chip8::RunCycles(uint64_t count) {
+  // The timers tick at 60 Hz, i.e. every (CPU rate / 60) instructions
+  // Each instruction advances the phase by 60 and a tick happens whenever it
+  // reaches the CPU rate, which keeps the ticks exact in integer arithmetic
+#ifdef CHIP8_PROFILER
+  const bool instrumented = true;
+#else
+  const bool instrumented =
+      (this->traceRecorder != nullptr) || (this->latencyProbe != nullptr);
+#endif
+
+  while (count > 0 && !this->halted &&
+         (this->debugger == nullptr || !this->debugger->IsStopped())) {
+    if (this->movieRecorder != nullptr) {
+      this->movieRecorder->Update(this->state, this->updateRate);
+    }
 
-    case 0x0007: {
-      int16_t diff = this->V.at((opcode & 0x00F0) >> 4) -
-                     this->V.at((opcode & 0x0F00) >> 8);
+    const uint64_t untilTick =
+        (this->updateRate - this->state.timerPhase + 59) / 60;
+    const auto segment = std::min(count, untilTick);
+
+    // An armed debugger may also stop the machine, without a fault; it's
+    // checked by its own instantiation of the instruction loop, so the
+    // others are the same as without a debugger
+    const auto armed =
+        (this->debugger != nullptr) && this->debugger->IsArmed();
+    auto fault = Fault::kNone;
+    const auto executed =
+        armed          ? this->runInstrumented<true>(segment, fault)
+        : instrumented ? this->runInstrumented<false>(segment, fault)
+                       : this->backend->Run(this->state, segment, fault);
+
+    this->countCycles(executed);
+    count -= executed;
+
+    if (fault != Fault::kNone) {
+      // May throw, or skip the instruction as if it were a NOP
+      this->trap(fault);
+      if (this->trapPolicy == TrapPolicy::kIgnore &&
+          this->debugger == nullptr) {
+        // The skipped instruction takes a cycle, so it's traced like the
+        // others to keep the trace's cycles the machine's
+        if (this->traceRecorder != nullptr) {
+          this->traceRecorder->Record(this->state.cycles, this->lastTrap.pc,
+                                      this->lastTrap.opcode, this->state.I,
+                                      this->state.V);
+        }
 
-      if (diff < 0) {
-        diff += 256;
-        this->V.at(0xF) = 0;
-      } else {
-        this->V.at(0xF) = 1;
+        this->countCycles(1);
+        --count;
       }
-
-      this->V.at((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(diff);
-    } break;
-
-    case 0x000E:
-      this->V.at(0xF) = this->V.at((opcode & 0x0F00) >> 8) & 0x80;
-      this->V.at((opcode & 0x0F00) >> 8) <<= 1;
-      break;
-
-    default:
-      invalidOpcode(opcode);
     }
-  } break;
-
-  case 0x9000:
-    if (this->V.at((opcode & 0x0F00) >> 8) !=
-        this->V.at((opcode & 0x00F0) >> 4))
-      this->PC += 2;
-    break;
+  }
+}
 
-  case 0xA000:
-    this->I = opcode & 0x0FFF;
-    break;
+void Chip8::RunFrame() {
+  this->RunCycles((this->updateRate - this->state.timerPhase + 59) / 60);
+}
 
-  case 0xB000:
-    this->PC = (opcode & 0x0FFF) + this->V.at(0);
-    break;
+const Chip8State &Chip8::GetState() const { return this->state; }
 
-  case 0xC000:
-    this->V.at((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(rand() & opcode);
-    break;
+void Chip8::SetState(const Chip8State &state) {
+  this->state = state;
+  this->lastTrap = {};
+  this->halted = false;
+  this->backend->Invalidate();
+}
 
-  case 0xD000: {
-    const auto xStart = this->V.at((opcode & 0x0F00) >> 8);
-    const auto yStart = this->V.at((opcode & 0x00F0) >> 4);
+const Chip8State &Chip8::RunAhead(unsigned int frames) {
+  // Snapshot the state; copying it only shares the memory pages
+  this->aheadState = this->state;
+  const auto halted = this->halted;
+  const auto lastTrap = this->lastTrap;
+  const auto trapPolicy = this->trapPolicy;
+  const auto latencyProbe = this->latencyProbe;
+  const auto traceRecorder = this->traceRecorder;
+  const auto movieRecorder = this->movieRecorder;
+  const auto debugger = this->debugger;
+
+  this->trapPolicy = TrapPolicy::kHalt;
+  this->latencyProbe = nullptr;
+  this->traceRecorder = nullptr;
+  this->movieRecorder = nullptr;
+  this->debugger = nullptr;
+#ifdef CHIP8_PROFILER
+  this->runningAhead = true;
+#endif
+
+  for (unsigned int i = 0; i < frames; i++) {
+    this->RunFrame();
+  }
 
-    this->V.at(0xF) = 0;
+  // Restore the snapshot, keeping the state reached to present it
+  std::swap(this->state, this->aheadState);
+  this->halted = halted;
+  this->lastTrap = lastTrap;
+  this->trapPolicy = trapPolicy;
+  this->latencyProbe = latencyProbe;
+  this->traceRecorder = traceRecorder;
+  this->movieRecorder = movieRecorder;
+  this->debugger = debugger;
+#ifdef CHIP8_PROFILER
+  this->runningAhead = false;
+#endif
+  this->backend->Invalidate();
+
+  return this->aheadState;
+}
 
-    for (uint8_t yOffset = 0; yOffset < (opcode & 0x000F); yOffset++) {
-      const auto data = this->memory.at(this->I + yOffset);
+#ifdef CHIP8_PROFILER
+const Profiler &Chip8::GetProfiler() const { return this->profiler; }
+#endif
 
-      for (uint8_t xOffset = 0; xOffset < 8; xOffset++) {
-        if ((data & (0x80 >> xOffset)) != 0) {
-          if (this->isPixelOn(xStart + xOffset, yStart + yOffset)) {
-            this->V.at(0xF) = 1;
-          }
+void Chip8::applyKeyEvents(double time) {
+  while (!this->keyEvents.empty() && this->keyEvents.front().time <= time) {
+    const auto &event = this->keyEvents.front();
+    this->state.keys.at(event.key) = event.pressed;
 
-          this->togglePixel(xStart + xOffset, yStart + yOffset);
-        }
-      }
+    if (this->movieRecorder != nullptr) {
+      this->movieRecorder->RecordKey(this->state.cycles, event.key,
+                                     event.pressed);
     }
-  } break;
-
-  case 0xE000: {
-    switch (opcode & 0x00FF) {
-    case 0x009E:
-      if (this->keys.at(this->V.at((opcode & 0x0F00) >> 8))) {
-        this->PC += 2;
-      }
-      break;
 
-    case 0x00A1:
-      if (!this->keys.at(this->V.at((opcode & 0x0F00) >> 8))) {
-        this->PC += 2;
-      }
-      break;
+    this->keyEvents.pop_front();
 
-    default:
-      invalidOpcode(opcode);
+    if (this->latencyProbe != nullptr) {
+      this->latencyProbe->OnKeyApplied();
     }
-  } break;
-
-  case 0xF000: {
-    switch (opcode & 0x00FF) {
-    case 0x0007:
-      this->V.at((opcode & 0x0F00) >> 8) = this->delayTimer;
-      break;
-
-    case 0x000A: {
-      bool keyPressed = false;
-
-      for (uint8_t index = 0; index < this->keys.size(); index++) {
-        if (this->keys.at(index)) {
-          keyPressed = true;
-          this->V.at((opcode & 0x0F00) >> 8) = index;
-          break;
-        }
-      }
+  }
+}
 
-      if (!keyPressed) {
-        this->PC -= 2;
+template <bool kDebugged>
+uint64_t Chip8::runInstrumented(uint64_t count, Fault &fault) {
+  for (uint64_t i = 0; i < count; i++) {
+    // Fetch the opcode before it executes in case it overwrites itself
+    const auto pc = this->state.PC;
+    if constexpr (kDebugged) {
+      if (this->debugger->CheckBefore(this->state)) {
+        return i;
       }
-    } break;
-
-    case 0x0015:
-      this->delayTimer = this->V.at((opcode & 0x0F00) >> 8);
-      break;
-
-    case 0x0018:
-      this->soundTimer = this->V.at((opcode & 0x0F00) >> 8);
-      break;
+    }
 
-    case 0x001E:
-      this->I += this->V.at((opcode & 0x0F00) >> 8);
-      break;
+    if (pc >= Memory::kSize - 1) {
+      fault = Fault::kMemoryAccess;
+      return i;
+    }
 
-    case 0x0029:
-      this->I = this->V.at((opcode & 0x0F00) >> 8) * 5;
-      break;
+    const auto opcode = this->state.memory.ReadWord(pc);
 
-    case 0x0033: {
-      auto value = this->V.at((opcode & 0x0F00) >> 8);
-      for (int i = 3; i > 0; --i) {
-        this->memory[this->I + i - 1] = value % 10;
-        value /= 10;
+#ifdef CHIP8_PROFILER
+    if (!this->runningAhead) {
+      this->profiler.Record(pc, opcode);
+    }
+#endif
+
+    // DXYN changes the framebuffer iff any row of the sprite has a set bit
+    bool drawsPixels = false;
+    if (this->latencyProbe != nullptr && (opcode & 0xF000) == 0xD000) {
+      for (uint16_t row = 0;
+           row < (opcode & 0x000F) && this->state.I + row < Memory::kSize;
+           row++) {
+        drawsPixels |= this->state.memory[this->state.I + row] != 0;
       }
-    } break;
+    }
 
-    case 0x0055:
-      for (int offset = 0; offset <= (opcode & 0x0F00) >> 8; offset++)
-        this->memory.at(this->I + offset) = this->V.at(offset);
+    // Watchpoints need the memory that the instruction accesses, which
+    // depends on I before it executes
+    Opcodes::MemoryAccess access;
+    if constexpr (kDebugged) {
+      access = Opcodes::GetMemoryAccess(opcode, this->state.I);
+    }
 
-      break;
+    fault = this->backend->Step(this->state);
+    if (fault != Fault::kNone) {
+      return i;
+    }
 
-    case 0x0065:
-      for (int offset = 0; offset <= (opcode & 0x0F00) >> 8; offset++) {
-        this->V.at(offset) = this->memory.at(this->I + offset);
-      }
-      break;
+    if (this->traceRecorder != nullptr) {
+      this->traceRecorder->Record(this->state.cycles + i, pc, opcode,
+                                  this->state.I, this->state.V);
+    }
 
-    default:
-      invalidOpcode(opcode);
+    if (drawsPixels) {
+      this->latencyProbe->OnFramebufferChanged();
     }
-  } break;
 
-  default:
-    invalidOpcode(opcode);
+    if constexpr (kDebugged) {
+      if (this->debugger->CheckAfter(access)) {
+        return i + 1;
+      }
+    }
   }
+
+  return count;
 }
 
-[[nodiscard]] bool Chip8::isPixelOn(uint16_t x, uint16_t y) const {
-  x %= 64;
-  y %= 32;
+void Chip8::countCycles(uint64_t count) {
+  this->state.cycles += count;
+  this->state.timerPhase += static_cast<uint32_t>(count * 60);
+  while (this->state.timerPhase >= this->updateRate) {
+    this->state.timerPhase -= this->updateRate;
+    this->tickTimers();
 
-  return this->pixels.at((y * 64) + x);
+    if (this->movieRecorder != nullptr) {
+      this->movieRecorder->RecordFrame(this->state);
+    }
+  }
 }
 
-void Chip8::togglePixel(uint16_t x, uint16_t y) {
-  x %= 64;
-  y %= 32;
+void Chip8::trap(Fault fault) {
+  // The faulting instruction left the state unchanged
+  const auto pc = this->state.PC;
+  const auto opcode =
+      (pc < Memory::kSize - 1) ? this->state.memory.ReadWord(pc) : 0;
+  this->lastTrap = {fault, pc, static_cast<uint16_t>(opcode)};
+
+  // The debugger reports the fault instead, at the faulting instruction
+  if (this->debugger != nullptr) {
+    this->debugger->OnFault(fault);
+    return;
+  }
 
-  // Toggle the pixel boolean
-  auto &pixel = this->pixels.at((y * 64) + x);
-  pixel = !pixel;
+  switch (this->trapPolicy) {
+  case TrapPolicy::kHalt:
+    this->halted = true;
+    break;
 
-  auto pixelData = &this->pixelBuffer.at((y * 64 + x) * 3);
+  case TrapPolicy::kIgnore:
+    // Moving the PC past it may take the state out of what the backend
+    // expects
+    this->state.PC += 2;
+    this->backend->Invalidate();
+    break;
 
-  if (pixel) {
-    // "On" pixels are amber
-    pixelData[0] = 0xFF;
-    pixelData[1] = 0xBB;
-    pixelData[2] = 0x00;
-  } else {
-    // "Off" pixels are black
-    pixelData[0] = 0;
-    pixelData[1] = 0;
-    pixelData[2] = 0;
+  case TrapPolicy::kRaise:
+    throw std::runtime_error(this->lastTrap.GetMessage());
   }
 }
 
-namespace {
-GLuint compileShader(const std::string &path, GLenum type) {
-  // Load the file
-  auto shaderData = Util::FileReadBinary(path);
-
-  // Add a null terminator because it's a C string
-  shaderData.push_back(0);
-
-  const auto shaderChars = reinterpret_cast<const GLchar *>(shaderData.data());
-  const auto shader = glCreateShader(type);
-
-  glShaderSource(shader, 1, &shaderChars, nullptr);
-  glCompileShader(shader);
-
-  GLint success;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    std::array<GLchar, 512> infoOutput;
-    glGetShaderInfoLog(shader, static_cast<GLsizei>(infoOutput.size()), nullptr,
-                       infoOutput.data());
-    glDeleteShader(shader);
-    throw std::runtime_error("Failed to compile shader " + path + "\n" +
-                             infoOutput.data());
+void Chip8::tickTimers() {
+  if (this->state.delayTimer != 0) {
+    --this->state.delayTimer;
   }
 
-  return shader;
-}
-
-GLuint linkShader(GLuint vertexShader, GLuint fragmentShader) {
-  const auto program = glCreateProgram();
-
-  glAttachShader(program, vertexShader);
-  glAttachShader(program, fragmentShader);
-  glLinkProgram(program);
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-
-  GLint success;
-  glGetProgramiv(program, GL_LINK_STATUS, &success);
-  if (!success) {
-    std::array<GLchar, 512> infoOutput;
-    glGetShaderInfoLog(program, static_cast<GLsizei>(infoOutput.size()),
-                       nullptr, infoOutput.data());
-    glDeleteProgram(program);
-    throw std::runtime_error("Failed to link shaders\n" +
-                             std::string(infoOutput.data()));
+  if (this->state.soundTimer != 0) {
+    --this->state.soundTimer;
   }
-
-  return program;
 }
-} // namespace
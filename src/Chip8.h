@@ -3,52 +3,146 @@
 
 #include <array>
 #include <cstdint>
-#include <stack>
+#include <deque>
+#include <memory>
 #include <string>
 
-#include <GLFW/glfw3.h>
-#include <glad/glad.h>
+#include "Audio.h"
+#include "Chip8State.h"
+#include "CpuBackend.h"
+#include "Debugger.h"
+#include "LatencyProbe.h"
+#include "Movie.h"
+#include "TraceRecorder.h"
+#include "Trap.h"
 
+#ifdef CHIP8_PROFILER
+#include "Profiler.h"
+#endif
+
+// The emulated machine, independent of any window or graphics API
 class Chip8 {
+public:
+  // Change of a keypad key (0x0-0xF), stamped with the frontend's clock
+  struct KeyEvent {
+    double time;
+    uint8_t key;
+    bool pressed;
+  };
+
 public:
   Chip8();
-  ~Chip8();
 
-  void InitializeGraphics();
   void LoadRom(const std::string &romPath);
+  void LoadRom(const uint8_t *data, size_t size);
+
+  // Returns to the state right after the last LoadRom() (with the current
+  // random seed), restoring only the memory pages written to since then
+  void Reset();
+
   void SetCpuRate(uint16_t instructionsPerSecond);
-  void Update(GLFWwindow *window, float deltaTime);
-  void Draw();
+  [[nodiscard]] uint16_t GetCpuRate() const;
+  void SetRandomSeed(uint32_t seed);
+
+  // The verified interpreter by default
+  void SetCpuBackend(std::unique_ptr<CpuBackend> backend);
+  void SetAudioOutput(AudioOutput *output);
+  void SetLatencyProbe(LatencyProbe *probe);
+  void SetTraceRecorder(TraceRecorder *recorder);
+  void SetMovieRecorder(MovieRecorder *recorder);
+
+  // Stops at the debugger's breakpoints, watchpoints and conditions, and
+  // stops on faults instead of trapping, while attached
+  // Only while the debugger is armed does the machine run a checked variant
+  // of the instruction loop; otherwise, attached or not, it costs nothing
+  void SetDebugger(Debugger *debugger);
+
+  // What happens when an instruction faults (TrapPolicy::kRaise by default)
+  void SetTrapPolicy(TrapPolicy policy);
+
+  // The last fault, until the next LoadRom(), Reset() or SetState()
+  [[nodiscard]] const Trap &GetTrap() const;
+
+  // Whether the machine stopped on a fault (TrapPolicy::kHalt)
+  // RunCycles() does nothing until the next LoadRom(), Reset() or SetState()
+  [[nodiscard]] bool IsHalted() const;
+
+  // Real-time operation: the events are applied at the instruction that was
+  // due when they happened
+  void QueueKeyEvent(const KeyEvent &event);
+  void Update(float deltaTime);
+
+  // Generates the audio for the elapsed time (done by Update()), for
+  // frontends that run the machine frame by frame instead
+  void GenerateAudio(float deltaTime);
+
+  // Headless operation: runs a fixed number of instructions, ticking the
+  // timers every (CPU rate / 60) instructions
+  // Returns early if the machine halts on a fault or the debugger stops it
+  void SetKey(uint8_t key, bool pressed);
+  void RunCycles(uint64_t count);
+
+  // Runs until the next timer tick, i.e. one 60 Hz frame
+  void RunFrame();
+
+  // Machines set to the state of another share its memory pages until they
+  // write to them, e.g. a pool of machines running the same ROM
+  [[nodiscard]] const Chip8State &GetState() const;
+  void SetState(const Chip8State &state);
+
+  // Run-ahead: runs the given number of frames (60 Hz timer ticks) past the
+  // current state with the current keys, then returns to it
+  // Returns the state reached, to be presented instead of the current one;
+  // nothing is recorded, traced, profiled or debugged meanwhile, and a
+  // fault just ends the run early
+  const Chip8State &RunAhead(unsigned int frames);
+
+#ifdef CHIP8_PROFILER
+  [[nodiscard]] const Profiler &GetProfiler() const;
+#endif
 
 private:
-  void executeOneInstruction();
-  [[nodiscard]] bool isPixelOn(uint16_t x, uint16_t y) const;
-  void togglePixel(uint16_t x, uint16_t y);
+  void applyKeyEvents(double time);
+  template <bool kDebugged>
+  uint64_t runInstrumented(uint64_t count, Fault &fault);
+  void countCycles(uint64_t count);
+  void trap(Fault fault);
+  void tickTimers();
 
 private:
   // CPU stuff
-  std::array<uint8_t, 4096> memory = {};
-  std::array<uint8_t, 16> V = {};
-  uint16_t I = 0;
-  uint16_t PC = 0x200;
-  std::stack<uint16_t> stack;
-  std::array<bool, 16> keys = {};
-  uint8_t delayTimer = 0;
-  float delayTimerAccumulator = 0.f;
-  uint8_t soundTimer = 0;
-  // TODO need floating point helper for this one too
+  Chip8State state;
+  Chip8State loadedState;
+  Chip8State aheadState;
+  std::unique_ptr<CpuBackend> backend;
   uint16_t updateRate = 500;
   float updateTime = 1.f / updateRate;
   float updateAccumulator = 0.f;
+  TrapPolicy trapPolicy = TrapPolicy::kRaise;
+  Trap lastTrap;
+  bool halted = false;
+
+  // Input stuff
+  // The clock is the sum of all update deltas, so it matches the frontend's
+  // clock that the key events are stamped with
+  std::deque<KeyEvent> keyEvents;
+  double clock = 0.0;
+  LatencyProbe *latencyProbe = nullptr;
+
+  // Debugging stuff
+  TraceRecorder *traceRecorder = nullptr;
+  MovieRecorder *movieRecorder = nullptr;
+  Debugger *debugger = nullptr;
+
+#ifdef CHIP8_PROFILER
+  Profiler profiler;
+  bool runningAhead = false;
+#endif
 
-  // Graphics stuff
-  GLuint shader = -1;
-  GLuint texture = -1;
-  GLuint VAO = -1;
-  GLuint VBO = -1;
-  GLuint EBO = -1;
-  std::array<bool, 64 * 32> pixels = {};
-  std::array<uint8_t, 64 * 32 * 3> pixelBuffer = {};
+  // Audio stuff
+  AudioOutput *audioOutput = nullptr;
+  ToneGenerator toneGenerator;
+  float audioSampleAccumulator = 0.f;
 };
 
 #endif // CHIP8_H_INCLUDED
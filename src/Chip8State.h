@@ -0,0 +1,124 @@
+#ifndef CHIP8_STATE_H_INCLUDED
+#define CHIP8_STATE_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+
+#include "Memory.h"
+
+// The complete, deterministic machine state that the CPU backends operate on
+// Two machines with equal states behave identically given the same inputs
+struct Chip8State {
+  Memory memory;
+  std::array<uint8_t, 16> V = {};
+  uint16_t I = 0;
+  uint16_t PC = 0x200;
+  std::array<uint16_t, 16> stack = {};
+  uint8_t SP = 0;
+  std::array<bool, 16> keys = {};
+  uint8_t delayTimer = 0;
+  uint8_t soundTimer = 0;
+  std::array<bool, 64 * 32> pixels = {};
+
+  // xorshift32 state for CXNN (never 0)
+  uint32_t randomState = 1;
+
+  // XO-CHIP audio (F002, FX3A)
+  std::array<uint8_t, 16> audioPattern = {};
+  bool audioPatternLoaded = false;
+  uint8_t audioPitch = 64;
+
+  // Instructions executed so far, and the position between two 60 Hz timer
+  // ticks (in 1/60ths of a cycle, see Chip8::RunCycles)
+  uint64_t cycles = 0;
+  uint32_t timerPhase = 0;
+
+  bool operator==(const Chip8State &other) const {
+    return this->memory == other.memory && this->V == other.V &&
+           this->I == other.I && this->PC == other.PC &&
+           this->stack == other.stack && this->SP == other.SP &&
+           this->keys == other.keys && this->delayTimer == other.delayTimer &&
+           this->soundTimer == other.soundTimer &&
+           this->pixels == other.pixels &&
+           this->randomState == other.randomState &&
+           this->audioPattern == other.audioPattern &&
+           this->audioPatternLoaded == other.audioPatternLoaded &&
+           this->audioPitch == other.audioPitch &&
+           this->cycles == other.cycles && this->timerPhase == other.timerPhase;
+  }
+
+  bool operator!=(const Chip8State &other) const { return !(*this == other); }
+
+  // Sets all fields to the snapshot's, copying only the memory pages that
+  // were written to since the snapshot was taken from this state
+  // Returns how many pages were restored
+  size_t Restore(const Chip8State &snapshot) {
+    const auto restored = this->memory.Restore(snapshot.memory);
+    this->V = snapshot.V;
+    this->I = snapshot.I;
+    this->PC = snapshot.PC;
+    this->stack = snapshot.stack;
+    this->SP = snapshot.SP;
+    this->keys = snapshot.keys;
+    this->delayTimer = snapshot.delayTimer;
+    this->soundTimer = snapshot.soundTimer;
+    this->pixels = snapshot.pixels;
+    this->randomState = snapshot.randomState;
+    this->audioPattern = snapshot.audioPattern;
+    this->audioPatternLoaded = snapshot.audioPatternLoaded;
+    this->audioPitch = snapshot.audioPitch;
+    this->cycles = snapshot.cycles;
+    this->timerPhase = snapshot.timerPhase;
+
+    return restored;
+  }
+
+  // FNV-1a over all fields, for comparing states that aren't kept around
+  [[nodiscard]] uint64_t GetChecksum() const {
+    uint64_t hash = 0xCBF29CE484222325;
+    const auto add = [&hash](uint64_t value, int bytes) {
+      for (int i = 0; i < bytes; i++) {
+        hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 0x100000001B3;
+      }
+    };
+
+    for (size_t address = 0; address < this->memory.size(); address++) {
+      add(this->memory[address], 1);
+    }
+
+    for (const auto value : this->V) {
+      add(value, 1);
+    }
+
+    add(this->I, 2);
+    add(this->PC, 2);
+    for (const auto address : this->stack) {
+      add(address, 2);
+    }
+
+    add(this->SP, 1);
+    for (const auto key : this->keys) {
+      add(key, 1);
+    }
+
+    add(this->delayTimer, 1);
+    add(this->soundTimer, 1);
+    for (const auto pixel : this->pixels) {
+      add(pixel, 1);
+    }
+
+    add(this->randomState, 4);
+    for (const auto byte : this->audioPattern) {
+      add(byte, 1);
+    }
+
+    add(this->audioPatternLoaded, 1);
+    add(this->audioPitch, 1);
+    add(this->cycles, 8);
+    add(this->timerPhase, 4);
+
+    return hash;
+  }
+};
+
+#endif // CHIP8_STATE_H_INCLUDED
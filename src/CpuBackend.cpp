@@ -0,0 +1,27 @@
+#include <stdexcept>
+
+#include "CpuBackend.h"
+#include "Interpreter.h"
+#include "RecompiledBackend.h"
+
+namespace CpuBackends {
+std::unique_ptr<CpuBackend> Create(const std::string &name) {
+  if (name == "interpreter") {
+    return std::make_unique<InterpreterBackend>();
+  }
+
+  if (name == "verified") {
+    return std::make_unique<VerifiedBackend>();
+  }
+
+  if (name == "recompiled") {
+    return std::make_unique<RecompiledBackend>();
+  }
+
+  throw std::runtime_error("Unknown CPU backend: " + name);
+}
+
+std::vector<std::string> GetNames() {
+  return {"interpreter", "verified", "recompiled"};
+}
+} // namespace CpuBackends
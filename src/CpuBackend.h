@@ -0,0 +1,55 @@
+#ifndef CPU_BACKEND_H_INCLUDED
+#define CPU_BACKEND_H_INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Chip8State.h"
+#include "Trap.h"
+
+// Executes instructions on a Chip8State
+// Every backend must match the reference interpreter exactly; use the
+// differential runner (chip8_diff) to check a new one
+class CpuBackend {
+public:
+  virtual ~CpuBackend() = default;
+
+  [[nodiscard]] virtual const char *GetName() const = 0;
+
+  // Executes one instruction
+  // A faulting instruction returns the fault and leaves the state unchanged;
+  // only allocating a page of memory as it's written to may throw
+  // (std::bad_alloc)
+  [[nodiscard]] virtual Fault Step(Chip8State &state) = 0;
+
+  // Executes up to count instructions, stopping at the first fault
+  // Returns how many were executed; if fewer than count, fault is set to why
+  // the next one can't be
+  // The timers are ticked by the caller between calls, never during one
+  virtual uint64_t Run(Chip8State &state, uint64_t count,
+                       Fault &fault) {
+    for (uint64_t i = 0; i < count; i++) {
+      fault = this->Step(state);
+      if (fault != Fault::kNone) {
+        return i;
+      }
+    }
+
+    return count;
+  }
+
+  // Called when the state was replaced or its memory modified from outside
+  // the backend (ROM loading, snapshots), so that any caches can be dropped
+  virtual void Invalidate() {}
+};
+
+namespace CpuBackends {
+// Throws if there is no backend with this name
+std::unique_ptr<CpuBackend> Create(const std::string &name);
+
+std::vector<std::string> GetNames();
+} // namespace CpuBackends
+
+#endif // CPU_BACKEND_H_INCLUDED
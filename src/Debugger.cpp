@@ -0,0 +1,233 @@
+#include <algorithm>
+
+#include "Debugger.h"
+
+void Debugger::AddBreakpoint(uint16_t address) {
+  if (address < Memory::kSize) {
+    this->breakpoints.set(address);
+  }
+}
+
+void Debugger::RemoveBreakpoint(uint16_t address) {
+  if (address < Memory::kSize) {
+    this->breakpoints.reset(address);
+  }
+}
+
+void Debugger::AddWatchpoint(WatchType type, uint16_t address, uint16_t size) {
+  this->watchpoints.push_back({type, address, size});
+  this->updateWatches();
+}
+
+void Debugger::RemoveWatchpoint(WatchType type, uint16_t address,
+                                uint16_t size) {
+  const auto match = std::find_if(
+      this->watchpoints.begin(), this->watchpoints.end(),
+      [&](const Watchpoint &watchpoint) {
+        return watchpoint.type == type && watchpoint.address == address &&
+               watchpoint.size == size;
+      });
+  if (match != this->watchpoints.end()) {
+    this->watchpoints.erase(match);
+    this->updateWatches();
+  }
+}
+
+void Debugger::AddCondition(const Condition &condition) {
+  this->conditions.push_back({condition, false});
+}
+
+void Debugger::ClearConditions() { this->conditions.clear(); }
+
+void Debugger::Reset() {
+  this->breakpoints.reset();
+  this->watchpoints.clear();
+  this->updateWatches();
+  this->conditions.clear();
+  this->stop({});
+}
+
+void Debugger::Step() {
+  this->stopped = false;
+  this->stepping = true;
+  this->resuming = true;
+}
+
+void Debugger::Continue() {
+  this->stopped = false;
+  this->stepping = false;
+  this->resuming = true;
+}
+
+void Debugger::Interrupt() { this->interrupted = true; }
+
+void Debugger::Break(const Stop &stop) { this->stop(stop); }
+
+void Debugger::SyncConditions(const Chip8State &state) {
+  this->checkConditions(state);
+}
+
+bool Debugger::IsStopped() const { return this->stopped; }
+
+const Debugger::Stop &Debugger::GetStop() const { return this->lastStop; }
+
+bool Debugger::IsArmed() const {
+  return this->stepping || this->interrupted || this->breakpoints.any() ||
+         !this->watchpoints.empty() || !this->conditions.empty();
+}
+
+bool Debugger::CheckBefore(const Chip8State &state) {
+  if (this->interrupted) {
+    Stop stop;
+    stop.signal = Stop::kSigInt;
+    this->stop(stop);
+    return true;
+  }
+
+  if (this->resuming) {
+    this->resuming = false;
+    return false;
+  }
+
+  if (state.PC < Memory::kSize && this->breakpoints.test(state.PC)) {
+    Stop stop;
+    stop.breakpoint = true;
+    this->stop(stop);
+    return true;
+  }
+
+  if (!this->conditions.empty() && this->checkConditions(state)) {
+    Stop stop;
+    stop.condition = true;
+    this->stop(stop);
+    return true;
+  }
+
+  return false;
+}
+
+bool Debugger::CheckAfter(const Opcodes::MemoryAccess &access) {
+  // Instructions that don't access memory have an empty range
+  const auto &watches = access.write ? this->writeWatches : this->readWatches;
+  const auto end = std::min<size_t>(access.address + access.size,
+                                    Memory::kSize);
+  for (size_t address = access.address; address < end; address++) {
+    if (!watches.test(address)) {
+      continue;
+    }
+
+    // Report the first watchpoint on the byte
+    for (const auto &watchpoint : this->watchpoints) {
+      const auto matches = (watchpoint.type == WatchType::kAccess) ||
+                           ((watchpoint.type == WatchType::kWrite) ==
+                            access.write);
+      if (matches && address >= watchpoint.address &&
+          address < watchpoint.address + watchpoint.size) {
+        Stop stop;
+        stop.watchpoint = true;
+        stop.watchType = watchpoint.type;
+        stop.watchAddress = static_cast<uint16_t>(address);
+        this->stop(stop);
+        return true;
+      }
+    }
+  }
+
+  if (this->stepping) {
+    this->stop({});
+    return true;
+  }
+
+  return false;
+}
+
+void Debugger::OnFault(Fault fault) {
+  Stop stop;
+  stop.signal = (fault == Fault::kMemoryAccess ||
+                 fault == Fault::kStackUnderflow)
+                    ? Stop::kSigSegv
+                    : Stop::kSigIll;
+  this->stop(stop);
+}
+
+void Debugger::stop(const Stop &stop) {
+  this->stopped = true;
+  this->stepping = false;
+  this->interrupted = false;
+  this->resuming = false;
+  this->lastStop = stop;
+}
+
+void Debugger::updateWatches() {
+  this->readWatches.reset();
+  this->writeWatches.reset();
+
+  for (const auto &watchpoint : this->watchpoints) {
+    const auto end = std::min<size_t>(
+        watchpoint.address + watchpoint.size, Memory::kSize);
+    for (size_t address = watchpoint.address; address < end; address++) {
+      if (watchpoint.type != WatchType::kWrite) {
+        this->readWatches.set(address);
+      }
+
+      if (watchpoint.type != WatchType::kRead) {
+        this->writeWatches.set(address);
+      }
+    }
+  }
+}
+
+bool Debugger::checkConditions(const Chip8State &state) {
+  auto stop = false;
+  for (auto &armed : this->conditions) {
+    const auto &condition = armed.condition;
+    uint16_t value = 0;
+    switch (condition.reg) {
+    case kRegisterI:
+      value = state.I;
+      break;
+    case kRegisterPc:
+      value = state.PC;
+      break;
+    case kRegisterSp:
+      value = state.SP;
+      break;
+    case kRegisterDt:
+      value = state.delayTimer;
+      break;
+    case kRegisterSt:
+      value = state.soundTimer;
+      break;
+    default:
+      value = state.V[condition.reg & 0x0F];
+      break;
+    }
+
+    bool matches = false;
+    switch (condition.comparison) {
+    case Comparison::kEqual:
+      matches = value == condition.value;
+      break;
+    case Comparison::kNotEqual:
+      matches = value != condition.value;
+      break;
+    case Comparison::kLess:
+      matches = value < condition.value;
+      break;
+    case Comparison::kLessEqual:
+      matches = value <= condition.value;
+      break;
+    case Comparison::kGreater:
+      matches = value > condition.value;
+      break;
+    case Comparison::kGreaterEqual:
+      matches = value >= condition.value;
+      break;
+    }
+
+    stop = stop || (matches && !armed.met);
+    armed.met = matches;
+  }
+
+  return stop;
+}
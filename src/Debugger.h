@@ -0,0 +1,145 @@
+#ifndef DEBUGGER_H_INCLUDED
+#define DEBUGGER_H_INCLUDED
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include "Chip8State.h"
+#include "Opcodes.h"
+#include "Trap.h"
+
+// Breakpoints, watchpoints and single-stepping for a machine
+// While attached (see Chip8::SetDebugger()), the machine runs nothing while
+// it's stopped, and checks it around every instruction while it's armed
+//
+// Breakpoints and watched bytes are bitmaps of the address space, so a check
+// costs the same however many there are.
+class Debugger {
+public:
+  enum class WatchType : uint8_t { kWrite, kRead, kAccess };
+
+  // Registers, numbered as GDB does: V0-VF are 0-15
+  enum Register : uint8_t {
+    kRegisterI = 16,
+    kRegisterPc,
+    kRegisterSp,
+    kRegisterDt,
+    kRegisterSt
+  };
+
+  enum class Comparison : uint8_t {
+    kEqual,
+    kNotEqual,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual
+  };
+
+  // Stops before the instruction where the register starts comparing to the
+  // value as given
+  struct Condition {
+    uint8_t reg;
+    Comparison comparison;
+    uint16_t value;
+  };
+
+  // Why the machine stopped, with the POSIX signal numbers that GDB expects
+  struct Stop {
+    enum Signal : uint8_t {
+      kSigInt = 2,
+      kSigIll = 4,
+      kSigTrap = 5,
+      kSigSegv = 11
+    };
+
+    Signal signal = kSigTrap;
+    bool breakpoint = false;
+    bool condition = false;
+    bool watchpoint = false;
+    WatchType watchType = WatchType::kWrite;
+    uint16_t watchAddress = 0;
+  };
+
+public:
+  void AddBreakpoint(uint16_t address);
+  void RemoveBreakpoint(uint16_t address);
+  void AddWatchpoint(WatchType type, uint16_t address, uint16_t size);
+  void RemoveWatchpoint(WatchType type, uint16_t address, uint16_t size);
+  void AddCondition(const Condition &condition);
+  void ClearConditions();
+
+  // Removes all breakpoints, watchpoints and conditions, and stops
+  void Reset();
+
+  // Resumes for one instruction, or until the next stop
+  void Step();
+  void Continue();
+
+  // Stops before the next instruction
+  void Interrupt();
+
+  // Stops for the given reason, e.g. after the machine went back in time
+  void Break(const Stop &stop);
+
+  // Takes the conditions as they hold at the state, so that only changes
+  // from there stop, e.g. after the state was replaced
+  void SyncConditions(const Chip8State &state);
+
+  [[nodiscard]] bool IsStopped() const;
+  [[nodiscard]] const Stop &GetStop() const;
+
+  // Whether anything can stop the machine before a fault, so that it must
+  // run the checked instruction loop; otherwise it runs as if detached
+  [[nodiscard]] bool IsArmed() const;
+
+  // Called by the machine before and after each instruction while armed,
+  // and on faults
+  // Return whether the machine must stop
+  [[nodiscard]] bool CheckBefore(const Chip8State &state);
+  [[nodiscard]] bool CheckAfter(const Opcodes::MemoryAccess &access);
+  void OnFault(Fault fault);
+
+private:
+  struct Watchpoint {
+    WatchType type;
+    uint16_t address;
+    uint16_t size;
+  };
+
+  struct ArmedCondition {
+    Condition condition;
+
+    // Whether it held before the previous instruction
+    bool met;
+  };
+
+private:
+  void stop(const Stop &stop);
+  void updateWatches();
+  // Returns whether any condition became true
+  bool checkConditions(const Chip8State &state);
+
+private:
+  std::bitset<Memory::kSize> breakpoints;
+
+  // The watchpoints may overlap, so the bitmaps are built from them
+  std::vector<Watchpoint> watchpoints;
+  std::bitset<Memory::kSize> readWatches;
+  std::bitset<Memory::kSize> writeWatches;
+
+  std::vector<ArmedCondition> conditions;
+
+  // A new debugger has the machine stopped, e.g. until GDB connects
+  bool stopped = true;
+  bool stepping = false;
+  bool interrupted = false;
+
+  // The breakpoint at the PC that execution resumes from is skipped
+  bool resuming = false;
+
+  Stop lastStop;
+};
+
+#endif // DEBUGGER_H_INCLUDED
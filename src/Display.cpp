@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "Display.h"
+#include "Util.h"
+
+namespace {
+// Constants
+// "On" pixels are amber, "off" pixels are black
+constexpr std::array<uint8_t, 3> kOnColor = {0xFF, 0xBB, 0x00};
+constexpr std::array<uint8_t, 3> kOffColor = {0x00, 0x00, 0x00};
+
+// Functions
+GLuint compileShader(const std::string &path, GLenum type);
+GLuint linkShader(GLuint vertexShader, GLuint fragmentShader);
+} // namespace
+
+Display::~Display() {
+#ifdef CHIP8_PROFILER
+  if (this->heatMapTexture != static_cast<GLuint>(-1)) {
+    glDeleteTextures(1, &this->heatMapTexture);
+  }
+
+  if (this->heatMapVBO != static_cast<GLuint>(-1)) {
+    glDeleteBuffers(1, &this->heatMapVBO);
+  }
+
+  if (this->heatMapVAO != static_cast<GLuint>(-1)) {
+    glDeleteVertexArrays(1, &this->heatMapVAO);
+  }
+#endif
+
+  if (this->EBO != static_cast<GLuint>(-1)) {
+    glDeleteBuffers(1, &this->EBO);
+  }
+
+  if (this->VBO != static_cast<GLuint>(-1)) {
+    glDeleteBuffers(1, &this->VBO);
+  }
+
+  if (this->VAO != static_cast<GLuint>(-1)) {
+    glDeleteVertexArrays(1, &this->VAO);
+  }
+
+  if (this->shader != static_cast<GLuint>(-1)) {
+    glDeleteProgram(this->shader);
+  }
+}
+
+void Display::Initialize() {
+  const auto vertexShader =
+      compileShader("assets/shaders/Default.vs", GL_VERTEX_SHADER);
+  const auto fragmentShader =
+      compileShader("assets/shaders/Default.fs", GL_FRAGMENT_SHADER);
+
+  this->shader = linkShader(vertexShader, fragmentShader);
+
+  constexpr std::array<float, 6 * 5> vertices = {
+      // Top left
+      -1.f,
+      1.f,
+      0.0f,
+      0.f,
+      0.f,
+      // Bottom left
+      -1.f,
+      -1.f,
+      0.0f,
+      0.f,
+      1.f,
+      // Bottom Right
+      1.0f,
+      -1.f,
+      0.0f,
+      1.f,
+      1.f,
+      // Top left
+      -1.f,
+      1.f,
+      0.0f,
+      0.f,
+      0.f,
+      // Bottom Right
+      1.0f,
+      -1.f,
+      0.0f,
+      1.f,
+      1.f,
+      // Top Right
+      1.0f,
+      1.f,
+      0.0f,
+      1.f,
+      0.f,
+  };
+
+  glGenVertexArrays(1, &this->VAO);
+  glGenBuffers(1, &this->VBO);
+  // bind the Vertex Array Object first, then bind and set vertex buffer(s), and
+  // then configure vertex attributes(s).
+  glBindVertexArray(this->VAO);
+
+  glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(),
+               GL_STATIC_DRAW);
+
+  // Position attribute (x, y, z)
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                        (void *)nullptr);
+  glEnableVertexAttribArray(0);
+
+  // Texture coordinates attribute (u, v)
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                        (void *)(3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  glGenTextures(1, &this->texture);
+  glBindTexture(GL_TEXTURE_2D, this->texture);
+
+  // Wrapping parameters
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  // Filtering parameters
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 32, 0, GL_RGB, GL_UNSIGNED_BYTE,
+               this->pixelBuffer.data());
+
+#ifdef CHIP8_PROFILER
+  // The heat map is a square on the right half of the screen
+  constexpr std::array<float, 6 * 5> heatMapVertices = {
+      // Top left
+      0.5f,
+      1.f,
+      0.f,
+      0.f,
+      0.f,
+      // Bottom left
+      0.5f,
+      -1.f,
+      0.f,
+      0.f,
+      1.f,
+      // Bottom Right
+      1.f,
+      -1.f,
+      0.f,
+      1.f,
+      1.f,
+      // Top left
+      0.5f,
+      1.f,
+      0.f,
+      0.f,
+      0.f,
+      // Bottom Right
+      1.f,
+      -1.f,
+      0.f,
+      1.f,
+      1.f,
+      // Top Right
+      1.f,
+      1.f,
+      0.f,
+      1.f,
+      0.f,
+  };
+
+  glGenVertexArrays(1, &this->heatMapVAO);
+  glGenBuffers(1, &this->heatMapVBO);
+  glBindVertexArray(this->heatMapVAO);
+
+  glBindBuffer(GL_ARRAY_BUFFER, this->heatMapVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(heatMapVertices),
+               heatMapVertices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                        (void *)nullptr);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                        (void *)(3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  glGenTextures(1, &this->heatMapTexture);
+  glBindTexture(GL_TEXTURE_2D, this->heatMapTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               this->heatMapBuffer.data());
+#endif
+}
+
+void Display::Draw(const Chip8State &state) {
+  // Convert the framebuffer to RGB
+  for (size_t i = 0; i < state.pixels.size(); i++) {
+    const auto &color = state.pixels[i] ? kOnColor : kOffColor;
+    std::memcpy(&this->pixelBuffer.at(i * 3), color.data(), color.size());
+  }
+
+  glBindTexture(GL_TEXTURE_2D, this->texture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 64, 32, GL_RGB, GL_UNSIGNED_BYTE,
+                  this->pixelBuffer.data());
+
+  glUseProgram(this->shader);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, this->texture);
+
+  glBindVertexArray(this->VAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+#ifdef CHIP8_PROFILER
+void Display::ToggleHeatMap() { this->heatMapVisible = !this->heatMapVisible; }
+#endif
+
+#ifdef CHIP8_PROFILER
+void Display::DrawHeatMap(const Profiler &profiler) {
+  if (!this->heatMapVisible) {
+    return;
+  }
+
+  // Each texel is one address, row by row (64 addresses per row)
+  // The color goes from dark red to yellow on a log scale of the count
+  const auto &counts = profiler.GetPcCounts();
+  const auto maxCount = *std::max_element(counts.begin(), counts.end());
+  const auto scale = std::log1p(static_cast<double>(maxCount));
+
+  for (size_t address = 0; address < counts.size(); address++) {
+    const auto heat =
+        (counts[address] == 0) ? 0.0 : std::log1p(counts[address]) / scale;
+    auto texel = &this->heatMapBuffer.at(address * 4);
+
+    texel[0] = static_cast<uint8_t>(64 + 191 * std::min(1.0, heat * 2));
+    texel[1] = static_cast<uint8_t>(255 * std::max(0.0, heat * 2 - 1));
+    texel[2] = 0;
+    texel[3] = (counts[address] == 0) ? 0x60 : 0xE0;
+  }
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glUseProgram(this->shader);
+  glBindTexture(GL_TEXTURE_2D, this->heatMapTexture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE,
+                  this->heatMapBuffer.data());
+
+  glBindVertexArray(this->heatMapVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+
+  glDisable(GL_BLEND);
+}
+#endif
+
+namespace {
+GLuint compileShader(const std::string &path, GLenum type) {
+  // Load the file
+  auto shaderData = Util::FileReadBinary(path);
+
+  // Add a null terminator because it's a C string
+  shaderData.push_back(0);
+
+  const auto shaderChars = reinterpret_cast<const GLchar *>(shaderData.data());
+  const auto shader = glCreateShader(type);
+
+  glShaderSource(shader, 1, &shaderChars, nullptr);
+  glCompileShader(shader);
+
+  GLint success;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    std::array<GLchar, 512> infoOutput;
+    glGetShaderInfoLog(shader, static_cast<GLsizei>(infoOutput.size()), nullptr,
+                       infoOutput.data());
+    glDeleteShader(shader);
+    throw std::runtime_error("Failed to compile shader " + path + "\n" +
+                             infoOutput.data());
+  }
+
+  return shader;
+}
+
+GLuint linkShader(GLuint vertexShader, GLuint fragmentShader) {
+  const auto program = glCreateProgram();
+
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glLinkProgram(program);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+
+  GLint success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    std::array<GLchar, 512> infoOutput;
+    glGetShaderInfoLog(program, static_cast<GLsizei>(infoOutput.size()),
+                       nullptr, infoOutput.data());
+    glDeleteProgram(program);
+    throw std::runtime_error("Failed to link shaders\n" +
+                             std::string(infoOutput.data()));
+  }
+
+  return program;
+}
+} // namespace
@@ -0,0 +1,47 @@
+#ifndef DISPLAY_H_INCLUDED
+#define DISPLAY_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "Chip8State.h"
+
+#ifdef CHIP8_PROFILER
+#include "Profiler.h"
+#endif
+
+// Renders the CHIP-8 framebuffer with OpenGL
+class Display {
+public:
+  Display() = default;
+  ~Display();
+
+  void Initialize();
+  void Draw(const Chip8State &state);
+
+#ifdef CHIP8_PROFILER
+  void ToggleHeatMap();
+  void DrawHeatMap(const Profiler &profiler);
+#endif
+
+private:
+  GLuint shader = -1;
+  GLuint texture = -1;
+  GLuint VAO = -1;
+  GLuint VBO = -1;
+  GLuint EBO = -1;
+  std::array<uint8_t, 64 * 32 * 3> pixelBuffer = {};
+
+#ifdef CHIP8_PROFILER
+  // Profiler stuff
+  bool heatMapVisible = false;
+  GLuint heatMapTexture = -1;
+  GLuint heatMapVAO = -1;
+  GLuint heatMapVBO = -1;
+  std::array<uint8_t, 64 * 64 * 4> heatMapBuffer = {};
+#endif
+};
+
+#endif // DISPLAY_H_INCLUDED
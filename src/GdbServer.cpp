@@ -0,0 +1,814 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "GdbServer.h"
+
+namespace {
+// Local types
+// Offset and size of a register in the 'g' packet
+struct RegisterLayout {
+  size_t offset;
+  size_t size;
+};
+
+// Constants
+constexpr size_t kRegisterCount = 21;
+constexpr size_t kRegistersSize = 23;
+constexpr size_t kRegisterI = 16;
+constexpr size_t kRegisterPc = 17;
+constexpr size_t kRegisterSp = 18;
+constexpr size_t kRegisterDt = 19;
+constexpr size_t kRegisterSt = 20;
+
+// Largest packet accepted, which fits a read of the whole memory
+constexpr size_t kPacketSize = 2 * Memory::kSize + 64;
+
+// Functions
+#ifdef _WIN32
+using Socket = SOCKET;
+constexpr Socket kInvalidSocket = INVALID_SOCKET;
+#else
+using Socket = int;
+constexpr Socket kInvalidSocket = -1;
+#endif
+
+void closeSocket(Socket socket);
+bool setNonBlocking(Socket socket);
+bool wouldBlock();
+RegisterLayout getRegisterLayout(size_t index);
+std::array<uint8_t, kRegistersSize> getRegisters(const Chip8State &state);
+bool setRegisters(Chip8State &state,
+                  const std::array<uint8_t, kRegistersSize> &registers);
+std::string toHex(const uint8_t *data, size_t size);
+bool fromHex(const std::string &hex, uint8_t *data, size_t size);
+bool parseCondition(std::istringstream &stream,
+                    Debugger::Condition &condition);
+std::string getTargetDescription();
+} // namespace
+
+GdbServer::GdbServer(Chip8 &chip8, uint16_t port, MovieRecorder *recorder)
+    : chip8(chip8), listener(kInvalidSocket), client(kInvalidSocket) {
+  if (recorder != nullptr) {
+    this->timeTravel = std::make_unique<TimeTravel>(chip8, *recorder);
+  }
+
+#ifdef _WIN32
+  static const bool initialized = [] {
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  }();
+  if (!initialized) {
+    throw std::runtime_error("Could not initialize Winsock.");
+  }
+#endif
+
+  this->listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (this->listener == kInvalidSocket) {
+    throw std::runtime_error("Could not create a TCP socket.");
+  }
+
+  const int reuse = 1;
+  setsockopt(this->listener, SOL_SOCKET, SO_REUSEADDR,
+             reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+
+  // Only local debuggers can connect
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+
+  if (bind(this->listener, reinterpret_cast<const sockaddr *>(&address),
+           sizeof(address)) != 0 ||
+      listen(this->listener, 1) != 0 || !setNonBlocking(this->listener)) {
+    closeSocket(this->listener);
+    throw std::runtime_error("Could not listen on TCP port " +
+                             std::to_string(port) + ".");
+  }
+
+  this->chip8.SetDebugger(&this->debugger);
+}
+
+GdbServer::~GdbServer() {
+  this->chip8.SetDebugger(nullptr);
+
+  if (this->client != kInvalidSocket) {
+    closeSocket(this->client);
+  }
+
+  closeSocket(this->listener);
+}
+
+void GdbServer::Poll() {
+  if (this->client == kInvalidSocket) {
+    this->accept();
+  }
+
+  if (this->client != kInvalidSocket) {
+    this->receive();
+  }
+
+  if (this->client != kInvalidSocket && this->running &&
+      this->debugger.IsStopped()) {
+    this->running = false;
+    this->sendPacket(this->getStopReply());
+  }
+}
+
+bool GdbServer::IsConnected() const {
+  return this->client != kInvalidSocket;
+}
+
+void GdbServer::accept() {
+  const auto client = ::accept(this->listener, nullptr, nullptr);
+  if (client == kInvalidSocket) {
+    return;
+  }
+
+  if (!setNonBlocking(client)) {
+    closeSocket(client);
+    return;
+  }
+
+  const int noDelay = 1;
+  setsockopt(client, IPPROTO_TCP, TCP_NODELAY,
+             reinterpret_cast<const char *>(&noDelay), sizeof(noDelay));
+
+  // A new client finds the machine stopped, without breakpoints
+  this->client = client;
+  this->input.clear();
+  this->acknowledge = true;
+  this->running = false;
+  this->debugger.Reset();
+  this->chip8.SetDebugger(&this->debugger);
+}
+
+void GdbServer::disconnect() {
+  closeSocket(this->client);
+  this->client = kInvalidSocket;
+  this->running = false;
+  this->chip8.SetDebugger(nullptr);
+}
+
+void GdbServer::receive() {
+  std::array<char, 4096> buffer;
+  while (true) {
+    const auto received =
+        recv(this->client, buffer.data(), static_cast<int>(buffer.size()), 0);
+    if (received > 0) {
+      this->input.append(buffer.data(), static_cast<size_t>(received));
+      continue;
+    }
+
+    if (received == 0 || !wouldBlock()) {
+      this->disconnect();
+      return;
+    }
+
+    break;
+  }
+
+  // Packets are "$<data>#<checksum>"; anything else is an acknowledgement
+  // or an interrupt (Ctrl-C)
+  while (!this->input.empty() && this->client != kInvalidSocket) {
+    if (this->input[0] == '\x03') {
+      this->input.erase(0, 1);
+      if (this->running) {
+        this->debugger.Interrupt();
+      }
+      continue;
+    }
+
+    if (this->input[0] != '$') {
+      this->input.erase(0, 1);
+      continue;
+    }
+
+    const auto end = this->input.find('#');
+    if (end == std::string::npos || end + 2 >= this->input.size()) {
+      if (this->input.size() > kPacketSize) {
+        this->input.clear();
+      }
+      break;
+    }
+
+    const auto data = this->input.substr(1, end - 1);
+    uint8_t checksum = 0;
+    for (const auto c : data) {
+      checksum = static_cast<uint8_t>(checksum + c);
+    }
+
+    uint8_t expected = 0;
+    const auto valid = fromHex(this->input.substr(end + 1, 2), &expected, 1) &&
+                       expected == checksum;
+    this->input.erase(0, end + 3);
+
+    if (this->acknowledge) {
+      this->send(valid ? "+" : "-");
+    }
+
+    if (!valid) {
+      continue;
+    }
+
+    // Malformed numbers are errors for the client, not for the machine
+    try {
+      this->handlePacket(data);
+    } catch (const std::exception &) {
+      this->sendPacket("E01");
+    }
+  }
+}
+
+void GdbServer::handlePacket(const std::string &packet) {
+  if (packet.empty()) {
+    this->sendPacket("");
+    return;
+  }
+
+  if (packet == "QStartNoAckMode") {
+    // This reply is still acknowledged
+    this->sendPacket("OK");
+    this->acknowledge = false;
+    return;
+  }
+
+  const auto arguments = packet.substr(1);
+  switch (packet[0]) {
+  case '?':
+    this->sendPacket(this->getStopReply());
+    break;
+
+  case 'g':
+    this->sendPacket(this->readRegisters());
+    break;
+
+  case 'G':
+    this->sendPacket(this->writeRegisters(arguments));
+    break;
+
+  case 'p':
+  case 'P': {
+    // p<n> reads a register, P<n>=<value> writes it
+    const auto index = std::stoul(arguments, nullptr, 16);
+    if (index >= kRegisterCount) {
+      this->sendPacket("E01");
+      break;
+    }
+
+    const auto layout = getRegisterLayout(index);
+    auto registers = getRegisters(this->chip8.GetState());
+    if (packet[0] == 'p') {
+      this->sendPacket(toHex(registers.data() + layout.offset, layout.size));
+      break;
+    }
+
+    const auto equals = arguments.find('=');
+    if (equals == std::string::npos ||
+        !fromHex(arguments.substr(equals + 1),
+                 registers.data() + layout.offset, layout.size)) {
+      this->sendPacket("E01");
+      break;
+    }
+
+    this->sendPacket(this->writeRegisters(
+        toHex(registers.data(), registers.size())));
+    break;
+  }
+
+  case 'm':
+    this->sendPacket(this->readMemory(arguments));
+    break;
+
+  case 'M':
+    this->sendPacket(this->writeMemory(arguments));
+    break;
+
+  case 'c':
+    this->debugger.Continue();
+    this->running = true;
+    break;
+
+  case 's':
+    this->debugger.Step();
+    this->running = true;
+    break;
+
+  case 'b': {
+    // Reverse-step (bs) and reverse-continue (bc) stop right away, at the
+    // beginning of the recording at worst
+    if (!this->timeTravel || (packet != "bs" && packet != "bc")) {
+      this->sendPacket("");
+      break;
+    }
+
+    auto &timeTravel = *this->timeTravel;
+    const auto found = (packet == "bs")
+                           ? timeTravel.ReverseStep(this->debugger)
+                           : timeTravel.ReverseContinue(this->debugger);
+    this->sendPacket(found ? this->getStopReply() : "T05replaylog:begin;");
+    break;
+  }
+
+  case 'Z':
+  case 'z':
+    this->sendPacket(this->handleBreakpoint(packet));
+    break;
+
+  case 'q':
+  case 'Q':
+    this->sendPacket(this->handleQuery(packet));
+    break;
+
+  case 'H':
+  case 'T':
+    this->sendPacket("OK");
+    break;
+
+  case 'D':
+    // The machine runs on without a debugger
+    this->sendPacket("OK");
+    this->disconnect();
+    break;
+
+  case 'k':
+    this->disconnect();
+    break;
+
+  default:
+    // Unsupported, including the v packets
+    this->sendPacket("");
+    break;
+  }
+}
+
+std::string GdbServer::handleQuery(const std::string &packet) {
+  if (packet.rfind("qSupported", 0) == 0) {
+    std::array<char, 128> reply;
+    std::snprintf(reply.data(), reply.size(),
+                  "PacketSize=%zx;qXfer:features:read+;swbreak+;"
+                  "QStartNoAckMode+%s",
+                  kPacketSize,
+                  this->timeTravel ? ";ReverseStep+;ReverseContinue+" : "");
+    return reply.data();
+  }
+
+  if (packet == "qAttached") {
+    return "1";
+  }
+
+  if (packet == "qC") {
+    return "QC1";
+  }
+
+  if (packet == "qfThreadInfo") {
+    return "m1";
+  }
+
+  if (packet == "qsThreadInfo") {
+    return "l";
+  }
+
+  if (packet == "qSymbol::") {
+    return "OK";
+  }
+
+  // qRcmd,<command in hex>
+  const std::string monitor = "qRcmd,";
+  if (packet.rfind(monitor, 0) == 0) {
+    std::string command((packet.size() - monitor.size()) / 2, '\0');
+    if (!fromHex(packet.substr(monitor.size()),
+                 reinterpret_cast<uint8_t *>(&command[0]), command.size())) {
+      return "E01";
+    }
+
+    return this->handleMonitor(command);
+  }
+
+  // qXfer:features:read:target.xml:<offset>,<length>
+  const std::string xfer = "qXfer:features:read:target.xml:";
+  if (packet.rfind(xfer, 0) == 0) {
+    const auto arguments = packet.substr(xfer.size());
+    const auto comma = arguments.find(',');
+    if (comma == std::string::npos) {
+      return "E01";
+    }
+
+    const auto description = getTargetDescription();
+    const auto offset = std::stoul(arguments.substr(0, comma), nullptr, 16);
+    const auto length = std::stoul(arguments.substr(comma + 1), nullptr, 16);
+    if (offset >= description.size()) {
+      return "l";
+    }
+
+    const auto chunk = description.substr(offset, length);
+    return ((offset + chunk.size() < description.size()) ? "m" : "l") + chunk;
+  }
+
+  return {};
+}
+
+std::string GdbServer::handleBreakpoint(const std::string &packet) {
+  // Z<type>,<address>,<kind> inserts, z<type>,<address>,<kind> removes
+  const auto first = packet.find(',');
+  const auto second = packet.find(',', first + 1);
+  if (packet.size() < 2 || first == std::string::npos ||
+      second == std::string::npos) {
+    return "E01";
+  }
+
+  const auto address = std::stoul(
+      packet.substr(first + 1, second - first - 1), nullptr, 16);
+  const auto kind = std::stoul(packet.substr(second + 1), nullptr, 16);
+  if (address >= Memory::kSize || kind > Memory::kSize) {
+    return "E01";
+  }
+
+  const auto insert = packet[0] == 'Z';
+  const auto watch = [&](Debugger::WatchType type) {
+    if (insert) {
+      this->debugger.AddWatchpoint(type, static_cast<uint16_t>(address),
+                                   static_cast<uint16_t>(kind));
+    } else {
+      this->debugger.RemoveWatchpoint(type, static_cast<uint16_t>(address),
+                                      static_cast<uint16_t>(kind));
+    }
+  };
+
+  switch (packet[1]) {
+  case '0':
+  case '1':
+    if (insert) {
+      this->debugger.AddBreakpoint(static_cast<uint16_t>(address));
+    } else {
+      this->debugger.RemoveBreakpoint(static_cast<uint16_t>(address));
+    }
+    return "OK";
+
+  case '2':
+    watch(Debugger::WatchType::kWrite);
+    return "OK";
+
+  case '3':
+    watch(Debugger::WatchType::kRead);
+    return "OK";
+
+  case '4':
+    watch(Debugger::WatchType::kAccess);
+    return "OK";
+
+  default:
+    return {};
+  }
+}
+
+std::string GdbServer::handleMonitor(const std::string &command) {
+  std::istringstream stream(command);
+  std::string name;
+  stream >> name;
+
+  if (name == "break") {
+    Debugger::Condition condition;
+    if (parseCondition(stream, condition)) {
+      this->debugger.AddCondition(condition);
+      return "OK";
+    }
+  } else if (name == "delete" && stream.peek() == EOF) {
+    this->debugger.ClearConditions();
+    return "OK";
+  }
+
+  // Console output for the user, then the reply
+  const std::string usage =
+      "Usage: monitor break <register> <==|!=|<|<=|>|>=> <value>\n"
+      "       monitor delete\n";
+  this->sendPacket(
+      "O" + toHex(reinterpret_cast<const uint8_t *>(usage.data()),
+                  usage.size()));
+  return "OK";
+}
+
+std::string GdbServer::readRegisters() const {
+  const auto registers = getRegisters(this->chip8.GetState());
+  return toHex(registers.data(), registers.size());
+}
+
+std::string GdbServer::writeRegisters(const std::string &hex) {
+  std::array<uint8_t, kRegistersSize> registers;
+  auto state = this->chip8.GetState();
+  if (!fromHex(hex, registers.data(), registers.size()) ||
+      !setRegisters(state, registers)) {
+    return "E01";
+  }
+
+  this->chip8.SetState(state);
+  if (this->timeTravel) {
+    this->timeTravel->OnStateChanged();
+  }
+
+  return "OK";
+}
+
+std::string GdbServer::readMemory(const std::string &arguments) const {
+  // <address>,<length>; reads stop at the end of memory
+  const auto comma = arguments.find(',');
+  if (comma == std::string::npos) {
+    return "E01";
+  }
+
+  const auto address = std::stoul(arguments.substr(0, comma), nullptr, 16);
+  const auto length = std::stoul(arguments.substr(comma + 1), nullptr, 16);
+  if (address >= Memory::kSize) {
+    return "E01";
+  }
+
+  std::vector<uint8_t> data(std::min<size_t>(length, Memory::kSize - address));
+  this->chip8.GetState().memory.Read(static_cast<uint16_t>(address),
+                                     data.data(), data.size());
+  return toHex(data.data(), data.size());
+}
+
+std::string GdbServer::writeMemory(const std::string &arguments) {
+  // <address>,<length>:<data>
+  const auto comma = arguments.find(',');
+  const auto colon = arguments.find(':');
+  if (comma == std::string::npos || colon == std::string::npos) {
+    return "E01";
+  }
+
+  const auto address = std::stoul(arguments.substr(0, comma), nullptr, 16);
+  const auto length = std::stoul(
+      arguments.substr(comma + 1, colon - comma - 1), nullptr, 16);
+  if (address >= Memory::kSize || length > Memory::kSize - address) {
+    return "E01";
+  }
+
+  std::vector<uint8_t> data(length);
+  if (!fromHex(arguments.substr(colon + 1), data.data(), data.size())) {
+    return "E01";
+  }
+
+  auto state = this->chip8.GetState();
+  state.memory.Write(static_cast<uint16_t>(address), data.data(),
+                     data.size());
+  this->chip8.SetState(state);
+  if (this->timeTravel) {
+    this->timeTravel->OnStateChanged();
+  }
+
+  return "OK";
+}
+
+std::string GdbServer::getStopReply() const {
+  const auto &stop = this->debugger.GetStop();
+
+  std::array<char, 64> reply;
+  auto length = std::snprintf(reply.data(), reply.size(), "T%02x",
+                              static_cast<unsigned int>(stop.signal));
+
+  if (stop.breakpoint) {
+    length += std::snprintf(reply.data() + length, reply.size() - length,
+                            "swbreak:;");
+  }
+
+  if (stop.watchpoint) {
+    const auto name = (stop.watchType == Debugger::WatchType::kWrite) ? "watch"
+                      : (stop.watchType == Debugger::WatchType::kRead)
+                          ? "rwatch"
+                          : "awatch";
+    std::snprintf(reply.data() + length, reply.size() - length, "%s:%x;",
+                  name, stop.watchAddress);
+  }
+
+  return reply.data();
+}
+
+void GdbServer::sendPacket(const std::string &data) {
+  uint8_t checksum = 0;
+  for (const auto c : data) {
+    checksum = static_cast<uint8_t>(checksum + c);
+  }
+
+  std::array<char, 4> trailer;
+  std::snprintf(trailer.data(), trailer.size(), "#%02x", checksum);
+  this->send("$" + data + trailer.data());
+}
+
+void GdbServer::send(const std::string &data) {
+#ifdef MSG_NOSIGNAL
+  constexpr int kFlags = MSG_NOSIGNAL;
+#else
+  constexpr int kFlags = 0;
+#endif
+
+  // Replies are small, so waiting for the socket to take them is fine
+  size_t sent = 0;
+  while (sent < data.size() && this->client != kInvalidSocket) {
+    const auto result =
+        ::send(this->client, data.data() + sent,
+               static_cast<int>(data.size() - sent), kFlags);
+    if (result > 0) {
+      sent += static_cast<size_t>(result);
+    } else if (!wouldBlock()) {
+      this->disconnect();
+    }
+  }
+}
+
+namespace {
+void closeSocket(Socket socket) {
+#ifdef _WIN32
+  closesocket(socket);
+#else
+  close(socket);
+#endif
+}
+
+bool setNonBlocking(Socket socket) {
+#ifdef _WIN32
+  u_long nonBlocking = 1;
+  return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+#else
+  return fcntl(socket, F_SETFL, O_NONBLOCK) == 0;
+#endif
+}
+
+bool wouldBlock() {
+#ifdef _WIN32
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+RegisterLayout getRegisterLayout(size_t index) {
+  // V0-VF, then I, PC, SP, DT and ST
+  if (index < kRegisterI) {
+    return {index, 1};
+  }
+
+  switch (index) {
+  case kRegisterI:
+    return {16, 2};
+  case kRegisterPc:
+    return {18, 2};
+  default:
+    return {20 + index - kRegisterSp, 1};
+  }
+}
+
+std::array<uint8_t, kRegistersSize> getRegisters(const Chip8State &state) {
+  // 16-bit registers are little-endian, as GDB expects the target's order
+  std::array<uint8_t, kRegistersSize> registers;
+  std::copy(state.V.begin(), state.V.end(), registers.begin());
+  registers[16] = static_cast<uint8_t>(state.I);
+  registers[17] = static_cast<uint8_t>(state.I >> 8);
+  registers[18] = static_cast<uint8_t>(state.PC);
+  registers[19] = static_cast<uint8_t>(state.PC >> 8);
+  registers[20] = state.SP;
+  registers[21] = state.delayTimer;
+  registers[22] = state.soundTimer;
+  return registers;
+}
+
+bool setRegisters(Chip8State &state,
+                  const std::array<uint8_t, kRegistersSize> &registers) {
+  if (registers[20] > state.stack.size()) {
+    return false;
+  }
+
+  std::copy(registers.begin(), registers.begin() + 16, state.V.begin());
+  state.I = static_cast<uint16_t>(registers[16] | (registers[17] << 8));
+  state.PC = static_cast<uint16_t>(registers[18] | (registers[19] << 8));
+  state.SP = registers[20];
+  state.delayTimer = registers[21];
+  state.soundTimer = registers[22];
+  return true;
+}
+
+std::string toHex(const uint8_t *data, size_t size) {
+  constexpr const char *kDigits = "0123456789abcdef";
+
+  std::string hex;
+  hex.reserve(size * 2);
+  for (size_t i = 0; i < size; i++) {
+    hex += kDigits[data[i] >> 4];
+    hex += kDigits[data[i] & 0x0F];
+  }
+
+  return hex;
+}
+
+bool fromHex(const std::string &hex, uint8_t *data, size_t size) {
+  if (hex.size() != size * 2) {
+    return false;
+  }
+
+  const auto digit = [](char c) {
+    return (c >= '0' && c <= '9')   ? c - '0'
+           : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+           : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+                                    : -1;
+  };
+
+  for (size_t i = 0; i < size; i++) {
+    const auto high = digit(hex[i * 2]);
+    const auto low = digit(hex[i * 2 + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+
+    data[i] = static_cast<uint8_t>((high << 4) | low);
+  }
+
+  return true;
+}
+
+bool parseCondition(std::istringstream &stream,
+                    Debugger::Condition &condition) {
+  std::string reg;
+  std::string comparison;
+  std::string value;
+  std::string rest;
+  if (!(stream >> reg >> comparison >> value) || (stream >> rest)) {
+    return false;
+  }
+
+  if (reg.size() == 2 && reg[0] == 'v' &&
+      std::isxdigit(static_cast<unsigned char>(reg[1]))) {
+    condition.reg =
+        static_cast<uint8_t>(std::stoul(reg.substr(1), nullptr, 16));
+  } else if (reg == "i") {
+    condition.reg = Debugger::kRegisterI;
+  } else if (reg == "pc") {
+    condition.reg = Debugger::kRegisterPc;
+  } else if (reg == "sp") {
+    condition.reg = Debugger::kRegisterSp;
+  } else if (reg == "dt") {
+    condition.reg = Debugger::kRegisterDt;
+  } else if (reg == "st") {
+    condition.reg = Debugger::kRegisterSt;
+  } else {
+    return false;
+  }
+
+  if (comparison == "==") {
+    condition.comparison = Debugger::Comparison::kEqual;
+  } else if (comparison == "!=") {
+    condition.comparison = Debugger::Comparison::kNotEqual;
+  } else if (comparison == "<") {
+    condition.comparison = Debugger::Comparison::kLess;
+  } else if (comparison == "<=") {
+    condition.comparison = Debugger::Comparison::kLessEqual;
+  } else if (comparison == ">") {
+    condition.comparison = Debugger::Comparison::kGreater;
+  } else if (comparison == ">=") {
+    condition.comparison = Debugger::Comparison::kGreaterEqual;
+  } else {
+    return false;
+  }
+
+  // Decimal, or hexadecimal with 0x
+  condition.value = static_cast<uint16_t>(std::stoul(value, nullptr, 0));
+  return true;
+}
+
+std::string getTargetDescription() {
+  std::string description =
+      "<?xml version=\"1.0\"?>"
+      "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+      "<target version=\"1.0\"><feature name=\"org.chip8.cpu\">";
+
+  std::array<char, 96> reg;
+  for (int i = 0; i < 16; i++) {
+    std::snprintf(reg.data(), reg.size(),
+                  "<reg name=\"v%x\" bitsize=\"8\" type=\"uint8\"/>", i);
+    description += reg.data();
+  }
+
+  description += "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+                 "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+                 "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+                 "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>"
+                 "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>"
+                 "</feature></target>";
+  return description;
+}
+} // namespace
@@ -0,0 +1,78 @@
+#ifndef GDB_SERVER_H_INCLUDED
+#define GDB_SERVER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Chip8.h"
+#include "Debugger.h"
+#include "TimeTravel.h"
+
+// GDB remote serial protocol server for a machine, on a local TCP port
+// (target remote localhost:<port>)
+//
+// Registers, in order: V0-VF (8 bits), I and PC (16 bits), SP, DT and ST
+// (8 bits), described to GDB by a target description. Memory is the 4 KB
+// address space. Supports software breakpoints (Z0), write, read and access
+// watchpoints (Z2-Z4), single-step, continue and interrupt (Ctrl-C).
+// Register conditions are set with monitor commands:
+//   monitor break <register> <==|!=|<|<=|>|>=> <value>
+//   monitor delete
+// With a movie recorder on the machine from power-on, reverse-step and
+// reverse-continue (bs, bc) go back in time (see TimeTravel).
+//
+// The machine is stopped while a client is connected and hasn't resumed it,
+// including from the start until the first client connects. Without a
+// client, the debugger is detached from the machine.
+class GdbServer {
+public:
+  GdbServer(Chip8 &chip8, uint16_t port, MovieRecorder *recorder = nullptr);
+  ~GdbServer();
+
+  GdbServer(const GdbServer &) = delete;
+  GdbServer &operator=(const GdbServer &) = delete;
+
+  // Accepts a client, handles its packets and reports stops; never blocks
+  void Poll();
+
+  [[nodiscard]] bool IsConnected() const;
+
+private:
+  void accept();
+  void disconnect();
+  void receive();
+  void handlePacket(const std::string &packet);
+  std::string handleQuery(const std::string &packet);
+  std::string handleBreakpoint(const std::string &packet);
+  std::string handleMonitor(const std::string &command);
+  std::string readRegisters() const;
+  std::string writeRegisters(const std::string &hex);
+  std::string readMemory(const std::string &arguments) const;
+  std::string writeMemory(const std::string &arguments);
+  std::string getStopReply() const;
+  void sendPacket(const std::string &data);
+  void send(const std::string &data);
+
+private:
+  Chip8 &chip8;
+  Debugger debugger;
+  std::unique_ptr<TimeTravel> timeTravel;
+
+  std::string input;
+  bool acknowledge = true;
+
+  // Whether a stop must be reported once the machine stops
+  bool running = false;
+
+#ifdef _WIN32
+  uintptr_t listener;
+  uintptr_t client;
+#else
+  int listener = -1;
+  int client = -1;
+#endif
+};
+
+#endif // GDB_SERVER_H_INCLUDED
@@ -0,0 +1,453 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "Interpreter.h"
+
+namespace {
+// Functions
+template <bool kChecked> Fault execute(Chip8State &state);
+template <bool kChecked>
+uint64_t run(Chip8State &state, uint64_t count, Fault &fault);
+uint32_t nextRandom(Chip8State &state);
+} // namespace
+
+namespace Interpreter {
+Fault ExecuteOneInstruction(Chip8State &state) {
+  return execute<true>(state);
+}
+
+Fault ExecuteUnchecked(Chip8State &state) {
+  return execute<false>(state);
+}
+} // namespace Interpreter
+
+Fault VerifiedBackend::Step(Chip8State &state) {
+  if (this->stale) {
+    this->update(state);
+  }
+
+  return this->unchecked ? Interpreter::ExecuteUnchecked(state)
+                         : Interpreter::ExecuteOneInstruction(state);
+}
+
+uint64_t VerifiedBackend::Run(Chip8State &state, uint64_t count,
+                              Fault &fault) {
+  if (this->stale) {
+    this->update(state);
+  }
+
+  // Every state reached from a covered one is covered too
+  return this->unchecked ? run<false>(state, count, fault)
+                         : run<true>(state, count, fault);
+}
+
+void VerifiedBackend::update(const Chip8State &state) {
+  this->stale = false;
+
+  // Restoring a snapshot or resetting keeps the code, and the proof
+  if (!this->analysis || !this->analysis->MatchesCode(state.memory)) {
+    this->analysis = BoundsAnalysis::Analyze(state);
+  }
+
+  this->unchecked = this->analysis->proven && this->analysis->Covers(state);
+}
+
+namespace {
+template <bool kChecked> Fault execute(Chip8State &state) {
+  if (kChecked && state.PC >= Memory::kSize - 1) {
+    return Fault::kMemoryAccess;
+  }
+
+  uint16_t opcode;
+  if constexpr (kChecked) {
+    opcode = state.memory.ReadWord(state.PC);
+  } else {
+    opcode = state.memory.ReadWordUnchecked(state.PC);
+  }
+
+  state.PC += 2;
+
+  // Faults are checked before anything else changes, so only the PC needs to
+  // be moved back
+  const auto fail = [&state](Fault fault) {
+    state.PC -= 2;
+    return fault;
+  };
+
+  // Register numbers are 4 bits, but the checked variant is the reference
+  const auto reg = [&state](size_t index) -> uint8_t & {
+    if constexpr (kChecked) {
+      return state.V.at(index);
+    } else {
+      return state.V[index];
+    }
+  };
+
+  // Likewise for the keypad, the framebuffer and memory
+  const auto key = [&state](size_t index) -> bool & {
+    if constexpr (kChecked) {
+      return state.keys.at(index);
+    } else {
+      return state.keys[index];
+    }
+  };
+
+  const auto pixel = [&state](size_t index) -> bool & {
+    if constexpr (kChecked) {
+      return state.pixels.at(index);
+    } else {
+      return state.pixels[index];
+    }
+  };
+
+  const auto read = [&state](size_t address, uint8_t *bytes, size_t count) {
+    if constexpr (kChecked) {
+      state.memory.Read(address, bytes, count);
+    } else {
+      state.memory.ReadUnchecked(address, bytes, count);
+    }
+  };
+
+  const auto write = [&state](size_t address, const uint8_t *bytes,
+                              size_t count) {
+    if constexpr (kChecked) {
+      state.memory.Write(address, bytes, count);
+    } else {
+      state.memory.WriteUnchecked(address, bytes, count);
+    }
+  };
+
+  switch (opcode & 0xF000) {
+  case 0x0000:
+    switch (opcode) {
+    case 0x00E0:
+      state.pixels.fill(false);
+      break;
+
+    case 0x00EE:
+      if (state.SP == 0) {
+        return fail(Fault::kStackUnderflow);
+      }
+
+      state.PC = state.stack[--state.SP];
+      break;
+
+    default:
+      break;
+    }
+    break;
+
+  case 0x1000:
+    state.PC = opcode & 0x0FFF;
+    break;
+
+  case 0x2000:
+    if (state.SP == state.stack.size()) {
+      // Some ROMs (e.g. INVADERS) leak stack entries; drop the oldest one,
+      // which will never be returned to
+      std::memmove(&state.stack[0], &state.stack[1],
+                   (state.stack.size() - 1) * sizeof(uint16_t));
+      --state.SP;
+    }
+
+    state.stack[state.SP++] = state.PC;
+    state.PC = opcode & 0x0FFF;
+    break;
+
+  case 0x3000:
+    if (reg((opcode & 0x0F00) >> 8) == (opcode & 0x00FF)) {
+      state.PC += 2;
+    }
+    break;
+
+  case 0x4000:
+    if (reg((opcode & 0x0F00) >> 8) != (opcode & 0x00FF)) {
+      state.PC += 2;
+    }
+    break;
+
+  case 0x5000:
+    if (reg((opcode & 0x0F00) >> 8) == reg((opcode & 0x00F0) >> 4)) {
+      state.PC += 2;
+    }
+    break;
+
+  case 0x6000:
+    reg((opcode & 0x0F00) >> 8) = opcode & 0x00FF;
+    break;
+
+  case 0x7000:
+    reg((opcode & 0x0F00) >> 8) += opcode & 0x00FF;
+    break;
+
+  case 0x8000: {
+    switch (opcode & 0x000F) {
+    case 0x0000:
+      reg((opcode & 0x0F00) >> 8) = reg((opcode & 0x00F0) >> 4);
+      break;
+
+    case 0x0001:
+      reg((opcode & 0x0F00) >> 8) |= reg((opcode & 0x00F0) >> 4);
+      break;
+
+    case 0x0002:
+      reg((opcode & 0x0F00) >> 8) &= reg((opcode & 0x00F0) >> 4);
+      break;
+
+    case 0x0003:
+      reg((opcode & 0x0F00) >> 8) ^= reg((opcode & 0x00F0) >> 4);
+      break;
+
+    case 0x0004: {
+      int16_t sum = reg((opcode & 0x0F00) >> 8) + reg((opcode & 0x00F0) >> 4);
+
+      if (sum >= 256) {
+        reg(0xF) = 1;
+        sum -= 256;
+      } else {
+        reg(0xF) = 0;
+      }
+
+      reg((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(sum);
+    } break;
+
+    case 0x0005: {
+      int16_t diff = reg((opcode & 0x0F00) >> 8) - reg((opcode & 0x00F0) >> 4);
+
+      if (diff < 0) {
+        diff += 256;
+        reg(0xF) = 0;
+      } else {
+        reg(0xF) = 1;
+      }
+
+      reg((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(diff);
+    } break;
+
+    case 0x0006:
+      reg(0xF) = reg((opcode & 0x0F00) >> 8) & 0x1;
+      reg((opcode & 0x0F00) >> 8) >>= 1;
+      break;
+
+    case 0x0007: {
+      int16_t diff = reg((opcode & 0x00F0) >> 4) - reg((opcode & 0x0F00) >> 8);
+
+      if (diff < 0) {
+        diff += 256;
+        reg(0xF) = 0;
+      } else {
+        reg(0xF) = 1;
+      }
+
+      reg((opcode & 0x0F00) >> 8) = static_cast<uint8_t>(diff);
+    } break;
+
+    case 0x000E:
+      reg(0xF) = reg((opcode & 0x0F00) >> 8) & 0x80;
+      reg((opcode & 0x0F00) >> 8) <<= 1;
+      break;
+
+    default:
+      return fail(Fault::kInvalidOpcode);
+    }
+  } break;
+
+  case 0x9000:
+    if (reg((opcode & 0x0F00) >> 8) != reg((opcode & 0x00F0) >> 4))
+      state.PC += 2;
+    break;
+
+  case 0xA000:
+    state.I = opcode & 0x0FFF;
+    break;
+
+  case 0xB000:
+    state.PC = (opcode & 0x0FFF) + reg(0);
+    break;
+
+  case 0xC000:
+    reg((opcode & 0x0F00) >> 8) =
+        static_cast<uint8_t>(nextRandom(state) & opcode);
+    break;
+
+  case 0xD000: {
+    const auto xStart = reg((opcode & 0x0F00) >> 8);
+    const auto yStart = reg((opcode & 0x00F0) >> 4);
+    const size_t height = opcode & 0x000F;
+
+    if (kChecked && state.I + height > Memory::kSize) {
+      return fail(Fault::kMemoryAccess);
+    }
+
+    reg(0xF) = 0;
+
+    for (uint8_t yOffset = 0; yOffset < height; yOffset++) {
+      const auto data = state.memory[state.I + yOffset];
+
+      for (uint8_t xOffset = 0; xOffset < 8; xOffset++) {
+        if ((data & (0x80 >> xOffset)) != 0) {
+          // Toggle the pixel, wrapping around the screen
+          auto &target = pixel(((yStart + yOffset) % 32) * 64 +
+                               ((xStart + xOffset) % 64));
+          if (target) {
+            reg(0xF) = 1;
+          }
+
+          target = !target;
+        }
+      }
+    }
+  } break;
+
+  case 0xE000: {
+    switch (opcode & 0x00FF) {
+    case 0x009E:
+      if (reg((opcode & 0x0F00) >> 8) >= state.keys.size()) {
+        return fail(Fault::kInvalidKey);
+      }
+
+      if (key(reg((opcode & 0x0F00) >> 8))) {
+        state.PC += 2;
+      }
+      break;
+
+    case 0x00A1:
+      if (reg((opcode & 0x0F00) >> 8) >= state.keys.size()) {
+        return fail(Fault::kInvalidKey);
+      }
+
+      if (!key(reg((opcode & 0x0F00) >> 8))) {
+        state.PC += 2;
+      }
+      break;
+
+    default:
+      return fail(Fault::kInvalidOpcode);
+    }
+  } break;
+
+  case 0xF000: {
+    switch (opcode & 0x00FF) {
+    case 0x0002:
+      // XO-CHIP: load the 16-byte audio pattern at I
+      if (opcode != 0xF002) {
+        return fail(Fault::kInvalidOpcode);
+      }
+
+      if (kChecked && state.I + state.audioPattern.size() > Memory::kSize) {
+        return fail(Fault::kMemoryAccess);
+      }
+
+      read(state.I, state.audioPattern.data(), state.audioPattern.size());
+      state.audioPatternLoaded = true;
+      break;
+
+    case 0x0007:
+      reg((opcode & 0x0F00) >> 8) = state.delayTimer;
+      break;
+
+    case 0x000A: {
+      bool keyPressed = false;
+
+      for (uint8_t index = 0; index < state.keys.size(); index++) {
+        if (key(index)) {
+          keyPressed = true;
+          reg((opcode & 0x0F00) >> 8) = index;
+          break;
+        }
+      }
+
+      if (!keyPressed) {
+        state.PC -= 2;
+      }
+    } break;
+
+    case 0x0015:
+      state.delayTimer = reg((opcode & 0x0F00) >> 8);
+      break;
+
+    case 0x0018:
+      state.soundTimer = reg((opcode & 0x0F00) >> 8);
+      break;
+
+    case 0x001E:
+      state.I += reg((opcode & 0x0F00) >> 8);
+      break;
+
+    case 0x0029:
+      state.I = reg((opcode & 0x0F00) >> 8) * 5;
+      break;
+
+    case 0x0033: {
+      auto value = reg((opcode & 0x0F00) >> 8);
+      std::array<uint8_t, 3> digits;
+      for (int i = 3; i > 0; --i) {
+        digits[i - 1] = value % 10;
+        value /= 10;
+      }
+
+      if (kChecked && state.I + digits.size() > Memory::kSize) {
+        return fail(Fault::kMemoryAccess);
+      }
+
+      write(state.I, digits.data(), digits.size());
+    } break;
+
+    case 0x003A:
+      // XO-CHIP: set the audio pattern playback rate
+      state.audioPitch = reg((opcode & 0x0F00) >> 8);
+      break;
+
+    case 0x0055: {
+      const size_t count = ((opcode & 0x0F00) >> 8) + 1;
+      if (kChecked && state.I + count > Memory::kSize) {
+        return fail(Fault::kMemoryAccess);
+      }
+
+      write(state.I, state.V.data(), count);
+    } break;
+
+    case 0x0065: {
+      const size_t count = ((opcode & 0x0F00) >> 8) + 1;
+      if (kChecked && state.I + count > Memory::kSize) {
+        return fail(Fault::kMemoryAccess);
+      }
+
+      read(state.I, state.V.data(), count);
+    } break;
+
+    default:
+      return fail(Fault::kInvalidOpcode);
+    }
+  } break;
+
+  default:
+    return fail(Fault::kInvalidOpcode);
+  }
+
+  return Fault::kNone;
+}
+
+template <bool kChecked>
+uint64_t run(Chip8State &state, uint64_t count, Fault &fault) {
+  for (uint64_t i = 0; i < count; i++) {
+    fault = execute<kChecked>(state);
+    if (fault != Fault::kNone) {
+      return i;
+    }
+  }
+
+  return count;
+}
+
+uint32_t nextRandom(Chip8State &state) {
+  // xorshift32
+  auto x = state.randomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state.randomState = x;
+  return x;
+}
+} // namespace
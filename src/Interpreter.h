@@ -0,0 +1,68 @@
+#ifndef INTERPRETER_H_INCLUDED
+#define INTERPRETER_H_INCLUDED
+
+#include <optional>
+
+#include "BoundsAnalysis.h"
+#include "Chip8State.h"
+#include "CpuBackend.h"
+
+namespace Interpreter {
+// The reference implementation of every instruction
+// A faulting instruction returns the fault and leaves the state unchanged
+// A call with a full stack isn't a fault: some ROMs (e.g. INVADERS) leak an
+// entry on every call they never return from, so the oldest entry is dropped
+// instead, which recorded movies of them depend on
+[[nodiscard]] Fault ExecuteOneInstruction(Chip8State &state);
+
+// The same without checking the PC, or I before memory accesses, which is
+// only valid for states covered by a BoundsAnalysis proof
+[[nodiscard]] Fault ExecuteUnchecked(Chip8State &state);
+} // namespace Interpreter
+
+// Backend that runs the reference interpreter
+class InterpreterBackend : public CpuBackend {
+public:
+  [[nodiscard]] const char *GetName() const override { return "interpreter"; }
+
+  Fault Step(Chip8State &state) override {
+    return Interpreter::ExecuteOneInstruction(state);
+  }
+
+  uint64_t Run(Chip8State &state, uint64_t count,
+               Fault &fault) override {
+    for (uint64_t i = 0; i < count; i++) {
+      fault = Interpreter::ExecuteOneInstruction(state);
+      if (fault != Fault::kNone) {
+        return i;
+      }
+    }
+
+    return count;
+  }
+};
+
+// Backend that runs the interpreter without range checks while the state is
+// covered by a proof, found when the code changes (loading a ROM), and with
+// them otherwise
+class VerifiedBackend : public CpuBackend {
+public:
+  [[nodiscard]] const char *GetName() const override { return "verified"; }
+
+  Fault Step(Chip8State &state) override;
+  uint64_t Run(Chip8State &state, uint64_t count,
+               Fault &fault) override;
+
+  // The proof is checked against the state again on next use
+  void Invalidate() override { this->stale = true; }
+
+private:
+  void update(const Chip8State &state);
+
+private:
+  std::optional<BoundsAnalysis> analysis;
+  bool unchecked = false;
+  bool stale = true;
+};
+
+#endif // INTERPRETER_H_INCLUDED
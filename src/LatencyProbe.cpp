@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+#include "LatencyProbe.h"
+
+namespace {
+// Constants
+constexpr double kBucketWidth = 0.1;
+
+// Events that haven't been applied, or haven't changed the framebuffer, after
+// this long never will
+constexpr auto kAbandonTime = std::chrono::seconds(1);
+
+constexpr std::array<const char *, LatencyProbe::kStageCount> kStageNames = {
+    "Applied by the CPU", "Framebuffer changed", "Texture uploaded",
+    "Buffers swapped"};
+} // namespace
+
+void LatencyHistogram::Add(std::chrono::steady_clock::duration latency) {
+  const auto milliseconds =
+      std::chrono::duration<double, std::milli>(latency).count();
+  const auto bucket = static_cast<size_t>(milliseconds / kBucketWidth);
+
+  ++this->buckets.at(std::min(bucket, this->buckets.size() - 1));
+  ++this->count;
+}
+
+uint64_t LatencyHistogram::GetCount() const { return this->count; }
+
+double LatencyHistogram::GetPercentile(double percentile) const {
+  const auto target = static_cast<uint64_t>(percentile * this->count / 100.0);
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < this->buckets.size(); i++) {
+    total += this->buckets[i];
+    if (total > target) {
+      return (i + 1) * kBucketWidth;
+    }
+  }
+
+  return 0.0;
+}
+
+void LatencyHistogram::Print(std::ostream &stream) const {
+  // Merge the buckets to 1 ms for printing
+  std::array<uint64_t, 101> merged = {};
+  for (size_t i = 0; i < this->buckets.size(); i++) {
+    merged.at(std::min<size_t>(i / 10, merged.size() - 1)) += this->buckets[i];
+  }
+
+  const auto largest = *std::max_element(merged.begin(), merged.end());
+  if (largest == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < merged.size(); i++) {
+    if (merged[i] == 0) {
+      continue;
+    }
+
+    const auto label = (i + 1 == merged.size())
+                           ? std::string(">100")
+                           : std::to_string(i) + "-" + std::to_string(i + 1);
+    stream << std::setw(8) << label << " ms " << std::setw(6) << merged[i]
+           << ' ' << std::string(merged[i] * 50 / largest, '#') << '\n';
+  }
+}
+
+void LatencyProbe::OnKeyEvent() {
+  this->samples.push_back({std::chrono::steady_clock::now(), {}, 0});
+}
+
+void LatencyProbe::OnKeyApplied() {
+  // Key events are applied in the order they arrived
+  for (auto &sample : this->samples) {
+    if (sample.completedStages == 0) {
+      sample.stages[kApplied] = std::chrono::steady_clock::now();
+      sample.completedStages = 1;
+      this->histograms[kApplied].Add(sample.stages[kApplied] - sample.start);
+      return;
+    }
+  }
+}
+
+void LatencyProbe::OnFramebufferChanged() { this->advance(kApplied, kDrawn); }
+
+void LatencyProbe::OnTextureUploaded() { this->advance(kDrawn, kUploaded); }
+
+void LatencyProbe::OnBuffersSwapped() {
+  this->advance(kUploaded, kPresented);
+
+  // Drop the finished samples and those that will never finish
+  const auto now = std::chrono::steady_clock::now();
+  const auto finished = std::remove_if(
+      this->samples.begin(), this->samples.end(), [&](const Sample &sample) {
+        if (sample.completedStages == kStageCount) {
+          return true;
+        }
+
+        // Keys the CPU never read, e.g. while stopped in the debugger
+        if (sample.completedStages == 0 &&
+            (now - sample.start) > kAbandonTime) {
+          ++this->unapplied;
+          return true;
+        }
+
+        if (sample.completedStages == 1 &&
+            (now - sample.stages[kApplied]) > kAbandonTime) {
+          ++this->abandoned;
+          return true;
+        }
+
+        return false;
+      });
+
+  this->samples.erase(finished, this->samples.end());
+}
+
+void LatencyProbe::Report(std::ostream &stream) const {
+  stream << "Input-to-photon latency: "
+         << this->histograms[kApplied].GetCount() << " key events applied, "
+         << this->unapplied << " never applied, " << this->abandoned
+         << " did not change the screen\n";
+
+  stream << std::left << std::setw(22) << "Stage" << std::right
+         << std::setw(8) << "Count" << std::setw(12) << "p50 (ms)"
+         << std::setw(12) << "p99 (ms)" << '\n';
+
+  stream << std::fixed << std::setprecision(1);
+  for (size_t stage = 0; stage < kStageCount; stage++) {
+    const auto &histogram = this->histograms.at(stage);
+    stream << std::left << std::setw(22) << kStageNames.at(stage) << std::right
+           << std::setw(8) << histogram.GetCount() << std::setw(12)
+           << histogram.GetPercentile(50.0) << std::setw(12)
+           << histogram.GetPercentile(99.0) << '\n';
+  }
+
+  stream << "\nKey event to buffers swapped:\n";
+  this->histograms[kPresented].Print(stream);
+}
+
+void LatencyProbe::advance(Stage from, Stage to) {
+  const auto now = std::chrono::steady_clock::now();
+
+  for (auto &sample : this->samples) {
+    if (sample.completedStages == from + 1) {
+      sample.stages.at(to) = now;
+      sample.completedStages = to + 1;
+      this->histograms.at(to).Add(now - sample.start);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef LATENCY_PROBE_H_INCLUDED
+#define LATENCY_PROBE_H_INCLUDED
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Histogram of latencies with 0.1 ms buckets up to 100 ms
+class LatencyHistogram {
+public:
+  void Add(std::chrono::steady_clock::duration latency);
+
+  [[nodiscard]] uint64_t GetCount() const;
+
+  // Upper bound of the bucket containing the percentile, in milliseconds
+  [[nodiscard]] double GetPercentile(double percentile) const;
+
+  void Print(std::ostream &stream) const;
+
+private:
+  // The last bucket collects everything above the range
+  std::array<uint64_t, 1001> buckets = {};
+  uint64_t count = 0;
+};
+
+// Measures how long it takes a key press to reach the screen
+// Each keypad event is followed through these stages:
+//   1. GLFW key callback (start)
+//   2. Applied to the keypad by the CPU
+//   3. First DXYN afterwards that changes the framebuffer
+//   4. Framebuffer uploaded to the texture
+//   5. glfwSwapBuffers returned
+class LatencyProbe {
+public:
+  enum Stage { kApplied, kDrawn, kUploaded, kPresented, kStageCount };
+
+public:
+  void OnKeyEvent();
+  void OnKeyApplied();
+  void OnFramebufferChanged();
+  void OnTextureUploaded();
+  void OnBuffersSwapped();
+
+  void Report(std::ostream &stream) const;
+
+private:
+  struct Sample {
+    std::chrono::steady_clock::time_point start;
+    std::array<std::chrono::steady_clock::time_point, kStageCount> stages;
+    int completedStages;
+  };
+
+private:
+  void advance(Stage from, Stage to);
+
+private:
+  std::vector<Sample> samples;
+  std::array<LatencyHistogram, kStageCount> histograms;
+  uint64_t unapplied = 0;
+  uint64_t abandoned = 0;
+};
+
+#endif // LATENCY_PROBE_H_INCLUDED
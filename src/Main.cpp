@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 
@@ -8,26 +13,73 @@
 #include <glad/glad.h>
 
 #include "Chip8.h"
+#include "Display.h"
+#include "GdbServer.h"
+#include "Netplay.h"
+#include "Util.h"
 
 namespace {
 // Constants
 constexpr double kFrameTime = 1.0 / 60.0;
 
+// Size of the trace file written with -t
+constexpr size_t kTraceSize = 64 * 1024 * 1024;
+
+// Keyboard keys for the keypad keys 0x0-0xF
+constexpr std::array<int, 16> kKeyMap = {
+    GLFW_KEY_X, GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_3, GLFW_KEY_Q, GLFW_KEY_W,
+    GLFW_KEY_E, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_Y, GLFW_KEY_C,
+    GLFW_KEY_4, GLFW_KEY_R, GLFW_KEY_F, GLFW_KEY_V};
+
+// CPU rate change per Page Up/Page Down press (or key repeat)
+constexpr uint16_t kCpuRateStep = 10;
+
 // Local types
 struct glfwDeleter {
   void operator()(GLFWwindow *window) { glfwDestroyWindow(window); }
 };
 
+// Time spent running ahead for the frames rendered
+struct RunAheadCost {
+  uint64_t frames = 0;
+  std::chrono::steady_clock::duration total{};
+  std::chrono::steady_clock::duration max{};
+};
+
 // Local variables
 std::unique_ptr<GLFWwindow, glfwDeleter> glfwWindow;
+std::unique_ptr<AudioOutput> audioOutput;
+std::unique_ptr<LatencyProbe> latencyProbe;
+std::unique_ptr<TraceRecorder> traceRecorder;
+std::unique_ptr<MovieRecorder> movieRecorder;
+std::string moviePath;
+std::unique_ptr<UdpSocket> netplaySocket;
+std::unique_ptr<RollbackSession> netplaySession;
+uint16_t netplayKeys = 0;
+double netplayAccumulator = 0.0;
+int swapInterval = 1;
+unsigned int runAheadFrames = 0;
+RunAheadCost runAheadCost;
+#ifdef CHIP8_PROFILER
+std::string profilePath = "profile";
+#endif
 Chip8 chip8;
+Display display;
+
+// Destroyed first, as it detaches from the machine
+std::unique_ptr<GdbServer> gdbServer;
 
 // Local functions
 void parseArguments(int argc, char **argv);
 void initializeGraphics();
 void runLoop();
+void updateNetplay(float deltaTime);
+void saveMovie();
+void reportRunAheadCost();
+void reportNetplay();
 void glfwErrorCallback(int error, const char *description);
 void glfwWindowSizeCallback(GLFWwindow *window, int, int);
+void glfwKeyCallback(GLFWwindow *window, int key, int, int action, int);
 } // namespace
 
 int main(int argc, char **argv) {
@@ -35,8 +87,29 @@ int main(int argc, char **argv) {
     parseArguments(argc, argv);
     initializeGraphics();
     runLoop();
+    saveMovie();
+
+    if (latencyProbe) {
+      latencyProbe->Report(std::cout);
+    }
+
+    if (runAheadFrames > 0) {
+      reportRunAheadCost();
+    }
+
+    if (netplaySession) {
+      reportNetplay();
+    }
+
+#ifdef CHIP8_PROFILER
+    chip8.GetProfiler().WriteJson(profilePath + ".json");
+    chip8.GetProfiler().WriteCsv(profilePath + ".csv");
+#endif
   } catch (const std::exception &e) {
     std::cerr << e.what() << std::endl;
+
+    // A movie that ends in a fault is the most useful one to keep
+    saveMovie();
     return EXIT_FAILURE;
   }
 
@@ -46,6 +119,9 @@ int main(int argc, char **argv) {
 namespace {
 void parseArguments(int argc, char **argv) {
   std::string romPath;
+  std::string netplayPeer;
+  uint16_t gdbPort = 0;
+  std::string audioSink = HasLiveAudioSink() ? "live" : "null";
 
   for (int i = 1; i < argc; i++) {
     if (std::string(argv[i]) == "-r") {
@@ -58,6 +134,60 @@ void parseArguments(int argc, char **argv) {
       // TODO improve this code
       const auto rate = std::stoul(argv[i]);
       chip8.SetCpuRate(static_cast<uint16_t>(rate));
+    } else if (std::string(argv[i]) == "-a") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -a.");
+      }
+
+      audioSink = argv[++i];
+    } else if (std::string(argv[i]) == "-s") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -s.");
+      }
+
+      swapInterval = std::stoi(argv[++i]);
+    } else if (std::string(argv[i]) == "-l") {
+      latencyProbe = std::make_unique<LatencyProbe>();
+      chip8.SetLatencyProbe(latencyProbe.get());
+    } else if (std::string(argv[i]) == "-t") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -t.");
+      }
+
+      traceRecorder = std::make_unique<TraceRecorder>(argv[++i], kTraceSize);
+      chip8.SetTraceRecorder(traceRecorder.get());
+    } else if (std::string(argv[i]) == "-A") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -A.");
+      }
+
+      runAheadFrames = static_cast<unsigned int>(std::stoul(argv[++i]));
+    } else if (std::string(argv[i]) == "-N") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -N.");
+      }
+
+      netplayPeer = argv[++i];
+    } else if (std::string(argv[i]) == "-g") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -g.");
+      }
+
+      gdbPort = static_cast<uint16_t>(std::stoul(argv[++i]));
+    } else if (std::string(argv[i]) == "-m") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -m.");
+      }
+
+      moviePath = argv[++i];
+#ifdef CHIP8_PROFILER
+    } else if (std::string(argv[i]) == "-p") {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after -p.");
+      }
+
+      profilePath = argv[++i];
+#endif
     } else {
       if (!romPath.empty()) {
         throw std::runtime_error("Unexpected argument: " +
@@ -72,7 +202,69 @@ void parseArguments(int argc, char **argv) {
     throw std::runtime_error("Missing ROM path argument.");
   }
 
-  chip8.LoadRom(argv[1]);
+  // Both netplay peers must start from the same state
+  if (!netplayPeer.empty()) {
+    if (!moviePath.empty()) {
+      throw std::runtime_error("Movies can't be recorded during netplay.");
+    }
+
+    chip8.SetRandomSeed(1);
+  }
+
+  // Stopping the machine would desynchronize the peers, and running ahead
+  // would show frames past a stop
+  if (gdbPort != 0 && (!netplayPeer.empty() || runAheadFrames > 0)) {
+    throw std::runtime_error(
+        "The GDB server can't be used with netplay or run-ahead.");
+  }
+
+  auto rom = Util::FileReadBinary(romPath);
+  chip8.LoadRom(rom.data(), rom.size());
+
+  // <local port>:<remote host>:<remote port>
+  if (!netplayPeer.empty()) {
+    const auto first = netplayPeer.find(':');
+    const auto last = netplayPeer.rfind(':');
+    if (first == std::string::npos || first == last) {
+      throw std::runtime_error("Invalid netplay peer: " + netplayPeer);
+    }
+
+    netplaySocket = std::make_unique<UdpSocket>(
+        static_cast<uint16_t>(std::stoul(netplayPeer.substr(0, first))));
+    netplaySocket->Connect(
+        netplayPeer.substr(first + 1, last - first - 1),
+        static_cast<uint16_t>(std::stoul(netplayPeer.substr(last + 1))));
+    netplaySession = std::make_unique<RollbackSession>(chip8, *netplaySocket);
+  }
+
+  // Record from power-on, also for GDB to go back in time
+  if (!moviePath.empty() || gdbPort != 0) {
+    movieRecorder = std::make_unique<MovieRecorder>(
+        std::move(rom), chip8.GetState(), chip8.GetCpuRate());
+    chip8.SetMovieRecorder(movieRecorder.get());
+  }
+
+  // The machine waits for GDB to connect and resume it
+  if (gdbPort != 0) {
+    gdbServer =
+        std::make_unique<GdbServer>(chip8, gdbPort, movieRecorder.get());
+    std::printf("Waiting for GDB on port %u\n",
+                static_cast<unsigned int>(gdbPort));
+  }
+
+  // "live" plays through the sound device, "null" discards the samples and
+  // anything else is the path of a WAV file to record to
+  if (audioSink == "live") {
+    audioOutput = std::make_unique<AudioOutput>(CreateLiveAudioSink());
+  } else if (audioSink == "null") {
+    audioOutput =
+        std::make_unique<AudioOutput>(std::make_unique<NullAudioSink>());
+  } else {
+    audioOutput = std::make_unique<AudioOutput>(
+        std::make_unique<WavAudioSink>(audioSink));
+  }
+
+  chip8.SetAudioOutput(audioOutput.get());
 }
 
 void initializeGraphics() {
@@ -100,6 +292,7 @@ void initializeGraphics() {
   // This is necessary because, even in fullscreen mode, the screen may be
   // resized a few times (at least in X11/Ubuntu)
   glfwSetWindowSizeCallback(glfwWindow.get(), glfwWindowSizeCallback);
+  glfwSetKeyCallback(glfwWindow.get(), glfwKeyCallback);
   glfwMakeContextCurrent(glfwWindow.get());
 
   if (!gladLoadGL()) {
@@ -112,13 +305,12 @@ void initializeGraphics() {
   // Clear the screen to black
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-  // TODO should be configurable
   // 0 = could tear, but swapping buffers doesn't block
   // 1 = no tearing, blocked at vsync rate
-  glfwSwapInterval(1);
+  glfwSwapInterval(swapInterval);
 
-  // Initialize graphics for the CPU (load shader, etc.)
-  chip8.InitializeGraphics();
+  // Initialize graphics for the display (load shader, etc.)
+  display.Initialize();
 }
 
 void runLoop() {
@@ -139,7 +331,15 @@ void runLoop() {
     lastUpdateTime = currentTime;
 
     // Update the CPU
-    chip8.Update(glfwWindow.get(), deltaTime);
+    if (gdbServer) {
+      gdbServer->Poll();
+    }
+
+    if (netplaySession) {
+      updateNetplay(deltaTime);
+    } else {
+      chip8.Update(deltaTime);
+    }
 
     // See if we can render in this loop
     if ((currentTime - lastFrameTime) >= kFrameTime) {
@@ -147,16 +347,96 @@ void runLoop() {
       // Prepare the window for rendering (clear color buffer)
       glClear(GL_COLOR_BUFFER_BIT);
 
-      // Render from the CPU
-      chip8.Draw();
+      // Render the CPU's framebuffer, or the one a few frames ahead with the
+      // current input, which hides as many frames of input lag
+      if (runAheadFrames > 0) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto &state = chip8.RunAhead(runAheadFrames);
+        const auto cost = std::chrono::steady_clock::now() - start;
+
+        runAheadCost.frames++;
+        runAheadCost.total += cost;
+        runAheadCost.max = std::max(runAheadCost.max, cost);
+
+        display.Draw(state);
+      } else {
+        display.Draw(chip8.GetState());
+      }
+
+      if (latencyProbe) {
+        latencyProbe->OnTextureUploaded();
+      }
+
+#ifdef CHIP8_PROFILER
+      display.DrawHeatMap(chip8.GetProfiler());
+#endif
 
       // Finish up window rendering (swap buffers)
       glfwSwapBuffers(glfwWindow.get());
+
+      if (latencyProbe) {
+        latencyProbe->OnBuffersSwapped();
+      }
+
       glfwPollEvents();
     }
   }
 }
 
+void updateNetplay(float deltaTime) {
+  // Netplay runs whole frames; a frame that has to wait for the remote
+  // player is skipped
+  netplaySession->Poll();
+
+  netplayAccumulator += deltaTime;
+  while (netplayAccumulator >= kFrameTime) {
+    netplayAccumulator -= kFrameTime;
+    netplaySession->AdvanceFrame(netplayKeys);
+  }
+
+  chip8.GenerateAudio(deltaTime);
+}
+
+void saveMovie() {
+  if (movieRecorder && !moviePath.empty()) {
+    movieRecorder->Finish(chip8.GetState()).Write(moviePath);
+    chip8.SetMovieRecorder(nullptr);
+    movieRecorder.reset();
+  }
+}
+
+void reportRunAheadCost() {
+  if (runAheadCost.frames == 0) {
+    return;
+  }
+
+  const auto mean = std::chrono::duration<double, std::milli>(
+                        runAheadCost.total / runAheadCost.frames)
+                        .count();
+  const auto max =
+      std::chrono::duration<double, std::milli>(runAheadCost.max).count();
+  std::printf("Run-ahead of %u frames: %llu frames rendered, %.3f ms mean, "
+              "%.3f ms max (%.1f%% of the frame time at most)\n",
+              runAheadFrames,
+              static_cast<unsigned long long>(runAheadCost.frames), mean, max,
+              max / (kFrameTime * 1000.0) * 100.0);
+}
+
+void reportNetplay() {
+  const auto &stats = netplaySession->GetStats();
+  const auto frames = std::max<uint64_t>(netplaySession->GetFrame(), 1);
+  std::printf("Netplay: %llu frames, %llu rollbacks (%llu frames at most), "
+              "%.3f ms resimulation per frame, %llu stalls\n",
+              static_cast<unsigned long long>(netplaySession->GetFrame()),
+              static_cast<unsigned long long>(stats.rollbacks),
+              static_cast<unsigned long long>(stats.maxRollback),
+              std::chrono::duration<double, std::milli>(
+                  stats.resimulationTime)
+                      .count() /
+                  static_cast<double>(frames),
+              static_cast<unsigned long long>(stats.stalls));
+}
+
 void glfwErrorCallback(int error, const char *description) {
   throw std::runtime_error("GLFW error " + std::to_string(error) + ": " +
                            description);
@@ -169,4 +449,74 @@ void glfwWindowSizeCallback(GLFWwindow *window, int, int) {
   glfwGetFramebufferSize(window, &frameBufferWidth, &frameBufferHeight);
   glViewport(0, 0, frameBufferWidth, frameBufferHeight);
 }
+
+void glfwKeyCallback(GLFWwindow *window, int key, int, int action, int) {
+  // Key events are timestamped here so that the CPU applies them at the
+  // instruction that was due when they happened
+  if (action != GLFW_REPEAT) {
+    for (size_t i = 0; i < kKeyMap.size(); i++) {
+      if (kKeyMap[i] == key) {
+        // Netplay samples the keypad once per frame
+        if (netplaySession) {
+          const auto bit = static_cast<uint16_t>(1 << i);
+          netplayKeys = static_cast<uint16_t>(
+              (action == GLFW_PRESS) ? (netplayKeys | bit)
+                                     : (netplayKeys & ~bit));
+          return;
+        }
+
+        if (latencyProbe) {
+          latencyProbe->OnKeyEvent();
+        }
+
+        chip8.QueueKeyEvent(
+            {glfwGetTime(), static_cast<uint8_t>(i), action == GLFW_PRESS});
+        return;
+      }
+    }
+  }
+
+  if (action == GLFW_RELEASE) {
+    return;
+  }
+
+  // Holding Page Up/Page Down keeps changing the CPU rate via key repeat
+  const int rate = chip8.GetCpuRate();
+
+  switch (key) {
+  case GLFW_KEY_ESCAPE:
+    // Close the window if the ESC key is pressed
+    glfwSetWindowShouldClose(window, true);
+    break;
+
+  // The CPU rate can't change during netplay, as the peers would diverge
+  case GLFW_KEY_PAGE_UP:
+    if (netplaySession) {
+      break;
+    }
+
+    chip8.SetCpuRate(static_cast<uint16_t>(std::min<int>(
+        rate + kCpuRateStep, std::numeric_limits<uint16_t>::max())));
+    break;
+
+  case GLFW_KEY_PAGE_DOWN:
+    if (netplaySession) {
+      break;
+    }
+
+    chip8.SetCpuRate(static_cast<uint16_t>(std::max(rate - kCpuRateStep, 1)));
+    break;
+
+#ifdef CHIP8_PROFILER
+  case GLFW_KEY_F1:
+    if (action == GLFW_PRESS) {
+      display.ToggleHeatMap();
+    }
+    break;
+#endif
+
+  default:
+    break;
+  }
+}
 } // namespace
@@ -0,0 +1,183 @@
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+MappedFile MappedFile::OpenReadOnly(const std::string &path) {
+  MappedFile mappedFile;
+
+  mappedFile.file =
+      CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (mappedFile.file == INVALID_HANDLE_VALUE) {
+    mappedFile.file = nullptr;
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(mappedFile.file, &fileSize);
+  mappedFile.size = static_cast<size_t>(fileSize.QuadPart);
+
+  if (mappedFile.size != 0) {
+    mappedFile.mapping = CreateFileMappingA(mappedFile.file, nullptr,
+                                            PAGE_READONLY, 0, 0, nullptr);
+    if (mappedFile.mapping == nullptr) {
+      throw std::runtime_error("Could not map the file: " + path);
+    }
+
+    mappedFile.data = static_cast<uint8_t *>(
+        MapViewOfFile(mappedFile.mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mappedFile.data == nullptr) {
+      throw std::runtime_error("Could not map the file: " + path);
+    }
+  }
+
+  return mappedFile;
+}
+
+MappedFile MappedFile::Create(const std::string &path, size_t size) {
+  MappedFile mappedFile;
+
+  mappedFile.file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                                nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+  if (mappedFile.file == INVALID_HANDLE_VALUE) {
+    mappedFile.file = nullptr;
+    throw std::runtime_error("Could not create the file: " + path);
+  }
+
+  const auto size64 = static_cast<uint64_t>(size);
+  mappedFile.mapping = CreateFileMappingA(
+      mappedFile.file, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(size64 >> 32),
+      static_cast<DWORD>(size64 & 0xFFFFFFFF), nullptr);
+  if (mappedFile.mapping == nullptr) {
+    throw std::runtime_error("Could not map the file: " + path);
+  }
+
+  mappedFile.data = static_cast<uint8_t *>(
+      MapViewOfFile(mappedFile.mapping, FILE_MAP_WRITE, 0, 0, size));
+  if (mappedFile.data == nullptr) {
+    throw std::runtime_error("Could not map the file: " + path);
+  }
+
+  mappedFile.size = size;
+  return mappedFile;
+}
+
+void MappedFile::unmap() {
+  if (this->data != nullptr) {
+    UnmapViewOfFile(this->data);
+  }
+
+  if (this->mapping != nullptr) {
+    CloseHandle(this->mapping);
+  }
+
+  if (this->file != nullptr) {
+    CloseHandle(this->file);
+  }
+
+  this->data = nullptr;
+  this->mapping = nullptr;
+  this->file = nullptr;
+  this->size = 0;
+}
+#else
+MappedFile MappedFile::OpenReadOnly(const std::string &path) {
+  MappedFile mappedFile;
+
+  mappedFile.file = open(path.c_str(), O_RDONLY);
+  if (mappedFile.file < 0) {
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  struct stat fileStat;
+  if (fstat(mappedFile.file, &fileStat) != 0) {
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  // mmap() doesn't accept empty mappings
+  mappedFile.size = static_cast<size_t>(fileStat.st_size);
+  if (mappedFile.size != 0) {
+    auto data = mmap(nullptr, mappedFile.size, PROT_READ, MAP_SHARED,
+                     mappedFile.file, 0);
+    if (data == MAP_FAILED) {
+      throw std::runtime_error("Could not map the file: " + path);
+    }
+
+    mappedFile.data = static_cast<uint8_t *>(data);
+  }
+
+  return mappedFile;
+}
+
+MappedFile MappedFile::Create(const std::string &path, size_t size) {
+  MappedFile mappedFile;
+
+  mappedFile.file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (mappedFile.file < 0) {
+    throw std::runtime_error("Could not create the file: " + path);
+  }
+
+  if (ftruncate(mappedFile.file, static_cast<off_t>(size)) != 0) {
+    throw std::runtime_error("Could not resize the file: " + path);
+  }
+
+  auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   mappedFile.file, 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Could not map the file: " + path);
+  }
+
+  mappedFile.data = static_cast<uint8_t *>(data);
+  mappedFile.size = size;
+  return mappedFile;
+}
+
+void MappedFile::unmap() {
+  if (this->data != nullptr) {
+    munmap(this->data, this->size);
+  }
+
+  if (this->file >= 0) {
+    close(this->file);
+  }
+
+  this->data = nullptr;
+  this->file = -1;
+  this->size = 0;
+}
+#endif
+
+MappedFile::~MappedFile() { this->unmap(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    this->unmap();
+
+    std::swap(this->data, other.data);
+    std::swap(this->size, other.size);
+    std::swap(this->file, other.file);
+#ifdef _WIN32
+    std::swap(this->mapping, other.mapping);
+#endif
+  }
+
+  return *this;
+}
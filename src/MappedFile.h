@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H_INCLUDED
+#define MAPPED_FILE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A file mapped into memory
+class MappedFile {
+public:
+  // Maps an existing file read-only
+  static MappedFile OpenReadOnly(const std::string &path);
+
+  // Creates (or truncates) a file of the given size and maps it read-write
+  static MappedFile Create(const std::string &path, size_t size);
+
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  [[nodiscard]] uint8_t *GetData() const { return this->data; }
+  [[nodiscard]] size_t GetSize() const { return this->size; }
+
+private:
+  void unmap();
+
+private:
+  uint8_t *data = nullptr;
+  size_t size = 0;
+
+#ifdef _WIN32
+  void *file = nullptr;
+  void *mapping = nullptr;
+#else
+  int file = -1;
+#endif
+};
+
+#endif // MAPPED_FILE_H_INCLUDED
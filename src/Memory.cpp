@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Memory.h"
+
+Memory::Memory() {
+  // Never written to, since this reference keeps it shared
+  static const auto zeroPage = std::make_shared<Page>();
+
+  this->pages.fill(zeroPage);
+  this->data.fill(zeroPage->data());
+}
+
+void Memory::writeAcrossPages(size_t address, const uint8_t *bytes,
+                              size_t count) {
+  if (address > kSize || count > kSize - address) {
+    throw std::out_of_range("Memory address out of range.");
+  }
+
+  this->copyToPages(address, bytes, count);
+}
+
+void Memory::readAcrossPages(size_t address, uint8_t *bytes,
+                             size_t count) const {
+  if (address > kSize || count > kSize - address) {
+    throw std::out_of_range("Memory address out of range.");
+  }
+
+  this->copyFromPages(address, bytes, count);
+}
+
+void Memory::copyToPages(size_t address, const uint8_t *bytes, size_t count) {
+  while (count > 0) {
+    const auto page = address / kPageSize;
+    const auto offset = address % kPageSize;
+    const auto chunk = std::min(count, kPageSize - offset);
+
+    if (this->pages[page].use_count() != 1) {
+      this->unshare(page);
+    }
+
+    std::memcpy(this->data[page] + offset, bytes, chunk);
+    address += chunk;
+    bytes += chunk;
+    count -= chunk;
+  }
+}
+
+void Memory::copyFromPages(size_t address, uint8_t *bytes,
+                           size_t count) const {
+  while (count > 0) {
+    const auto page = address / kPageSize;
+    const auto offset = address % kPageSize;
+    const auto chunk = std::min(count, kPageSize - offset);
+
+    std::memcpy(bytes, this->data[page] + offset, chunk);
+    address += chunk;
+    bytes += chunk;
+    count -= chunk;
+  }
+}
+
+size_t Memory::Restore(const Memory &snapshot) {
+  size_t restored = 0;
+
+  for (size_t page = 0; page < kPageCount; page++) {
+    if (this->pages[page] != snapshot.pages[page]) {
+      this->pages[page] = snapshot.pages[page];
+      this->data[page] = snapshot.data[page];
+      ++restored;
+    }
+  }
+
+  return restored;
+}
+
+size_t Memory::GetPrivatePageCount() const {
+  return static_cast<size_t>(
+      std::count_if(this->pages.begin(), this->pages.end(),
+                    [](const auto &page) { return page.use_count() == 1; }));
+}
+
+bool Memory::operator==(const Memory &other) const {
+  for (size_t page = 0; page < kPageCount; page++) {
+    if (this->pages[page] != other.pages[page] &&
+        *this->pages[page] != *other.pages[page]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Memory::unshare(size_t page) {
+  this->pages[page] = std::make_shared<Page>(*this->pages[page]);
+  this->data[page] = this->pages[page]->data();
+}
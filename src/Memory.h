@@ -0,0 +1,161 @@
+#ifndef MEMORY_H_INCLUDED
+#define MEMORY_H_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+// The 4 KB address space, in 256-byte pages that are shared between copies
+// until one of them writes to a page (copy-on-write)
+// Copying a memory only copies the page references, so machines created from
+// the same state share the font and code pages
+class Memory {
+public:
+  static constexpr size_t kSize = 4096;
+  static constexpr size_t kPageSize = 256;
+  static constexpr size_t kPageCount = kSize / kPageSize;
+
+  using Page = std::array<uint8_t, kPageSize>;
+
+public:
+  // All pages start out as a shared page of zeros
+  Memory();
+
+  // Moving copies as well, so that a moved-from memory stays usable
+  Memory(const Memory &) = default;
+  Memory &operator=(const Memory &) = default;
+
+  [[nodiscard]] static constexpr size_t size() { return kSize; }
+
+  uint8_t operator[](size_t address) const {
+    return this->data[address / kPageSize][address % kPageSize];
+  }
+
+  // Bounds checked, like std::array::at()
+  [[nodiscard]] uint8_t at(size_t address) const {
+    if (address >= kSize) {
+      throw std::out_of_range("Memory address out of range.");
+    }
+
+    return (*this)[address];
+  }
+
+  // Big-endian, as instructions are stored; bounds checked
+  [[nodiscard]] uint16_t ReadWord(size_t address) const {
+    if (address + 1 >= kSize) {
+      throw std::out_of_range("Memory address out of range.");
+    }
+
+    if (address % kPageSize != kPageSize - 1) {
+      const auto bytes = this->data[address / kPageSize] + address % kPageSize;
+      return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+    }
+
+    return static_cast<uint16_t>(((*this)[address] << 8) |
+                                 (*this)[address + 1]);
+  }
+
+  // Bounds checked
+  void Write(size_t address, uint8_t value) {
+    if (address >= kSize) {
+      throw std::out_of_range("Memory address out of range.");
+    }
+
+    const auto page = address / kPageSize;
+    if (this->pages[page].use_count() != 1) {
+      this->unshare(page);
+    }
+
+    this->data[page][address % kPageSize] = value;
+  }
+
+  // Bounds checked; nothing is copied if any byte is out of range
+  void Write(size_t address, const uint8_t *bytes, size_t count) {
+    const auto page = address / kPageSize;
+    const auto offset = address % kPageSize;
+    if (address < kSize && count <= kPageSize - offset &&
+        this->pages[page].use_count() == 1) {
+      std::memcpy(this->data[page] + offset, bytes, count);
+      return;
+    }
+
+    this->writeAcrossPages(address, bytes, count);
+  }
+
+  void Read(size_t address, uint8_t *bytes, size_t count) const {
+    const auto offset = address % kPageSize;
+    if (address < kSize && count <= kPageSize - offset) {
+      std::memcpy(bytes, this->data[address / kPageSize] + offset, count);
+      return;
+    }
+
+    this->readAcrossPages(address, bytes, count);
+  }
+
+  // The same without bounds checks, for callers that have proven the range
+  // (Interpreter::ExecuteUnchecked())
+  [[nodiscard]] uint16_t ReadWordUnchecked(size_t address) const {
+    if (address % kPageSize != kPageSize - 1) {
+      const auto bytes = this->data[address / kPageSize] + address % kPageSize;
+      return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+    }
+
+    return static_cast<uint16_t>(((*this)[address] << 8) |
+                                 (*this)[address + 1]);
+  }
+
+  void WriteUnchecked(size_t address, const uint8_t *bytes, size_t count) {
+    const auto page = address / kPageSize;
+    const auto offset = address % kPageSize;
+    if (count <= kPageSize - offset && this->pages[page].use_count() == 1) {
+      std::memcpy(this->data[page] + offset, bytes, count);
+      return;
+    }
+
+    this->copyToPages(address, bytes, count);
+  }
+
+  void ReadUnchecked(size_t address, uint8_t *bytes, size_t count) const {
+    const auto offset = address % kPageSize;
+    if (count <= kPageSize - offset) {
+      std::memcpy(bytes, this->data[address / kPageSize] + offset, count);
+      return;
+    }
+
+    this->copyFromPages(address, bytes, count);
+  }
+
+  // Shares all pages of the other memory again, dropping the pages that were
+  // written to since it was copied (the dirty pages)
+  // Returns how many pages were restored
+  size_t Restore(const Memory &snapshot);
+
+  // Pages that aren't shared with any other memory
+  [[nodiscard]] size_t GetPrivatePageCount() const;
+
+  // Whether the page is (still) shared with the other memory
+  [[nodiscard]] bool SharesPage(const Memory &other, size_t page) const {
+    return this->pages[page] == other.pages[page];
+  }
+
+  bool operator==(const Memory &other) const;
+  bool operator!=(const Memory &other) const { return !(*this == other); }
+
+private:
+  void writeAcrossPages(size_t address, const uint8_t *bytes, size_t count);
+  void readAcrossPages(size_t address, uint8_t *bytes, size_t count) const;
+  void copyToPages(size_t address, const uint8_t *bytes, size_t count);
+  void copyFromPages(size_t address, uint8_t *bytes, size_t count) const;
+  void unshare(size_t page);
+
+private:
+  std::array<std::shared_ptr<Page>, kPageCount> pages;
+
+  // The pages' bytes, to read without going through the shared pointers
+  std::array<uint8_t *, kPageCount> data;
+};
+
+#endif // MEMORY_H_INCLUDED
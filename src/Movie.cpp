@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Movie.h"
+#include "Util.h"
+
+namespace {
+// Functions
+Movie::Keyframe toKeyframe(const InputMovie::Keyframe &keyframe);
+InputMovie::Keyframe fromKeyframe(const Movie::Keyframe &keyframe);
+size_t getRomOffset();
+size_t getEventsOffset(size_t romSize);
+} // namespace
+
+InputMovie InputMovie::Read(const std::string &path) {
+  const auto file = MappedFile::OpenReadOnly(path);
+  const auto data = file.GetData();
+  const auto size = file.GetSize();
+
+  Movie::FileHeader header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error("Not a movie: " + path);
+  }
+
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != Movie::kMagic) {
+    throw std::runtime_error("Not a movie: " + path);
+  }
+
+  const auto eventsOffset = getEventsOffset(header.romSize);
+  const auto framesOffset =
+      eventsOffset + uint64_t{header.eventCount} * sizeof(Movie::Event);
+  const auto keyframesOffset =
+      framesOffset + uint64_t{header.frameCount} * sizeof(uint64_t);
+  const auto end = keyframesOffset + uint64_t{header.keyframeCount} *
+                                         sizeof(Movie::Keyframe);
+  if (header.keyframeCount == 0 || end > size) {
+    throw std::runtime_error("The movie is truncated: " + path);
+  }
+
+  if (header.romSize > Memory::kSize - 0x200) {
+    throw std::runtime_error("The movie is corrupt: " + path);
+  }
+
+  InputMovie movie;
+  movie.rom.assign(data + getRomOffset(),
+                   data + getRomOffset() + header.romSize);
+  movie.seed = header.seed;
+  movie.quirks = header.quirks;
+  movie.cpuRate = header.cpuRate;
+  movie.keyframeInterval = header.keyframeInterval;
+  movie.length = header.length;
+  movie.finalChecksum = header.finalChecksum;
+  movie.finalFramebufferHash = header.finalFramebufferHash;
+  movie.finalMemoryHash = header.finalMemoryHash;
+
+  movie.events.resize(header.eventCount);
+  std::memcpy(movie.events.data(), data + eventsOffset,
+              movie.events.size() * sizeof(Movie::Event));
+
+  movie.frames.resize(header.frameCount);
+  std::memcpy(movie.frames.data(), data + framesOffset,
+              movie.frames.size() * sizeof(uint64_t));
+
+  for (uint32_t i = 0; i < header.keyframeCount; i++) {
+    Movie::Keyframe keyframe;
+    std::memcpy(&keyframe, data + keyframesOffset + i * sizeof(keyframe),
+                sizeof(keyframe));
+
+    // Playback starts from the first keyframe, at power-on, and seeks
+    // through the others in order
+    const auto previous =
+        movie.keyframes.empty() ? 0 : movie.keyframes.back().state.cycles;
+    if (keyframe.SP > keyframe.stack.size() ||
+        keyframe.timerPhase >= keyframe.cpuRate ||
+        keyframe.event > header.eventCount ||
+        keyframe.frame > header.frameCount || keyframe.cycles < previous ||
+        (i == 0 && keyframe.cycles != 0)) {
+      throw std::runtime_error("The movie is corrupt: " + path);
+    }
+
+    movie.keyframes.push_back(fromKeyframe(keyframe));
+  }
+
+  return movie;
+}
+
+void InputMovie::Write(const std::string &path) const {
+  const auto eventsOffset = getEventsOffset(this->rom.size());
+  const auto framesOffset =
+      eventsOffset + this->events.size() * sizeof(Movie::Event);
+  const auto keyframesOffset =
+      framesOffset + this->frames.size() * sizeof(uint64_t);
+
+  auto file = MappedFile::Create(
+      path, keyframesOffset + this->keyframes.size() * sizeof(Movie::Keyframe));
+  const auto data = file.GetData();
+
+  Movie::FileHeader header = {};
+  header.magic = Movie::kMagic;
+  header.length = this->length;
+  header.finalChecksum = this->finalChecksum;
+  header.finalFramebufferHash = this->finalFramebufferHash;
+  header.finalMemoryHash = this->finalMemoryHash;
+  header.keyframeInterval = this->keyframeInterval;
+  header.seed = this->seed;
+  header.quirks = this->quirks;
+  header.eventCount = static_cast<uint32_t>(this->events.size());
+  header.frameCount = static_cast<uint32_t>(this->frames.size());
+  header.keyframeCount = static_cast<uint32_t>(this->keyframes.size());
+  header.cpuRate = this->cpuRate;
+  header.romSize = static_cast<uint16_t>(this->rom.size());
+  std::memcpy(data, &header, sizeof(header));
+
+  std::memcpy(data + getRomOffset(), this->rom.data(), this->rom.size());
+  std::memcpy(data + eventsOffset, this->events.data(),
+              this->events.size() * sizeof(Movie::Event));
+  std::memcpy(data + framesOffset, this->frames.data(),
+              this->frames.size() * sizeof(uint64_t));
+
+  for (size_t i = 0; i < this->keyframes.size(); i++) {
+    const auto keyframe = toKeyframe(this->keyframes[i]);
+    std::memcpy(data + keyframesOffset + i * sizeof(keyframe), &keyframe,
+                sizeof(keyframe));
+  }
+}
+
+MovieRecorder::MovieRecorder(std::vector<uint8_t> rom, const Chip8State &state,
+                             uint16_t cpuRate, uint64_t keyframeInterval) {
+  if (rom.size() > Memory::kSize - 0x200) {
+    throw std::runtime_error("The ROM is too large.");
+  }
+
+  this->movie.rom = std::move(rom);
+  this->movie.seed = state.randomState;
+  this->movie.cpuRate = cpuRate;
+  this->movie.keyframeInterval = std::max<uint64_t>(keyframeInterval, 1);
+  this->movie.keyframes.push_back({state, cpuRate, 0, 0});
+}
+
+void MovieRecorder::RecordKey(uint64_t cycle, uint8_t key, bool pressed) {
+  this->movie.events.push_back(
+      {cycle, pressed ? Movie::kKeyDown : Movie::kKeyUp, key});
+}
+
+void MovieRecorder::RecordCpuRate(uint64_t cycle, uint16_t cpuRate) {
+  this->movie.events.push_back({cycle, Movie::kCpuRate, cpuRate});
+}
+
+void MovieRecorder::RecordFrame(const Chip8State &state) {
+  this->movie.frames.push_back(Movie::HashFramebuffer(state));
+}
+
+void MovieRecorder::Update(const Chip8State &state, uint16_t cpuRate) {
+  // Copying the state only shares its memory pages
+  const auto &last = this->movie.keyframes.back();
+  if (state.cycles - last.state.cycles >= this->movie.keyframeInterval) {
+    this->movie.keyframes.push_back({state, cpuRate,
+                                     this->movie.events.size(),
+                                     this->movie.frames.size()});
+  }
+}
+
+void MovieRecorder::AddKeyframe(const Chip8State &state, uint16_t cpuRate) {
+  this->movie.keyframes.push_back({state, cpuRate, this->movie.events.size(),
+                                   this->movie.frames.size(), true});
+}
+
+void MovieRecorder::Truncate(uint64_t cycle, size_t frames) {
+  // Events at the cycle were applied before its instruction, so they stay;
+  // the keyframe at power-on always does
+  auto &events = this->movie.events;
+  events.erase(std::find_if(events.begin(), events.end(),
+                            [&](const Movie::Event &event) {
+                              return event.cycle > cycle;
+                            }),
+               events.end());
+
+  auto &keyframes = this->movie.keyframes;
+  keyframes.erase(std::find_if(keyframes.begin() + 1, keyframes.end(),
+                               [&](const InputMovie::Keyframe &keyframe) {
+                                 return keyframe.state.cycles > cycle;
+                               }),
+                  keyframes.end());
+
+  this->movie.frames.resize(std::min(frames, this->movie.frames.size()));
+}
+
+const InputMovie &MovieRecorder::GetMovie(const Chip8State &state) {
+  this->movie.length = state.cycles;
+  return this->movie;
+}
+
+InputMovie MovieRecorder::Finish(const Chip8State &state) const {
+  auto movie = this->movie;
+  movie.length = state.cycles;
+  movie.finalChecksum = state.GetChecksum();
+  movie.finalFramebufferHash = Movie::HashFramebuffer(state);
+  movie.finalMemoryHash = Movie::HashMemory(state);
+  return movie;
+}
+
+namespace Movie {
+uint64_t HashFramebuffer(const Chip8State &state) {
+  static_assert(sizeof(bool) == 1);
+  return Util::HashFnv1a(reinterpret_cast<const uint8_t *>(state.pixels.data()),
+                         state.pixels.size());
+}
+
+uint64_t HashMemory(const Chip8State &state) {
+  std::array<uint8_t, Memory::kSize> memory;
+  state.memory.Read(0, memory.data(), memory.size());
+  return Util::HashFnv1a(memory.data(), memory.size());
+}
+} // namespace Movie
+
+namespace {
+Movie::Keyframe toKeyframe(const InputMovie::Keyframe &keyframe) {
+  const auto &state = keyframe.state;
+
+  Movie::Keyframe out = {};
+  out.event = keyframe.event;
+  out.frame = keyframe.frame;
+  out.cycles = state.cycles;
+  out.randomState = state.randomState;
+  out.timerPhase = state.timerPhase;
+  out.cpuRate = keyframe.cpuRate;
+  out.I = state.I;
+  out.PC = state.PC;
+  for (size_t i = 0; i < state.keys.size(); i++) {
+    out.keys |= static_cast<uint16_t>(state.keys[i] << i);
+  }
+
+  out.stack = state.stack;
+  out.V = state.V;
+  out.SP = state.SP;
+  out.delayTimer = state.delayTimer;
+  out.soundTimer = state.soundTimer;
+  out.audioPatternLoaded = state.audioPatternLoaded;
+  out.audioPitch = state.audioPitch;
+  out.edit = keyframe.edit ? 1 : 0;
+  out.audioPattern = state.audioPattern;
+  for (size_t i = 0; i < state.pixels.size(); i++) {
+    out.pixels[i / 8] |= static_cast<uint8_t>(state.pixels[i] << (i % 8));
+  }
+
+  state.memory.Read(0, out.memory.data(), out.memory.size());
+  return out;
+}
+
+InputMovie::Keyframe fromKeyframe(const Movie::Keyframe &keyframe) {
+  InputMovie::Keyframe out;
+  auto &state = out.state;
+
+  out.event = keyframe.event;
+  out.frame = keyframe.frame;
+  out.cpuRate = keyframe.cpuRate;
+  out.edit = keyframe.edit != 0;
+  state.cycles = keyframe.cycles;
+  state.randomState = keyframe.randomState;
+  state.timerPhase = keyframe.timerPhase;
+  state.I = keyframe.I;
+  state.PC = keyframe.PC;
+  for (size_t i = 0; i < state.keys.size(); i++) {
+    state.keys[i] = ((keyframe.keys >> i) & 1) != 0;
+  }
+
+  state.stack = keyframe.stack;
+  state.V = keyframe.V;
+  state.SP = keyframe.SP;
+  state.delayTimer = keyframe.delayTimer;
+  state.soundTimer = keyframe.soundTimer;
+  state.audioPatternLoaded = keyframe.audioPatternLoaded != 0;
+  state.audioPitch = keyframe.audioPitch;
+  state.audioPattern = keyframe.audioPattern;
+  for (size_t i = 0; i < state.pixels.size(); i++) {
+    state.pixels[i] = ((keyframe.pixels[i / 8] >> (i % 8)) & 1) != 0;
+  }
+
+  state.memory.Write(0, keyframe.memory.data(), keyframe.memory.size());
+  return out;
+}
+
+size_t getRomOffset() { return sizeof(Movie::FileHeader); }
+
+size_t getEventsOffset(size_t romSize) {
+  // The events are 8-byte aligned
+  return (getRomOffset() + romSize + 7) / 8 * 8;
+}
+} // namespace
@@ -0,0 +1,172 @@
+#ifndef MOVIE_H_INCLUDED
+#define MOVIE_H_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Chip8State.h"
+#include "RomPack.h"
+
+// Input movie format
+//
+// The header, events and keyframes are the structs below as laid out in
+// memory, in the byte order of the machine that recorded them.
+//
+// A header, the ROM, the input events, the frame hashes, then the keyframes.
+// Playback starts from power-on (the ROM, random seed and CPU rate) and
+// applies each event before the instruction at its cycle. A frame ends at
+// each 60 Hz timer tick, and its hash is the framebuffer's at that point. A
+// keyframe is the complete state at some cycle, so that playback can also
+// start from the last one before the point to seek to. An edit keyframe is a
+// state changed from outside the machine (e.g. by a debugger), which playback
+// restores when it reaches its cycle.
+namespace Movie {
+constexpr std::array<char, 8> kMagic = {'C', '8', 'M', 'O', 'V', 'I', 'E', '2'};
+
+enum EventType : uint32_t { kKeyUp, kKeyDown, kCpuRate };
+
+struct FileHeader {
+  std::array<char, 8> magic;
+
+  // Cycles recorded, and Chip8State::GetChecksum(), HashFramebuffer() and
+  // HashMemory() at the end
+  uint64_t length;
+  uint64_t finalChecksum;
+  uint64_t finalFramebufferHash;
+  uint64_t finalMemoryHash;
+
+  uint64_t keyframeInterval;
+  uint32_t seed;
+  uint32_t quirks;
+  uint32_t eventCount;
+  uint32_t frameCount;
+  uint32_t keyframeCount;
+  uint16_t cpuRate;
+  uint16_t romSize;
+};
+
+struct Event {
+  uint64_t cycle;
+  uint32_t type;
+
+  // The key (kKeyUp, kKeyDown) or the CPU rate (kCpuRate)
+  uint32_t value;
+};
+
+struct Keyframe {
+  // Index of the first event that isn't applied yet, and of the frame that
+  // the keyframe is in
+  uint64_t event;
+  uint64_t frame;
+
+  uint64_t cycles;
+  uint32_t randomState;
+  uint32_t timerPhase;
+  uint16_t cpuRate;
+  uint16_t I;
+  uint16_t PC;
+  uint16_t keys;
+  std::array<uint16_t, 16> stack;
+  std::array<uint8_t, 16> V;
+  uint8_t SP;
+  uint8_t delayTimer;
+  uint8_t soundTimer;
+  uint8_t audioPatternLoaded;
+  uint8_t audioPitch;
+
+  // Nonzero for an edit keyframe (0 in movies written before edits were
+  // marked)
+  uint8_t edit;
+  std::array<uint8_t, 2> reserved;
+  std::array<uint8_t, 16> audioPattern;
+
+  // One bit per pixel, row by row
+  std::array<uint8_t, 64 * 32 / 8> pixels;
+  std::array<uint8_t, Memory::kSize> memory;
+};
+
+[[nodiscard]] uint64_t HashFramebuffer(const Chip8State &state);
+[[nodiscard]] uint64_t HashMemory(const Chip8State &state);
+} // namespace Movie
+
+// A recorded session, in memory
+struct InputMovie {
+  struct Keyframe {
+    Chip8State state;
+    uint16_t cpuRate;
+
+    // Index of the first event that isn't applied yet, and of the frame that
+    // the keyframe is in
+    size_t event;
+    size_t frame;
+
+    // Whether playback restores the state instead of reaching it
+    bool edit = false;
+  };
+
+  std::vector<uint8_t> rom;
+  uint32_t seed = 1;
+  uint32_t quirks = Pack::kQuirksDefault;
+  uint16_t cpuRate = 500;
+  uint64_t keyframeInterval = 0;
+  std::vector<Movie::Event> events;
+  std::vector<uint64_t> frames;
+
+  // The first keyframe is the state at power-on
+  std::vector<Keyframe> keyframes;
+
+  uint64_t length = 0;
+  uint64_t finalChecksum = 0;
+  uint64_t finalFramebufferHash = 0;
+  uint64_t finalMemoryHash = 0;
+
+  static InputMovie Read(const std::string &path);
+  void Write(const std::string &path) const;
+};
+
+// Records the input of a machine, from power-on
+// The machine reports its input and calls Update() as it runs (see
+// Chip8::SetMovieRecorder())
+class MovieRecorder {
+public:
+  static constexpr uint64_t kDefaultKeyframeInterval = 30000;
+
+public:
+  // The state must be the one right after Chip8::LoadRom()
+  MovieRecorder(std::vector<uint8_t> rom, const Chip8State &state,
+                uint16_t cpuRate,
+                uint64_t keyframeInterval = kDefaultKeyframeInterval);
+
+  void RecordKey(uint64_t cycle, uint8_t key, bool pressed);
+  void RecordCpuRate(uint64_t cycle, uint16_t cpuRate);
+
+  // Called at each 60 Hz timer tick
+  void RecordFrame(const Chip8State &state);
+
+  // Takes a keyframe once the interval has passed since the last one
+  void Update(const Chip8State &state, uint16_t cpuRate);
+
+  // Takes an edit keyframe now, for a state changed from outside the machine
+  // (e.g. by a debugger), which playing the input back can't reproduce
+  void AddKeyframe(const Chip8State &state, uint16_t cpuRate);
+
+  // Drops what was recorded after the cycle, for a machine taken back to it
+  // Frames are the frames completed by then (see MoviePlayer::GetFrame())
+  void Truncate(uint64_t cycle, size_t frames);
+
+  // The movie so far, ending at the given state, for a player to seek in
+  // while recording goes on; unlike Finish(), it isn't copied and has no
+  // final hashes
+  [[nodiscard]] const InputMovie &GetMovie(const Chip8State &state);
+
+  // Ends the movie at the given state
+  [[nodiscard]] InputMovie Finish(const Chip8State &state) const;
+
+private:
+  InputMovie movie;
+};
+
+#endif // MOVIE_H_INCLUDED
@@ -0,0 +1,156 @@
+#include <algorithm>
+
+#include "MoviePlayer.h"
+
+MoviePlayer::MoviePlayer(const InputMovie &movie, Chip8 &chip8)
+    : movie(movie), chip8(chip8) {
+  this->chip8.SetCpuRate(this->movie.cpuRate);
+  this->chip8.SetRandomSeed(this->movie.seed);
+  this->chip8.LoadRom(this->movie.rom.data(), this->movie.rom.size());
+}
+
+void MoviePlayer::Seek(uint64_t cycle) {
+  cycle = std::min(cycle, this->movie.length);
+
+  // Keyframes are in order of cycles; find the last one at or before cycle
+  const auto next = std::upper_bound(
+      this->movie.keyframes.begin(), this->movie.keyframes.end(), cycle,
+      [](uint64_t value, const InputMovie::Keyframe &keyframe) {
+        return value < keyframe.state.cycles;
+      });
+  const auto &keyframe = *std::prev(next);
+
+  // Only go back to the keyframe if it's not behind where the machine is; one
+  // at the machine's cycle may hold a state that playing can't reproduce
+  if (cycle < this->GetCycle() || keyframe.state.cycles >= this->GetCycle()) {
+    this->restore(keyframe);
+    this->nextKeyframe =
+        static_cast<size_t>(next - this->movie.keyframes.begin());
+  }
+
+  this->RunTo(cycle);
+}
+
+void MoviePlayer::RunTo(uint64_t cycle) {
+  this->runTo(cycle, this->movie.events.size(), this->movie.keyframes.size());
+}
+
+void MoviePlayer::RunToKeyframe(size_t index) {
+  const auto &keyframe = this->movie.keyframes.at(index);
+  this->runTo(keyframe.state.cycles, keyframe.event, index + 1);
+}
+
+bool MoviePlayer::RunFrame() {
+  // An event can change the CPU rate and move the tick, so the tick is
+  // computed again after each one
+  const auto &events = this->movie.events;
+  while (!this->IsFinished()) {
+    const uint64_t rate = this->chip8.GetCpuRate();
+    const auto tick =
+        this->GetCycle() + (rate - this->chip8.GetState().timerPhase + 59) / 60;
+
+    if (this->nextEvent < events.size() &&
+        events[this->nextEvent].cycle < tick) {
+      this->runTo(events[this->nextEvent].cycle, this->nextEvent + 1,
+                  this->movie.keyframes.size());
+      continue;
+    }
+
+    this->RunTo(tick);
+    return this->GetCycle() == tick;
+  }
+
+  return false;
+}
+
+void MoviePlayer::runTo(uint64_t cycle, size_t eventEnd, size_t keyframeEnd) {
+  cycle = std::min(cycle, this->movie.length);
+
+  // Events at an edit's cycle that were recorded before it apply before it
+  const auto &keyframes = this->movie.keyframes;
+  while (this->nextKeyframe < keyframeEnd &&
+         keyframes[this->nextKeyframe].state.cycles <= cycle) {
+    const auto &keyframe = keyframes[this->nextKeyframe];
+    if (keyframe.edit) {
+      this->runEvents(keyframe.state.cycles,
+                      std::min(eventEnd, keyframe.event));
+      if (this->GetCycle() < keyframe.state.cycles) {
+        return;
+      }
+
+      this->restore(keyframe);
+    }
+
+    this->nextKeyframe++;
+  }
+
+  this->runEvents(cycle, eventEnd);
+}
+
+void MoviePlayer::runEvents(uint64_t cycle, size_t eventEnd) {
+  const auto &events = this->movie.events;
+  while (this->nextEvent < eventEnd && events[this->nextEvent].cycle <= cycle) {
+    const auto &event = events[this->nextEvent];
+    if (event.cycle > this->GetCycle()) {
+      this->runCycles(event.cycle - this->GetCycle());
+
+      // Stopped by a debugger; the event waits for the machine to get there
+      if (this->GetCycle() < event.cycle && !this->chip8.IsHalted()) {
+        return;
+      }
+    }
+
+    this->applyEvent(event);
+    this->nextEvent++;
+  }
+
+  if (cycle > this->GetCycle()) {
+    this->runCycles(cycle - this->GetCycle());
+  }
+}
+
+void MoviePlayer::runCycles(uint64_t count) {
+  // The CPU rate only changes between runs, so the ticks follow from the
+  // position between two ticks and the cycles run
+  const uint64_t rate = this->chip8.GetCpuRate();
+  const auto phase = this->chip8.GetState().timerPhase;
+  const auto start = this->GetCycle();
+
+  this->chip8.RunCycles(count);
+  this->frame += static_cast<size_t>(
+      (phase + (this->GetCycle() - start) * 60) / rate);
+}
+
+uint64_t MoviePlayer::GetCycle() const {
+  return this->chip8.GetState().cycles;
+}
+
+size_t MoviePlayer::GetFrame() const { return this->frame; }
+
+bool MoviePlayer::IsFinished() const {
+  return this->GetCycle() >= this->movie.length || this->chip8.IsHalted();
+}
+
+void MoviePlayer::applyEvent(const Movie::Event &event) {
+  switch (event.type) {
+  case Movie::kKeyUp:
+  case Movie::kKeyDown:
+    this->chip8.SetKey(static_cast<uint8_t>(event.value & 0x0F),
+                       event.type == Movie::kKeyDown);
+    break;
+
+  case Movie::kCpuRate:
+    this->chip8.SetCpuRate(static_cast<uint16_t>(event.value));
+    break;
+
+  default:
+    break;
+  }
+}
+
+void MoviePlayer::restore(const InputMovie::Keyframe &keyframe) {
+  this->chip8.SetCpuRate(keyframe.cpuRate);
+  this->chip8.SetState(keyframe.state);
+  this->nextEvent = keyframe.event;
+  this->frame = keyframe.frame;
+}
@@ -0,0 +1,62 @@
+#ifndef MOVIE_PLAYER_H_INCLUDED
+#define MOVIE_PLAYER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Chip8.h"
+#include "Movie.h"
+
+// Plays a movie back on a machine, headless and as fast as possible
+// A debugger attached to the machine may stop playback early; it goes on
+// from there at the next call. Edit keyframes are restored as they are
+// reached.
+class MoviePlayer {
+public:
+  // Starts a new machine from power-on
+  MoviePlayer(const InputMovie &movie, Chip8 &chip8);
+
+  // Jumps to the cycle, starting from the last keyframe before it, so that
+  // at most one keyframe interval is replayed
+  void Seek(uint64_t cycle);
+
+  // Plays until the cycle, or the end of the movie
+  void RunTo(uint64_t cycle);
+
+  // Plays until the state of the keyframe, i.e. to its cycle and applying
+  // only the events and edits before it, so that the machine can be compared
+  // with it (an edit keyframe is restored, so it always matches)
+  void RunToKeyframe(size_t index);
+
+  // Plays until the next 60 Hz timer tick, which ends a frame
+  // Returns false if the movie ended or the machine halted before it
+  bool RunFrame();
+
+  [[nodiscard]] uint64_t GetCycle() const;
+
+  // Frames (60 Hz timer ticks) completed
+  [[nodiscard]] size_t GetFrame() const;
+
+  [[nodiscard]] bool IsFinished() const;
+
+private:
+  // Plays until the cycle, applying the events before eventEnd and the edits
+  // before keyframeEnd at their cycles up to it
+  void runTo(uint64_t cycle, size_t eventEnd, size_t keyframeEnd);
+  void runEvents(uint64_t cycle, size_t eventEnd);
+  void runCycles(uint64_t count);
+  void applyEvent(const Movie::Event &event);
+  void restore(const InputMovie::Keyframe &keyframe);
+
+private:
+  const InputMovie &movie;
+  Chip8 &chip8;
+
+  // Index of the first event, and of the first keyframe after power-on, that
+  // isn't reached yet
+  size_t nextEvent = 0;
+  size_t nextKeyframe = 1;
+  size_t frame = 0;
+};
+
+#endif // MOVIE_PLAYER_H_INCLUDED
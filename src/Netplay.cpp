@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "Netplay.h"
+
+namespace {
+// Constants
+constexpr size_t kMaxPacketSize =
+    sizeof(Netplay::PacketHeader) +
+    Netplay::kMaxInputsPerPacket * sizeof(uint16_t);
+
+constexpr uint64_t kNoMisprediction = std::numeric_limits<uint64_t>::max();
+
+// Functions
+void setKeys(Chip8 &chip8, uint16_t keys);
+} // namespace
+
+RollbackSession::RollbackSession(Chip8 &chip8, PacketChannel &channel,
+                                 size_t maxRollback)
+    : chip8(chip8), channel(channel),
+      maxRollback(std::max<size_t>(maxRollback, 1)),
+      session(chip8.GetState().GetChecksum() ^ chip8.GetCpuRate()),
+      snapshots(this->maxRollback) {}
+
+void RollbackSession::Poll() {
+  std::array<uint8_t, kMaxPacketSize> packet;
+
+  // Roll back once, to the first mispredicted frame of all the packets
+  auto misprediction = kNoMisprediction;
+  for (auto size = this->channel.Receive(packet.data(), packet.size());
+       size != 0; size = this->channel.Receive(packet.data(), packet.size())) {
+    this->receive(packet.data(), size, misprediction);
+  }
+
+  if (misprediction != kNoMisprediction) {
+    this->rollBack(misprediction);
+  }
+}
+
+bool RollbackSession::AdvanceFrame(uint16_t localKeys) {
+  if (this->frame >= this->remoteKeys.size() + this->maxRollback) {
+    this->stats.stalls++;
+    this->SendInputs();
+    return false;
+  }
+
+  this->localKeys.push_back(localKeys);
+  this->predictedKeys.push_back(0);
+  this->runFrame(this->frame++);
+
+  this->SendInputs();
+  return true;
+}
+
+void RollbackSession::SendInputs() {
+  std::array<uint8_t, kMaxPacketSize> packet;
+
+  // The oldest unacknowledged inputs go first, so that the receiver can use
+  // them even if they don't all fit
+  Netplay::PacketHeader header = {};
+  header.magic = Netplay::kMagic;
+  header.frame = static_cast<uint32_t>(this->remoteAck);
+  header.session = this->session;
+  header.ack = static_cast<uint32_t>(this->remoteKeys.size());
+  header.count = static_cast<uint16_t>(
+      std::min(this->localKeys.size() - this->remoteAck,
+               Netplay::kMaxInputsPerPacket));
+
+  std::memcpy(packet.data(), &header, sizeof(header));
+  std::memcpy(packet.data() + sizeof(header),
+              this->localKeys.data() + this->remoteAck,
+              header.count * sizeof(uint16_t));
+  this->channel.Send(packet.data(),
+                     sizeof(header) + header.count * sizeof(uint16_t));
+}
+
+uint64_t RollbackSession::GetFrame() const { return this->frame; }
+
+uint64_t RollbackSession::GetConfirmedFrame() const {
+  return std::min<uint64_t>(this->remoteKeys.size(), this->frame);
+}
+
+const RollbackSession::Stats &RollbackSession::GetStats() const {
+  return this->stats;
+}
+
+void RollbackSession::receive(const uint8_t *data, size_t size,
+                              uint64_t &misprediction) {
+  Netplay::PacketHeader header;
+  if (size < sizeof(header)) {
+    return;
+  }
+
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != Netplay::kMagic ||
+      size != sizeof(header) + header.count * sizeof(uint16_t)) {
+    return;
+  }
+
+  if (header.session != this->session) {
+    throw std::runtime_error(
+        "The netplay peer runs a different ROM, seed or CPU rate.");
+  }
+
+  this->remoteAck = std::clamp<uint64_t>(header.ack, this->remoteAck,
+                                         this->localKeys.size());
+
+  // Only the inputs that follow the known ones are used; packets may arrive
+  // out of order, but the next one repeats whatever is missing
+  for (uint64_t i = 0; i < header.count; i++) {
+    const auto inputFrame = header.frame + i;
+    if (inputFrame < this->remoteKeys.size()) {
+      continue;
+    }
+
+    if (inputFrame > this->remoteKeys.size()) {
+      break;
+    }
+
+    uint16_t keys;
+    std::memcpy(&keys, data + sizeof(header) + i * sizeof(keys),
+                sizeof(keys));
+    this->remoteKeys.push_back(keys);
+
+    if (inputFrame < this->frame &&
+        this->predictedKeys[inputFrame] != keys) {
+      misprediction = std::min(misprediction, inputFrame);
+    }
+  }
+}
+
+void RollbackSession::rollBack(uint64_t frame) {
+  const auto start = std::chrono::steady_clock::now();
+
+  this->chip8.SetState(this->snapshots[frame % this->maxRollback]);
+  for (auto i = frame; i < this->frame; i++) {
+    this->runFrame(i);
+  }
+
+  const auto depth = this->frame - frame;
+  this->stats.rollbacks++;
+  this->stats.resimulatedFrames += depth;
+  this->stats.maxRollback = std::max(this->stats.maxRollback, depth);
+  this->stats.resimulationTime += std::chrono::steady_clock::now() - start;
+}
+
+void RollbackSession::runFrame(uint64_t frame) {
+  // Copying the state only shares its memory pages
+  this->snapshots[frame % this->maxRollback] = this->chip8.GetState();
+
+  const auto remoteKeys = (frame < this->remoteKeys.size())
+                              ? this->remoteKeys[frame]
+                          : this->remoteKeys.empty() ? 0
+                                                     : this->remoteKeys.back();
+  this->predictedKeys[frame] = remoteKeys;
+
+  setKeys(this->chip8,
+          static_cast<uint16_t>(this->localKeys[frame] | remoteKeys));
+  this->chip8.RunFrame();
+}
+
+namespace {
+void setKeys(Chip8 &chip8, uint16_t keys) {
+  const auto &keypad = chip8.GetState().keys;
+  for (uint8_t key = 0; key < keypad.size(); key++) {
+    const auto pressed = ((keys >> key) & 1) != 0;
+    if (keypad[key] != pressed) {
+      chip8.SetKey(key, pressed);
+    }
+  }
+}
+} // namespace
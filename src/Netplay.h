@@ -0,0 +1,110 @@
+#ifndef NETPLAY_H_INCLUDED
+#define NETPLAY_H_INCLUDED
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Chip8.h"
+#include "UdpSocket.h"
+
+// Netplay packet format
+//
+// The header and inputs are sent as laid out in memory, in the byte order of
+// the sender, so both peers must share it.
+//
+// A header, then the sender's keypad (one bit per key) for count frames
+// starting at frame. Each packet repeats every input the receiver hasn't
+// acknowledged yet, so a lost packet needs no retransmission.
+namespace Netplay {
+constexpr std::array<char, 4> kMagic = {'C', '8', 'N', 'P'};
+
+constexpr size_t kDefaultMaxRollback = 8;
+constexpr size_t kMaxInputsPerPacket = 128;
+
+struct PacketHeader {
+  std::array<char, 4> magic;
+  uint32_t frame;
+
+  // Hash of the initial state and CPU rate, which the peers must agree on
+  uint64_t session;
+
+  // Frames of the receiver's inputs that the sender has
+  uint32_t ack;
+  uint16_t count;
+  uint16_t reserved;
+};
+} // namespace Netplay
+
+// Rollback netplay between two peers running the same machine
+//
+// Both peers run frame by frame (Chip8::RunFrame()), and the keypad is the
+// union of both players' keys. The remote keys for frames that haven't
+// arrived yet are predicted to be the last ones received. When they arrive
+// and differ, the machine rolls back to the snapshot taken at the start of
+// the first mispredicted frame and runs the frames since then again.
+class RollbackSession {
+public:
+  struct Stats {
+    uint64_t rollbacks = 0;
+    uint64_t resimulatedFrames = 0;
+    uint64_t maxRollback = 0;
+
+    // AdvanceFrame() calls that waited for the remote player
+    uint64_t stalls = 0;
+
+    std::chrono::steady_clock::duration resimulationTime{};
+  };
+
+public:
+  // The machine must be in the same state on both peers, e.g. right after
+  // LoadRom() with the same random seed and CPU rate
+  // Rolling back further than maxRollback frames is never needed: the local
+  // player waits for the remote one instead
+  RollbackSession(Chip8 &chip8, PacketChannel &channel,
+                  size_t maxRollback = Netplay::kDefaultMaxRollback);
+
+  // Receives the remote inputs, rolling back if a prediction was wrong
+  void Poll();
+
+  // Runs one frame with the local keys (one bit per key)
+  // Returns false without running if the remote player is too far behind
+  bool AdvanceFrame(uint16_t localKeys);
+
+  // Sends the inputs that the remote player hasn't acknowledged yet
+  // (done by AdvanceFrame())
+  void SendInputs();
+
+  // Frames run, and frames whose remote inputs are known
+  [[nodiscard]] uint64_t GetFrame() const;
+  [[nodiscard]] uint64_t GetConfirmedFrame() const;
+
+  [[nodiscard]] const Stats &GetStats() const;
+
+private:
+  void receive(const uint8_t *data, size_t size, uint64_t &misprediction);
+  void rollBack(uint64_t frame);
+  void runFrame(uint64_t frame);
+
+private:
+  Chip8 &chip8;
+  PacketChannel &channel;
+  size_t maxRollback;
+  uint64_t session;
+
+  // Per frame
+  std::vector<uint16_t> localKeys;
+  std::vector<uint16_t> remoteKeys;
+  std::vector<uint16_t> predictedKeys;
+
+  // State at the start of the last maxRollback frames, by frame number
+  std::vector<Chip8State> snapshots;
+
+  uint64_t frame = 0;
+  uint64_t remoteAck = 0;
+  Stats stats;
+};
+
+#endif // NETPLAY_H_INCLUDED
@@ -0,0 +1,246 @@
+#include <array>
+#include <cstdio>
+
+#include "Opcodes.h"
+
+namespace {
+// Constants
+constexpr std::array<const char *, Opcodes::kClassCount> kNames = {
+    "00E0", "00EE", "0NNN", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0",
+    "6XNN", "7XNN", "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5",
+    "8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN",
+    "EX9E", "EXA1", "F002", "FX07", "FX0A", "FX15", "FX18", "FX1E",
+    "FX29", "FX33", "FX3A", "FX55", "FX65", "????"};
+} // namespace
+
+namespace Opcodes {
+Class Classify(uint16_t opcode) {
+  switch (opcode & 0xF000) {
+  case 0x0000:
+    if (opcode == 0x00E0) {
+      return k00E0;
+    }
+
+    return (opcode == 0x00EE) ? k00EE : k0NNN;
+
+  case 0x1000:
+    return k1NNN;
+
+  case 0x2000:
+    return k2NNN;
+
+  case 0x3000:
+    return k3XNN;
+
+  case 0x4000:
+    return k4XNN;
+
+  case 0x5000:
+    // The interpreter ignores the low nibble
+    return k5XY0;
+
+  case 0x6000:
+    return k6XNN;
+
+  case 0x7000:
+    return k7XNN;
+
+  case 0x8000:
+    switch (opcode & 0x000F) {
+    case 0x0:
+      return k8XY0;
+    case 0x1:
+      return k8XY1;
+    case 0x2:
+      return k8XY2;
+    case 0x3:
+      return k8XY3;
+    case 0x4:
+      return k8XY4;
+    case 0x5:
+      return k8XY5;
+    case 0x6:
+      return k8XY6;
+    case 0x7:
+      return k8XY7;
+    case 0xE:
+      return k8XYE;
+    default:
+      return kInvalid;
+    }
+
+  case 0x9000:
+    // The interpreter ignores the low nibble
+    return k9XY0;
+
+  case 0xA000:
+    return kANNN;
+
+  case 0xB000:
+    return kBNNN;
+
+  case 0xC000:
+    return kCXNN;
+
+  case 0xD000:
+    return kDXYN;
+
+  case 0xE000:
+    switch (opcode & 0x00FF) {
+    case 0x9E:
+      return kEX9E;
+    case 0xA1:
+      return kEXA1;
+    default:
+      return kInvalid;
+    }
+
+  default:
+    switch (opcode & 0x00FF) {
+    case 0x02:
+      return (opcode == 0xF002) ? kF002 : kInvalid;
+    case 0x07:
+      return kFX07;
+    case 0x0A:
+      return kFX0A;
+    case 0x15:
+      return kFX15;
+    case 0x18:
+      return kFX18;
+    case 0x1E:
+      return kFX1E;
+    case 0x29:
+      return kFX29;
+    case 0x33:
+      return kFX33;
+    case 0x3A:
+      return kFX3A;
+    case 0x55:
+      return kFX55;
+    case 0x65:
+      return kFX65;
+    default:
+      return kInvalid;
+    }
+  }
+}
+
+const char *GetName(Class opcodeClass) { return kNames.at(opcodeClass); }
+
+std::string Disassemble(uint16_t opcode) {
+  const unsigned int x = (opcode & 0x0F00) >> 8;
+  const unsigned int y = (opcode & 0x00F0) >> 4;
+  const unsigned int n = opcode & 0x000F;
+  const unsigned int nn = opcode & 0x00FF;
+  const unsigned int nnn = opcode & 0x0FFF;
+
+  std::array<char, 32> text;
+  const auto format = [&](const char *pattern, auto... values) {
+    std::snprintf(text.data(), text.size(), pattern, values...);
+    return std::string(text.data());
+  };
+
+  switch (Classify(opcode)) {
+  case k00E0:
+    return "CLS";
+  case k00EE:
+    return "RET";
+  case k0NNN:
+    return format("SYS %03X", nnn);
+  case k1NNN:
+    return format("JP %03X", nnn);
+  case k2NNN:
+    return format("CALL %03X", nnn);
+  case k3XNN:
+    return format("SE V%X, %02X", x, nn);
+  case k4XNN:
+    return format("SNE V%X, %02X", x, nn);
+  case k5XY0:
+    return format("SE V%X, V%X", x, y);
+  case k6XNN:
+    return format("LD V%X, %02X", x, nn);
+  case k7XNN:
+    return format("ADD V%X, %02X", x, nn);
+  case k8XY0:
+    return format("LD V%X, V%X", x, y);
+  case k8XY1:
+    return format("OR V%X, V%X", x, y);
+  case k8XY2:
+    return format("AND V%X, V%X", x, y);
+  case k8XY3:
+    return format("XOR V%X, V%X", x, y);
+  case k8XY4:
+    return format("ADD V%X, V%X", x, y);
+  case k8XY5:
+    return format("SUB V%X, V%X", x, y);
+  case k8XY6:
+    return format("SHR V%X, V%X", x, y);
+  case k8XY7:
+    return format("SUBN V%X, V%X", x, y);
+  case k8XYE:
+    return format("SHL V%X, V%X", x, y);
+  case k9XY0:
+    return format("SNE V%X, V%X", x, y);
+  case kANNN:
+    return format("LD I, %03X", nnn);
+  case kBNNN:
+    return format("JP V0, %03X", nnn);
+  case kCXNN:
+    return format("RND V%X, %02X", x, nn);
+  case kDXYN:
+    return format("DRW V%X, V%X, %X", x, y, n);
+  case kEX9E:
+    return format("SKP V%X", x);
+  case kEXA1:
+    return format("SKNP V%X", x);
+  case kF002:
+    return "AUDIO";
+  case kFX07:
+    return format("LD V%X, DT", x);
+  case kFX0A:
+    return format("LD V%X, K", x);
+  case kFX15:
+    return format("LD DT, V%X", x);
+  case kFX18:
+    return format("LD ST, V%X", x);
+  case kFX1E:
+    return format("ADD I, V%X", x);
+  case kFX29:
+    return format("LD F, V%X", x);
+  case kFX33:
+    return format("LD B, V%X", x);
+  case kFX3A:
+    return format("PITCH V%X", x);
+  case kFX55:
+    return format("LD [I], V%X", x);
+  case kFX65:
+    return format("LD V%X, [I]", x);
+  default:
+    return format("DW %04X", static_cast<unsigned int>(opcode));
+  }
+}
+
+MemoryAccess GetMemoryAccess(uint16_t opcode, uint16_t I) {
+  const auto x = static_cast<uint16_t>((opcode & 0x0F00) >> 8);
+
+  switch (Classify(opcode)) {
+  case kDXYN:
+    return {I, static_cast<uint16_t>(opcode & 0x000F), false};
+
+  case kF002:
+    return {I, 16, false};
+
+  case kFX33:
+    return {I, 3, true};
+
+  case kFX55:
+    return {I, static_cast<uint16_t>(x + 1), true};
+
+  case kFX65:
+    return {I, static_cast<uint16_t>(x + 1), false};
+
+  default:
+    return {};
+  }
+}
+} // namespace Opcodes
@@ -0,0 +1,71 @@
+#ifndef OPCODES_H_INCLUDED
+#define OPCODES_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+namespace Opcodes {
+// Instruction classes, as decoded by the interpreter
+enum Class : uint8_t {
+  k00E0,
+  k00EE,
+  k0NNN,
+  k1NNN,
+  k2NNN,
+  k3XNN,
+  k4XNN,
+  k5XY0,
+  k6XNN,
+  k7XNN,
+  k8XY0,
+  k8XY1,
+  k8XY2,
+  k8XY3,
+  k8XY4,
+  k8XY5,
+  k8XY6,
+  k8XY7,
+  k8XYE,
+  k9XY0,
+  kANNN,
+  kBNNN,
+  kCXNN,
+  kDXYN,
+  kEX9E,
+  kEXA1,
+  kF002,
+  kFX07,
+  kFX0A,
+  kFX15,
+  kFX18,
+  kFX1E,
+  kFX29,
+  kFX33,
+  kFX3A,
+  kFX55,
+  kFX65,
+  kInvalid,
+  kClassCount
+};
+
+[[nodiscard]] Class Classify(uint16_t opcode);
+
+// e.g. "8XY4"
+[[nodiscard]] const char *GetName(Class opcodeClass);
+
+// Assembly for an instruction, in the usual mnemonics (e.g. "ADD V1, V2"),
+// with hexadecimal operands
+[[nodiscard]] std::string Disassemble(uint16_t opcode);
+
+// Memory that an instruction reads or writes through I (size 0 if none),
+// given I before it executes
+struct MemoryAccess {
+  uint16_t address = 0;
+  uint16_t size = 0;
+  bool write = false;
+};
+
+[[nodiscard]] MemoryAccess GetMemoryAccess(uint16_t opcode, uint16_t I);
+} // namespace Opcodes
+
+#endif // OPCODES_H_INCLUDED
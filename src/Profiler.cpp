@@ -0,0 +1,108 @@
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "Profiler.h"
+
+namespace {
+// Functions
+std::ofstream openOutput(const std::string &path);
+std::string formatHex(uint16_t value, int digits);
+} // namespace
+
+std::array<uint64_t, Opcodes::kClassCount> Profiler::GetClassCounts() const {
+  std::array<uint64_t, Opcodes::kClassCount> classCounts = {};
+
+  for (size_t opcode = 0; opcode < this->opcodeCounts.size(); opcode++) {
+    classCounts[Opcodes::Classify(static_cast<uint16_t>(opcode))] +=
+        this->opcodeCounts[opcode];
+  }
+
+  return classCounts;
+}
+
+void Profiler::WriteJson(const std::string &path) const {
+  auto file = openOutput(path);
+  const auto classCounts = this->GetClassCounts();
+
+  file << "{\n  \"instructions\": " << this->instructionCount << ",\n";
+
+  const char *separator = "";
+  file << "  \"classes\": {";
+  for (size_t i = 0; i < classCounts.size(); i++) {
+    if (classCounts[i] != 0) {
+      file << separator << "\n    \""
+           << Opcodes::GetName(static_cast<Opcodes::Class>(i))
+           << "\": " << classCounts[i];
+      separator = ",";
+    }
+  }
+
+  separator = "";
+  file << "\n  },\n  \"opcodes\": {";
+  for (size_t i = 0; i < this->opcodeCounts.size(); i++) {
+    if (this->opcodeCounts[i] != 0) {
+      file << separator << "\n    \"" << formatHex(static_cast<uint16_t>(i), 4)
+           << "\": " << this->opcodeCounts[i];
+      separator = ",";
+    }
+  }
+
+  separator = "";
+  file << "\n  },\n  \"pcs\": {";
+  for (size_t i = 0; i < this->pcCounts.size(); i++) {
+    if (this->pcCounts[i] != 0) {
+      file << separator << "\n    \"" << formatHex(static_cast<uint16_t>(i), 3)
+           << "\": " << this->pcCounts[i];
+      separator = ",";
+    }
+  }
+
+  file << "\n  }\n}\n";
+}
+
+void Profiler::WriteCsv(const std::string &path) const {
+  auto file = openOutput(path);
+  const auto classCounts = this->GetClassCounts();
+
+  file << "kind,key,count\n";
+
+  for (size_t i = 0; i < classCounts.size(); i++) {
+    if (classCounts[i] != 0) {
+      file << "class," << Opcodes::GetName(static_cast<Opcodes::Class>(i))
+           << ',' << classCounts[i] << '\n';
+    }
+  }
+
+  for (size_t i = 0; i < this->opcodeCounts.size(); i++) {
+    if (this->opcodeCounts[i] != 0) {
+      file << "opcode," << formatHex(static_cast<uint16_t>(i), 4) << ','
+           << this->opcodeCounts[i] << '\n';
+    }
+  }
+
+  for (size_t i = 0; i < this->pcCounts.size(); i++) {
+    if (this->pcCounts[i] != 0) {
+      file << "pc," << formatHex(static_cast<uint16_t>(i), 3) << ','
+           << this->pcCounts[i] << '\n';
+    }
+  }
+}
+
+namespace {
+std::ofstream openOutput(const std::string &path) {
+  auto file = std::ofstream(path);
+  if (!file) {
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  return file;
+}
+
+std::string formatHex(uint16_t value, int digits) {
+  std::array<char, 8> buffer;
+  snprintf(buffer.data(), buffer.size(), "0x%0*X", digits, value);
+  return buffer.data();
+}
+} // namespace
@@ -0,0 +1,38 @@
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "Opcodes.h"
+
+// Execution counters per opcode class, per opcode and per PC address
+// Only compiled into the CPU when CHIP8_PROFILER is defined
+class Profiler {
+public:
+  void Record(uint16_t pc, uint16_t opcode) {
+    ++this->opcodeCounts[opcode];
+    ++this->pcCounts[pc & 0xFFF];
+    ++this->instructionCount;
+  }
+
+  [[nodiscard]] const std::array<uint64_t, 4096> &GetPcCounts() const {
+    return this->pcCounts;
+  }
+
+  // Per class counts are derived from the per opcode counts
+  [[nodiscard]] std::array<uint64_t, Opcodes::kClassCount>
+  GetClassCounts() const;
+
+  // Only non-zero counters are written
+  void WriteJson(const std::string &path) const;
+  void WriteCsv(const std::string &path) const;
+
+private:
+  std::array<uint64_t, 65536> opcodeCounts = {};
+  std::array<uint64_t, 4096> pcCounts = {};
+  uint64_t instructionCount = 0;
+};
+
+#endif // PROFILER_H_INCLUDED
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "Interpreter.h"
+#include "Opcodes.h"
+#include "RecompiledBackend.h"
+
+namespace {
+// Constants
+constexpr uint16_t kStart = 0x200;
+
+// Functions
+std::vector<const Recompiled::Module *> &getModules();
+} // namespace
+
+namespace Recompiled {
+void Register(const Module &module) { getModules().push_back(&module); }
+
+const std::vector<const Module *> &GetModules() { return getModules(); }
+} // namespace Recompiled
+
+Fault RecompiledBackend::Step(Chip8State &state) {
+  if (this->stale) {
+    this->update(state);
+  }
+
+  return this->interpret(state);
+}
+
+uint64_t RecompiledBackend::Run(Chip8State &state, uint64_t count,
+                                Fault &fault) {
+  if (this->stale) {
+    this->update(state);
+  }
+
+  uint64_t executed = 0;
+  while (executed < count) {
+    if (state.PC >= Memory::kSize || this->entries[state.PC] == 0) {
+      fault = this->interpret(state);
+      if (fault != Fault::kNone) {
+        return executed;
+      }
+
+      executed++;
+      continue;
+    }
+
+    const auto limit = static_cast<uint32_t>(std::min<uint64_t>(
+        count - executed, std::numeric_limits<uint32_t>::max()));
+    const auto exit = this->module->run(state, this->entries.data(), limit);
+    executed += exit.executed;
+    if (exit.fault != Fault::kNone) {
+      fault = exit.fault;
+      return executed;
+    }
+
+    if (exit.writeSize != 0) {
+      this->checkWrite(state, state.I, exit.writeSize);
+    }
+  }
+
+  return count;
+}
+
+void RecompiledBackend::update(const Chip8State &state) {
+  this->stale = false;
+
+  std::array<uint8_t, Memory::kSize - kStart> rom;
+  state.memory.Read(kStart, rom.data(), rom.size());
+  const auto matches = [&rom](const Recompiled::Module *module) {
+    return module->romSize <= rom.size() &&
+           std::memcmp(module->rom, rom.data(), module->romSize) == 0;
+  };
+
+  // The module compiled for the ROM in memory, if there is one; otherwise
+  // the current module is kept while any of its blocks still matches (code
+  // that modified itself)
+  const auto &modules = Recompiled::GetModules();
+  auto selected = this->module;
+  if (selected == nullptr || !matches(selected)) {
+    const auto found = std::find_if(modules.begin(), modules.end(), matches);
+    if (found != modules.end()) {
+      selected = *found;
+    } else if (selected != nullptr &&
+               this->validate(state, 0, Memory::kSize) != 0) {
+      return;
+    } else {
+      selected = nullptr;
+    }
+  }
+
+  if (selected != this->module) {
+    this->module = selected;
+    this->code.reset();
+    this->entries.fill(0);
+    for (size_t i = 0; selected != nullptr && i < selected->blockCount; i++) {
+      for (size_t address = selected->blocks[i].start;
+           address < selected->blocks[i].end; address++) {
+        this->code.set(address);
+      }
+    }
+  }
+
+  if (this->module != nullptr) {
+    this->validate(state, 0, Memory::kSize);
+  }
+}
+
+size_t RecompiledBackend::validate(const Chip8State &state, size_t start,
+                                   size_t end) {
+  // Checks the blocks that overlap the range, and counts the valid ones
+  std::array<uint8_t, Memory::kSize> bytes;
+  size_t valid = 0;
+  for (size_t i = 0; i < this->module->blockCount; i++) {
+    const auto &block = this->module->blocks[i];
+    if (block.end <= start || block.start >= end) {
+      valid += (this->entries[block.start] != 0) ? 1 : 0;
+      continue;
+    }
+
+    const size_t size = block.end - block.start;
+    state.memory.Read(block.start, bytes.data(), size);
+    const auto matches = std::memcmp(this->module->rom + block.start - kStart,
+                                     bytes.data(), size) == 0;
+    this->entries[block.start] = matches ? static_cast<uint16_t>(i + 1) : 0;
+    valid += matches ? 1 : 0;
+  }
+
+  return valid;
+}
+
+Fault RecompiledBackend::interpret(Chip8State &state) {
+  // Only FX33 and FX55 write, at I, which they leave unchanged
+  const auto opcode = (this->module != nullptr && state.PC < Memory::kSize - 1)
+                          ? state.memory.ReadWord(state.PC)
+                          : 0;
+
+  const auto fault = Interpreter::ExecuteOneInstruction(state);
+  if (fault == Fault::kNone && (opcode & 0xF000) == 0xF000) {
+    const auto access = Opcodes::GetMemoryAccess(opcode, state.I);
+    if (access.write) {
+      this->checkWrite(state, access.address, access.size);
+    }
+  }
+
+  return fault;
+}
+
+void RecompiledBackend::checkWrite(const Chip8State &state, size_t address,
+                                   size_t size) {
+  const auto end = std::min(address + size, Memory::kSize);
+  for (auto i = address; i < end; i++) {
+    if (this->code.test(i)) {
+      this->validate(state, address, end);
+      return;
+    }
+  }
+}
+
+namespace {
+std::vector<const Recompiled::Module *> &getModules() {
+  // Constructed on first use, as modules register during static
+  // initialization
+  static std::vector<const Recompiled::Module *> modules;
+  return modules;
+}
+} // namespace
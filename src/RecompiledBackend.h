@@ -0,0 +1,89 @@
+#ifndef RECOMPILED_BACKEND_H_INCLUDED
+#define RECOMPILED_BACKEND_H_INCLUDED
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Chip8State.h"
+#include "CpuBackend.h"
+
+namespace Recompiled {
+// Where a run of blocks stopped
+struct Exit {
+  uint32_t executed = 0;
+
+  // A faulting instruction sets the fault, as the interpreter does, and isn't
+  // counted
+  Fault fault = Fault::kNone;
+
+  // Bytes written at I by the last instruction (FX33, FX55), or 0; the run
+  // stops after such a write, so that the code can be checked again
+  uint16_t writeSize = 0;
+};
+
+// Runs the block at the PC, then the blocks that follow it while their
+// entries are set, for at most limit instructions (at least 1)
+using RunFunction = Exit (*)(Chip8State &state, const uint16_t *entries,
+                             uint32_t limit);
+
+struct Block {
+  uint16_t start;
+
+  // Address after the last instruction
+  uint16_t end;
+};
+
+// The code of a ROM compiled ahead of time by chip8_recompile
+struct Module {
+  const char *name;
+  const uint8_t *rom;
+  size_t romSize;
+  const Block *blocks;
+  size_t blockCount;
+  RunFunction run;
+};
+
+// Called by the generated translation units when the program starts
+void Register(const Module &module);
+
+[[nodiscard]] const std::vector<const Module *> &GetModules();
+} // namespace Recompiled
+
+// Backend that runs the blocks of the module compiled for the loaded ROM, and
+// the interpreter everywhere else: for code without a module, code reached
+// only through BNNN or copied outside the ROM, and blocks whose bytes no
+// longer match the ROM (self-modified code)
+class RecompiledBackend : public CpuBackend {
+public:
+  [[nodiscard]] const char *GetName() const override { return "recompiled"; }
+
+  Fault Step(Chip8State &state) override;
+  uint64_t Run(Chip8State &state, uint64_t count,
+               Fault &fault) override;
+
+  // The module is selected again, or its blocks checked again, on next use
+  void Invalidate() override { this->stale = true; }
+
+private:
+  void update(const Chip8State &state);
+  size_t validate(const Chip8State &state, size_t start, size_t end);
+  Fault interpret(Chip8State &state);
+  void checkWrite(const Chip8State &state, size_t address, size_t size);
+
+private:
+  const Recompiled::Module *module = nullptr;
+
+  // Bytes of the module's blocks
+  std::bitset<Memory::kSize> code;
+
+  // The index + 1 of the block that starts at each address, if it matches
+  // the memory, or 0 (what the module's run function reads)
+  std::array<uint16_t, Memory::kSize> entries = {};
+
+  bool stale = true;
+};
+
+#endif // RECOMPILED_BACKEND_H_INCLUDED
@@ -0,0 +1,58 @@
+#ifndef RING_BUFFER_H_INCLUDED
+#define RING_BUFFER_H_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single-producer/single-consumer ring buffer
+// Exactly one thread may call Push() and exactly one thread may call Pop()
+template <typename T, size_t Capacity> class RingBuffer {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "The capacity must be a power of two.");
+
+public:
+  // Returns the number of elements that were actually written
+  size_t Push(const T *data, size_t count) {
+    const auto tail = this->tail.load(std::memory_order_relaxed);
+    const auto head = this->head.load(std::memory_order_acquire);
+
+    count = std::min(count, Capacity - (tail - head));
+    for (size_t i = 0; i < count; i++) {
+      this->buffer[(tail + i) & (Capacity - 1)] = data[i];
+    }
+
+    this->tail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Returns the number of elements that were actually read
+  size_t Pop(T *data, size_t count) {
+    const auto head = this->head.load(std::memory_order_relaxed);
+    const auto tail = this->tail.load(std::memory_order_acquire);
+
+    count = std::min(count, tail - head);
+    for (size_t i = 0; i < count; i++) {
+      data[i] = this->buffer[(head + i) & (Capacity - 1)];
+    }
+
+    this->head.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  [[nodiscard]] size_t Size() const {
+    return this->tail.load(std::memory_order_acquire) -
+           this->head.load(std::memory_order_acquire);
+  }
+
+private:
+  std::array<T, Capacity> buffer = {};
+
+  // Indices grow without bound and are masked on access
+  // Keep them on separate cache lines so the two threads don't false share
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif // RING_BUFFER_H_INCLUDED
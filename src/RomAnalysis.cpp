@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "RomAnalysis.h"
+
+namespace {
+// Local types
+// How an instruction passes control on
+enum class Flow { kNext, kJump, kCall, kSkip, kEnd };
+
+// Constants
+constexpr uint16_t kStart = 0x200;
+
+// Functions
+Flow getFlow(uint16_t opcode);
+uint16_t readOpcode(const std::array<uint8_t, Memory::kSize> &memory,
+                    size_t address);
+} // namespace
+
+namespace Analysis {
+Variant GetVariant(uint16_t opcode) {
+  // SCHIP: 00CN, 00FB-00FF, DXY0, FX30, FX75, FX85
+  // XO-CHIP: 00DN, 5XY2, 5XY3, F000, FN01, F002, FX3A
+  if ((opcode & 0xFFF0) == 0x00C0 || (opcode >= 0x00FB && opcode <= 0x00FF) ||
+      (opcode & 0xF00F) == 0xD000) {
+    return kSchip;
+  }
+
+  if ((opcode & 0xFFF0) == 0x00D0 || (opcode & 0xF00E) == 0x5002 ||
+      opcode == 0xF000 || opcode == 0xF002) {
+    return kXoChip;
+  }
+
+  switch (opcode & 0xF0FF) {
+  case 0xF030:
+  case 0xF075:
+  case 0xF085:
+    return kSchip;
+  case 0xF001:
+  case 0xF03A:
+    return kXoChip;
+  default:
+    return kChip8;
+  }
+}
+
+const char *GetVariantName(Variant variant) {
+  switch (variant) {
+  case kSchip:
+    return "SCHIP";
+  case kXoChip:
+    return "XO-CHIP";
+  default:
+    return "CHIP-8";
+  }
+}
+
+uint16_t GetSize(uint16_t opcode) { return (opcode == 0xF000) ? 4 : 2; }
+} // namespace Analysis
+
+RomAnalysis RomAnalysis::Analyze(const uint8_t *rom, size_t size) {
+  if (size > Memory::kSize - kStart) {
+    throw std::runtime_error("The ROM is too large.");
+  }
+
+  std::array<uint8_t, Memory::kSize> memory = {};
+  std::copy(rom, rom + size, memory.begin() + kStart);
+
+  const auto romEnd = kStart + size;
+  const auto getSize = [&](size_t address) {
+    return (address + 1 < romEnd)
+               ? Analysis::GetSize(readOpcode(memory, address))
+               : 2;
+  };
+
+  RomAnalysis analysis;
+
+  // Follow the control flow from each address to visit, marking the
+  // instructions reached and where blocks must start
+  std::bitset<Memory::kSize> leaders;
+  std::vector<size_t> work;
+  const auto visit = [&](size_t address) {
+    if (address < Memory::kSize) {
+      leaders.set(address);
+      work.push_back(address);
+    }
+  };
+
+  visit(kStart);
+  while (!work.empty()) {
+    auto address = work.back();
+    work.pop_back();
+
+    while (address >= kStart && address + getSize(address) <= romEnd &&
+           !analysis.instructions.test(address)) {
+      const auto opcode = readOpcode(memory, address);
+      const auto next = address + getSize(address);
+      analysis.instructions.set(address);
+      for (auto i = address; i < next; i++) {
+        analysis.code.set(i);
+      }
+
+      const auto flow = getFlow(opcode);
+      if (flow == Flow::kNext) {
+        address = next;
+        continue;
+      }
+
+      switch (flow) {
+      case Flow::kJump:
+        visit(opcode & 0x0FFF);
+        break;
+      case Flow::kCall:
+        visit(opcode & 0x0FFF);
+        visit(next);
+        break;
+      case Flow::kSkip:
+        visit(next);
+        visit(next + getSize(next));
+        break;
+      default:
+        break;
+      }
+
+      break;
+    }
+  }
+
+  // Split the instructions into blocks at the leaders and after branches,
+  // tracking I within each block to find the writes over code. A block
+  // starts at each instruction that no earlier block ran on into.
+  std::bitset<Memory::kSize> covered;
+  for (size_t start = kStart; start < romEnd; start++) {
+    if (!analysis.instructions.test(start) || covered.test(start)) {
+      continue;
+    }
+
+    Analysis::Block block = {static_cast<uint16_t>(start), 0, {}};
+    auto knownI = false;
+    size_t I = 0;
+
+    auto address = start;
+    while (true) {
+      covered.set(address);
+      const auto opcode = readOpcode(memory, address);
+      const auto next = address + getSize(address);
+      const auto x = (opcode & 0x0F00) >> 8;
+
+      switch (Opcodes::Classify(opcode)) {
+      case Opcodes::kANNN:
+        knownI = true;
+        I = opcode & 0x0FFF;
+        break;
+
+      case Opcodes::kFX1E:
+      case Opcodes::kFX29:
+        knownI = false;
+        break;
+
+      case Opcodes::kFX33:
+      case Opcodes::kFX55: {
+        const size_t writeSize = ((opcode & 0x00FF) == 0x33) ? 3 : x + 1;
+        if (!knownI) {
+          analysis.unknownWrites++;
+          break;
+        }
+
+        for (auto i = I; i < std::min(I + writeSize, Memory::kSize); i++) {
+          if (analysis.code.test(i)) {
+            analysis.selfModifyingWrites.push_back(
+                {static_cast<uint16_t>(address), static_cast<uint16_t>(I),
+                 static_cast<uint16_t>(writeSize)});
+            break;
+          }
+        }
+      } break;
+
+      default:
+        // XO-CHIP's F000 NNNN loads a 16-bit address
+        if (opcode == 0xF000 && address + 3 < romEnd) {
+          knownI = true;
+          I = readOpcode(memory, address + 2) % Memory::kSize;
+        }
+        break;
+      }
+
+      const auto flow = getFlow(opcode);
+      auto &successors = block.successors;
+      if (flow == Flow::kJump) {
+        successors.push_back(opcode & 0x0FFF);
+      } else if (flow == Flow::kCall) {
+        successors.push_back(opcode & 0x0FFF);
+        successors.push_back(static_cast<uint16_t>(next));
+      } else if (flow == Flow::kSkip) {
+        successors.push_back(static_cast<uint16_t>(next));
+        successors.push_back(static_cast<uint16_t>(next + getSize(next)));
+      } else if (flow == Flow::kNext && next < Memory::kSize &&
+                 analysis.instructions.test(next) && !leaders.test(next)) {
+        address = next;
+        continue;
+      } else if (flow == Flow::kNext && next < Memory::kSize &&
+                 analysis.instructions.test(next)) {
+        successors.push_back(static_cast<uint16_t>(next));
+      }
+
+      block.end = static_cast<uint16_t>(next);
+      break;
+    }
+
+    analysis.blocks.push_back(std::move(block));
+  }
+
+  for (size_t address = kStart; address < romEnd; address++) {
+    if (!analysis.instructions.test(address)) {
+      continue;
+    }
+
+    const auto opcode = readOpcode(memory, address);
+    const auto opcodeClass = Opcodes::Classify(opcode);
+    const auto variant = Analysis::GetVariant(opcode);
+    analysis.classCounts[opcodeClass]++;
+
+    if (variant != Analysis::kChip8) {
+      analysis.variantOpcodes.push_back(static_cast<uint16_t>(address));
+      analysis.variant = std::max(analysis.variant, variant);
+    } else if (opcodeClass == Opcodes::kInvalid) {
+      analysis.invalidOpcodes.push_back(static_cast<uint16_t>(address));
+    } else if (opcodeClass == Opcodes::kBNNN) {
+      analysis.indirectJumps.push_back(static_cast<uint16_t>(address));
+    }
+  }
+
+  return analysis;
+}
+
+namespace {
+Flow getFlow(uint16_t opcode) {
+  // Opcodes of later variants run on, except for SCHIP's exit
+  if (Analysis::GetVariant(opcode) != Analysis::kChip8) {
+    return (opcode == 0x00FD) ? Flow::kEnd : Flow::kNext;
+  }
+
+  switch (Opcodes::Classify(opcode)) {
+  case Opcodes::k1NNN:
+    return Flow::kJump;
+
+  case Opcodes::k2NNN:
+    return Flow::kCall;
+
+  case Opcodes::k3XNN:
+  case Opcodes::k4XNN:
+  case Opcodes::k5XY0:
+  case Opcodes::k9XY0:
+  case Opcodes::kEX9E:
+  case Opcodes::kEXA1:
+    return Flow::kSkip;
+
+  case Opcodes::k00EE:
+  case Opcodes::kBNNN:
+  case Opcodes::kInvalid:
+    return Flow::kEnd;
+
+  default:
+    return Flow::kNext;
+  }
+}
+
+uint16_t readOpcode(const std::array<uint8_t, Memory::kSize> &memory,
+                    size_t address) {
+  return static_cast<uint16_t>((memory[address] << 8) |
+                               memory[(address + 1) % Memory::kSize]);
+}
+} // namespace
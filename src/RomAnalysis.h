@@ -0,0 +1,78 @@
+#ifndef ROM_ANALYSIS_H_INCLUDED
+#define ROM_ANALYSIS_H_INCLUDED
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Memory.h"
+#include "Opcodes.h"
+
+namespace Analysis {
+// The CHIP-8 variant that introduced an opcode
+// Only CHIP-8 opcodes, and the XO-CHIP audio ones (F002, FX3A), run here
+enum Variant : uint8_t { kChip8, kSchip, kXoChip };
+
+[[nodiscard]] Variant GetVariant(uint16_t opcode);
+[[nodiscard]] const char *GetVariantName(Variant variant);
+
+// Size of the instruction in bytes (XO-CHIP's F000 NNNN takes 4)
+[[nodiscard]] uint16_t GetSize(uint16_t opcode);
+
+// Instructions that run one after the other, entered only at the first one
+struct Block {
+  uint16_t start;
+
+  // Address after the last instruction
+  uint16_t end;
+
+  // Where execution goes on after the block; none for a BNNN jump, whose
+  // target depends on V0
+  std::vector<uint16_t> successors;
+};
+
+// FX33 or FX55 that writes over reached code
+struct Write {
+  uint16_t address;
+  uint16_t target;
+  uint16_t size;
+};
+} // namespace Analysis
+
+// The code of a ROM, found without running it
+//
+// Control flow is followed from 0x200 through jumps (1NNN), calls (2NNN) and
+// what follows them, both ways of skips, and returns (00EE). It stops at
+// BNNN jumps, SCHIP's exit (00FD), opcodes of no variant (most likely data)
+// and addresses outside the ROM. Writes are checked against the code where
+// I is known, i.e. set by ANNN earlier in the same block.
+struct RomAnalysis {
+  // The first byte of each instruction reached, and every byte of them
+  std::bitset<Memory::kSize> instructions;
+  std::bitset<Memory::kSize> code;
+
+  // In order of address
+  std::vector<Analysis::Block> blocks;
+
+  // Instructions reached, by class
+  std::array<uint32_t, Opcodes::kClassCount> classCounts = {};
+
+  // Addresses of the instructions reached that are of interest
+  std::vector<uint16_t> indirectJumps;
+  std::vector<uint16_t> variantOpcodes;
+  std::vector<uint16_t> invalidOpcodes;
+
+  // The latest variant of the opcodes reached
+  Analysis::Variant variant = Analysis::kChip8;
+
+  std::vector<Analysis::Write> selfModifyingWrites;
+
+  // FX33 and FX55 reached where I isn't known
+  size_t unknownWrites = 0;
+
+  static RomAnalysis Analyze(const uint8_t *rom, size_t size);
+};
+
+#endif // ROM_ANALYSIS_H_INCLUDED
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "RomPack.h"
+#include "Util.h"
+
+RomPack::RomPack(const std::string &path)
+    : file(MappedFile::OpenReadOnly(path)) {
+  const auto data = this->file.GetData();
+  const auto size = this->file.GetSize();
+
+  Pack::FileHeader header;
+  if (size < sizeof(header)) {
+    throw std::runtime_error("Not a ROM pack: " + path);
+  }
+
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != Pack::kMagic) {
+    throw std::runtime_error("Not a ROM pack: " + path);
+  }
+
+  if (header.entryCount > (size - sizeof(header)) / sizeof(Pack::Entry)) {
+    throw std::runtime_error("The ROM pack is truncated: " + path);
+  }
+
+  // Only the index is copied out of the mapping, and validated once so that
+  // the images can be used without any checks
+  this->entries.resize(header.entryCount);
+  std::memcpy(this->entries.data(), data + sizeof(header),
+              this->entries.size() * sizeof(Pack::Entry));
+
+  for (const auto &entry : this->entries) {
+    if (entry.offset > size || entry.size > size - entry.offset) {
+      throw std::runtime_error("The ROM pack is truncated: " + path);
+    }
+  }
+}
+
+void RomPack::Write(const std::string &path, const std::vector<Image> &images) {
+  auto offset = sizeof(Pack::FileHeader) + images.size() * sizeof(Pack::Entry);
+  std::vector<Pack::Entry> index;
+
+  for (const auto &image : images) {
+    if (image.name.size() >= Pack::kNameSize) {
+      throw std::runtime_error("The ROM name is too long: " + image.name);
+    }
+
+    Pack::Entry entry = {};
+    entry.hash = Util::HashFnv1a(image.data.data(), image.data.size());
+    entry.offset = static_cast<uint32_t>(offset);
+    entry.size = static_cast<uint32_t>(image.data.size());
+    entry.quirks = image.quirks;
+    std::memcpy(entry.name.data(), image.name.data(), image.name.size());
+
+    index.push_back(entry);
+    offset += image.data.size();
+  }
+
+  auto file = MappedFile::Create(path, offset);
+  const auto data = file.GetData();
+
+  Pack::FileHeader header = {};
+  header.magic = Pack::kMagic;
+  header.entryCount = static_cast<uint32_t>(index.size());
+  std::memcpy(data, &header, sizeof(header));
+  std::memcpy(data + sizeof(header), index.data(),
+              index.size() * sizeof(Pack::Entry));
+
+  for (size_t i = 0; i < images.size(); i++) {
+    std::memcpy(data + index[i].offset, images[i].data.data(),
+                images[i].data.size());
+  }
+}
+
+const Pack::Entry &RomPack::GetEntry(size_t index) const {
+  return this->entries.at(index);
+}
+
+std::string RomPack::GetName(size_t index) const {
+  const auto &name = this->entries.at(index).name;
+  return std::string(name.begin(), std::find(name.begin(), name.end(), '\0'));
+}
+
+const uint8_t *RomPack::GetData(size_t index) const {
+  return this->file.GetData() + this->entries.at(index).offset;
+}
+
+bool RomPack::Verify(size_t index) const {
+  const auto &entry = this->entries.at(index);
+  return Util::HashFnv1a(this->GetData(index), entry.size) == entry.hash;
+}
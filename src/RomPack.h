@@ -0,0 +1,75 @@
+#ifndef ROM_PACK_H_INCLUDED
+#define ROM_PACK_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Indexed ROM pack format
+//
+// The header and index entries are the structs below as laid out in memory,
+// in the byte order of the machine that packed them.
+//
+// A header, an index of fixed-size entries, then the ROM images back to back.
+// The pack is mapped once, and the images are copied straight from the
+// mapping into the memory of each machine.
+namespace Pack {
+constexpr std::array<char, 8> kMagic = {'C', '8', 'R', 'O', 'M', 'P', 'K', '1'};
+constexpr size_t kNameSize = 40;
+
+// Behavior profile that a ROM expects from the interpreter
+// Only the profile of the original COSMAC VIP interpreter is implemented
+enum Quirks : uint32_t { kQuirksDefault = 0 };
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint32_t entryCount;
+  uint32_t reserved;
+};
+
+struct Entry {
+  // FNV-1a of the image
+  uint64_t hash;
+
+  // Offset of the image from the start of the file
+  uint32_t offset;
+  uint32_t size;
+  uint32_t quirks;
+  uint32_t reserved;
+
+  // NUL-padded file name
+  std::array<char, kNameSize> name;
+};
+} // namespace Pack
+
+// Read-only view of a pack
+class RomPack {
+public:
+  struct Image {
+    std::string name;
+    std::vector<uint8_t> data;
+    uint32_t quirks = Pack::kQuirksDefault;
+  };
+
+public:
+  explicit RomPack(const std::string &path);
+
+  static void Write(const std::string &path, const std::vector<Image> &images);
+
+  [[nodiscard]] size_t GetCount() const { return this->entries.size(); }
+  [[nodiscard]] const Pack::Entry &GetEntry(size_t index) const;
+  [[nodiscard]] std::string GetName(size_t index) const;
+  [[nodiscard]] const uint8_t *GetData(size_t index) const;
+
+  // Whether the image still matches the hash it was packed with
+  [[nodiscard]] bool Verify(size_t index) const;
+
+private:
+  MappedFile file;
+  std::vector<Pack::Entry> entries;
+};
+
+#endif // ROM_PACK_H_INCLUDED
@@ -0,0 +1,50 @@
+#ifndef SCRIPTED_INPUT_H_INCLUDED
+#define SCRIPTED_INPUT_H_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Chip8.h"
+
+// Deterministic keypad input for headless runs: every interval
+// instructions, one pseudo-random key is toggled
+class ScriptedInput {
+public:
+  ScriptedInput(uint32_t seed, uint64_t interval)
+      : random(seed | 1), interval(std::max<uint64_t>(interval, 1)) {}
+
+  [[nodiscard]] uint64_t GetInterval() const { return this->interval; }
+
+  // The key to toggle at the next multiple of the interval
+  uint8_t NextKey() {
+    // xorshift32
+    this->random ^= this->random << 13;
+    this->random ^= this->random >> 17;
+    this->random ^= this->random << 5;
+    return static_cast<uint8_t>(this->random & 0xF);
+  }
+
+  // Runs count instructions, toggling keys at the scripted instructions
+  void Run(Chip8 &chip8, uint64_t count) {
+    while (count > 0) {
+      if (this->position % this->interval == 0) {
+        const auto key = this->NextKey();
+        chip8.SetKey(key, !chip8.GetState().keys.at(key));
+      }
+
+      const auto segment =
+          std::min(count, this->interval - this->position % this->interval);
+      chip8.RunCycles(segment);
+
+      this->position += segment;
+      count -= segment;
+    }
+  }
+
+private:
+  uint32_t random;
+  uint64_t interval;
+  uint64_t position = 0;
+};
+
+#endif // SCRIPTED_INPUT_H_INCLUDED
@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "MoviePlayer.h"
+#include "TimeTravel.h"
+
+TimeTravel::TimeTravel(Chip8 &chip8, MovieRecorder &recorder)
+    : chip8(chip8), recorder(recorder) {}
+
+void TimeTravel::Rewind(uint64_t cycle) {
+  // Re-execution runs on a machine of its own, headless
+  Chip8 replay;
+  replay.SetTrapPolicy(TrapPolicy::kHalt);
+  MoviePlayer player(this->recorder.GetMovie(this->chip8.GetState()),
+                     replay);
+  player.Seek(cycle);
+
+  this->chip8.SetState(replay.GetState());
+  this->recorder.Truncate(player.GetCycle(), player.GetFrame());
+
+  // The movie already has the rate at the cycle
+  this->chip8.SetMovieRecorder(nullptr);
+  this->chip8.SetCpuRate(replay.GetCpuRate());
+  this->chip8.SetMovieRecorder(&this->recorder);
+}
+
+bool TimeTravel::ReverseStep(Debugger &debugger) {
+  const auto cycle = this->chip8.GetState().cycles;
+  if (cycle == 0) {
+    return false;
+  }
+
+  this->Rewind(cycle - 1);
+  debugger.SyncConditions(this->chip8.GetState());
+  debugger.Break({});
+  return true;
+}
+
+bool TimeTravel::ReverseContinue(Debugger &debugger) {
+  const auto end = this->chip8.GetState().cycles;
+  const auto &movie = this->recorder.GetMovie(this->chip8.GetState());
+  const auto &keyframes = movie.keyframes;
+  Chip8 replay;
+  replay.SetTrapPolicy(TrapPolicy::kHalt);
+  MoviePlayer player(movie, replay);
+
+  // Search the intervals between keyframes from the last one, replaying each
+  // with a copy of the debugger for its last stop before the end
+  auto index = static_cast<size_t>(
+      std::lower_bound(keyframes.begin(), keyframes.end(), end,
+                       [](const InputMovie::Keyframe &keyframe,
+                          uint64_t value) {
+                         return keyframe.state.cycles < value;
+                       }) -
+      keyframes.begin());
+  while (index-- > 0) {
+    const auto start = keyframes[index].state.cycles;
+    const auto intervalEnd =
+        (index + 1 < keyframes.size())
+            ? std::min(keyframes[index + 1].state.cycles, end)
+            : end;
+
+    replay.SetDebugger(nullptr);
+    player.Seek(start);
+
+    auto replayDebugger = debugger;
+    replayDebugger.SyncConditions(replay.GetState());
+    replay.SetDebugger(&replayDebugger);
+
+    auto found = false;
+    uint64_t foundCycle = 0;
+    auto foundDebugger = debugger;
+    if (replayDebugger.CheckBefore(replay.GetState())) {
+      found = true;
+      foundCycle = start;
+      foundDebugger = replayDebugger;
+    }
+
+    while (true) {
+      replayDebugger.Continue();
+      player.RunTo(intervalEnd);
+
+      // A fault can only be where the machine is now
+      if (!replayDebugger.IsStopped() || player.GetCycle() >= end ||
+          replayDebugger.GetStop().signal != Debugger::Stop::kSigTrap) {
+        break;
+      }
+
+      found = true;
+      foundCycle = player.GetCycle();
+      foundDebugger = replayDebugger;
+    }
+
+    replay.SetDebugger(nullptr);
+
+    if (found) {
+      this->Rewind(foundCycle);
+      debugger = foundDebugger;
+      return true;
+    }
+  }
+
+  this->Rewind(0);
+  debugger.SyncConditions(this->chip8.GetState());
+  debugger.Break({});
+  return false;
+}
+
+void TimeTravel::OnStateChanged() {
+  this->recorder.AddKeyframe(this->chip8.GetState(),
+                             this->chip8.GetCpuRate());
+}
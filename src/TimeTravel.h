@@ -0,0 +1,43 @@
+#ifndef TIME_TRAVEL_H_INCLUDED
+#define TIME_TRAVEL_H_INCLUDED
+
+#include <cstdint>
+
+#include "Chip8.h"
+#include "Debugger.h"
+#include "Movie.h"
+
+// Reverse execution for a machine that records a movie from power-on
+//
+// The movie's keyframes are the snapshots, and its input (key and CPU rate
+// changes; the random state is part of the machine's) makes re-executing it
+// from the last keyframe before a cycle exact. So going back one instruction
+// re-executes at most one keyframe interval, however long the session.
+// Going back discards what was recorded after that point: the machine goes
+// on from there with new input.
+class TimeTravel {
+public:
+  TimeTravel(Chip8 &chip8, MovieRecorder &recorder);
+
+  // Takes the machine back to the cycle, before the instruction at it
+  void Rewind(uint64_t cycle);
+
+  // Goes back one instruction, where the debugger stops
+  // Returns false at power-on
+  bool ReverseStep(Debugger &debugger);
+
+  // Goes back to the last stop of the debugger before the current cycle,
+  // with the debugger as it was then, or to power-on if there is none
+  // Returns whether there was one
+  bool ReverseContinue(Debugger &debugger);
+
+  // Keeps a state changed from outside the machine (e.g. a register written
+  // by a debugger), which re-execution can't reproduce
+  void OnStateChanged();
+
+private:
+  Chip8 &chip8;
+  MovieRecorder &recorder;
+};
+
+#endif // TIME_TRAVEL_H_INCLUDED
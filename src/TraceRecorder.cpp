@@ -0,0 +1,97 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "TraceRecorder.h"
+
+namespace {
+// Functions
+uint8_t *writeUint16(uint8_t *out, uint16_t value);
+} // namespace
+
+TraceRecorder::TraceRecorder(const std::string &path, size_t size) {
+  this->chunkCount = (size - Trace::kFileHeaderSize) / Trace::kChunkSize;
+  if (size < Trace::kFileHeaderSize || this->chunkCount == 0) {
+    throw std::runtime_error("The trace file is too small.");
+  }
+
+  this->file = MappedFile::Create(
+      path, Trace::kFileHeaderSize + this->chunkCount * Trace::kChunkSize);
+
+  const Trace::FileHeader header = {
+      Trace::kMagic, static_cast<uint32_t>(Trace::kChunkSize),
+      static_cast<uint32_t>(this->chunkCount)};
+  std::memcpy(this->file.GetData(), &header, sizeof(header));
+}
+
+void TraceRecorder::Record(uint64_t cycle, uint16_t pc, uint16_t opcode,
+                           uint16_t I, const std::array<uint8_t, 16> &V) {
+  if (this->chunk == nullptr ||
+      this->used + Trace::kMaxRecordSize >
+          Trace::kChunkSize - sizeof(Trace::ChunkHeader)) {
+    this->beginChunk(cycle);
+  }
+
+  auto start = this->records + this->used;
+  auto out = writeUint16(start + 1, opcode);
+  uint8_t flags = 0;
+
+  // The first record has nothing to be relative to
+  if (!this->primed || pc != static_cast<uint16_t>(this->lastPC + 2)) {
+    flags |= Trace::kExplicitPC;
+    out = writeUint16(out, pc);
+  }
+
+  if (!this->primed || I != this->lastI) {
+    flags |= Trace::kChangedI;
+    out = writeUint16(out, I);
+  }
+
+  if (!this->primed ||
+      std::memcmp(V.data(), this->lastV.data(), V.size()) != 0) {
+    flags |= Trace::kChangedV;
+
+    auto maskOut = out;
+    out += 2;
+
+    uint16_t mask = 0;
+    for (size_t i = 0; i < V.size(); i++) {
+      if (!this->primed || V[i] != this->lastV[i]) {
+        mask |= static_cast<uint16_t>(1 << i);
+        *out++ = V[i];
+      }
+    }
+
+    writeUint16(maskOut, mask);
+  }
+
+  *start = flags;
+  this->used = static_cast<size_t>(out - this->records);
+  this->chunk->used = static_cast<uint32_t>(this->used);
+
+  this->primed = true;
+  this->lastPC = pc;
+  this->lastI = I;
+  this->lastV = V;
+}
+
+void TraceRecorder::beginChunk(uint64_t cycle) {
+  ++this->sequence;
+
+  auto data = this->file.GetData() + Trace::kFileHeaderSize +
+              ((this->sequence - 1) % this->chunkCount) * Trace::kChunkSize;
+
+  this->chunk = reinterpret_cast<Trace::ChunkHeader *>(data);
+  this->records = data + sizeof(Trace::ChunkHeader);
+  this->used = 0;
+
+  *this->chunk = {this->sequence, cycle,      0,
+                  this->lastPC,   this->lastI, this->lastV};
+}
+
+namespace {
+uint8_t *writeUint16(uint8_t *out, uint16_t value) {
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>(value >> 8);
+  return out + 2;
+}
+} // namespace
@@ -0,0 +1,89 @@
+#ifndef TRACE_RECORDER_H_INCLUDED
+#define TRACE_RECORDER_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+
+// Binary execution trace format
+//
+// The file and chunk headers are the structs below as laid out in memory, in
+// the byte order of the machine that recorded them; records are little-endian.
+// The file is a header followed by a ring of fixed-size chunks. Each chunk
+// starts with a keyframe (the state before its first record) so that it can
+// be decoded on its own after older chunks have been overwritten.
+//
+// A record is one executed instruction:
+//   uint8_t flags
+//   uint16_t opcode
+//   uint16_t PC           if kExplicitPC, otherwise the previous PC + 2
+//   uint16_t I            if kChangedI
+//   uint16_t mask         if kChangedV, followed by one byte per set bit
+//                         (the new values of the changed registers)
+namespace Trace {
+constexpr std::array<char, 8> kMagic = {'C', '8', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr size_t kFileHeaderSize = 64;
+constexpr size_t kChunkSize = 64 * 1024;
+constexpr size_t kMaxRecordSize = 1 + 2 + 2 + 2 + 2 + 16;
+
+enum RecordFlags : uint8_t {
+  kExplicitPC = 1 << 0,
+  kChangedI = 1 << 1,
+  kChangedV = 1 << 2,
+};
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint32_t chunkSize;
+  uint32_t chunkCount;
+};
+
+struct ChunkHeader {
+  // Chunks are numbered from 1; 0 means the chunk was never written
+  uint64_t sequence;
+
+  // Cycle of the first record in the chunk
+  uint64_t cycle;
+
+  // Bytes of records following the header
+  uint32_t used;
+
+  // Keyframe
+  uint16_t PC;
+  uint16_t I;
+  std::array<uint8_t, 16> V;
+};
+} // namespace Trace
+
+// Writes the trace to a memory-mapped ring file
+// Once the file is full, the oldest chunks are overwritten
+class TraceRecorder {
+public:
+  TraceRecorder(const std::string &path, size_t size);
+
+  // Called after each instruction, or faulting one that was skipped, with its
+  // PC and opcode and the new state
+  void Record(uint64_t cycle, uint16_t pc, uint16_t opcode, uint16_t I,
+              const std::array<uint8_t, 16> &V);
+
+private:
+  void beginChunk(uint64_t cycle);
+
+private:
+  MappedFile file;
+  size_t chunkCount = 0;
+  uint64_t sequence = 0;
+  Trace::ChunkHeader *chunk = nullptr;
+  uint8_t *records = nullptr;
+  size_t used = 0;
+
+  // State as of the last record; the deltas are relative to it
+  bool primed = false;
+  uint16_t lastPC = 0;
+  uint16_t lastI = 0;
+  std::array<uint8_t, 16> lastV = {};
+};
+
+#endif // TRACE_RECORDER_H_INCLUDED
@@ -0,0 +1,60 @@
+#ifndef TRAP_H_INCLUDED
+#define TRAP_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Reasons an instruction can't be executed
+// (Overflowing the stack isn't one; see Interpreter::ExecuteOneInstruction())
+enum class Fault : uint8_t {
+  kNone,
+  kInvalidOpcode,
+  kStackUnderflow,
+  kMemoryAccess,
+  kInvalidKey
+};
+
+// What a machine does when an instruction faults
+enum class TrapPolicy : uint8_t {
+  // Stop, with the PC at the faulting instruction, until the state is reset
+  kHalt,
+  // Skip the instruction, as if it were a NOP
+  kIgnore,
+  // Throw a std::runtime_error
+  kRaise
+};
+
+// A fault, and the instruction that caused it
+struct Trap {
+  Fault fault = Fault::kNone;
+  uint16_t pc = 0;
+  uint16_t opcode = 0;
+
+  [[nodiscard]] std::string GetMessage() const {
+    std::array<char, 64> buffer;
+    switch (this->fault) {
+    case Fault::kNone:
+      return "No fault.";
+
+    case Fault::kInvalidOpcode:
+      std::snprintf(buffer.data(), buffer.size(), "Invalid opcode: 0x%02X",
+                    this->opcode);
+      return buffer.data();
+
+    case Fault::kStackUnderflow:
+      return "Corrupted stack.";
+
+    case Fault::kMemoryAccess:
+      return "Memory address out of range.";
+
+    case Fault::kInvalidKey:
+      return "Invalid key.";
+    }
+
+    return "Unknown fault.";
+  }
+};
+
+#endif // TRAP_H_INCLUDED
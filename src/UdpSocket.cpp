@@ -0,0 +1,127 @@
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "UdpSocket.h"
+
+namespace {
+// Functions
+sockaddr_in resolve(const std::string &host, uint16_t port);
+} // namespace
+
+#ifdef _WIN32
+UdpSocket::UdpSocket(uint16_t port) {
+  static const bool initialized = [] {
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  }();
+  if (!initialized) {
+    throw std::runtime_error("Could not initialize Winsock.");
+  }
+
+  this->socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (this->socket == INVALID_SOCKET) {
+    throw std::runtime_error("Could not create a UDP socket.");
+  }
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+
+  u_long nonBlocking = 1;
+  if (bind(this->socket, reinterpret_cast<const sockaddr *>(&address),
+           sizeof(address)) != 0 ||
+      ioctlsocket(this->socket, FIONBIO, &nonBlocking) != 0) {
+    closesocket(this->socket);
+    throw std::runtime_error("Could not bind to UDP port " +
+                             std::to_string(port) + ".");
+  }
+}
+
+UdpSocket::~UdpSocket() { closesocket(this->socket); }
+#else
+UdpSocket::UdpSocket(uint16_t port) {
+  this->socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (this->socket < 0) {
+    throw std::runtime_error("Could not create a UDP socket.");
+  }
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+
+  if (bind(this->socket, reinterpret_cast<const sockaddr *>(&address),
+           sizeof(address)) != 0 ||
+      fcntl(this->socket, F_SETFL, O_NONBLOCK) != 0) {
+    close(this->socket);
+    throw std::runtime_error("Could not bind to UDP port " +
+                             std::to_string(port) + ".");
+  }
+}
+
+UdpSocket::~UdpSocket() { close(this->socket); }
+#endif
+
+void UdpSocket::Connect(const std::string &host, uint16_t port) {
+  const auto address = resolve(host, port);
+  if (connect(this->socket, reinterpret_cast<const sockaddr *>(&address),
+              sizeof(address)) != 0) {
+    throw std::runtime_error("Could not connect to " + host + ":" +
+                             std::to_string(port) + ".");
+  }
+}
+
+void UdpSocket::Send(const uint8_t *data, size_t size) {
+  // A datagram that can't be sent is as good as lost, which the protocol
+  // above has to handle anyway
+  send(this->socket, reinterpret_cast<const char *>(data),
+       static_cast<int>(size), 0);
+}
+
+size_t UdpSocket::Receive(uint8_t *data, size_t size) {
+  // Errors include the peer's port being closed (e.g. it hasn't started
+  // yet), which is the same as nothing received
+  const auto received = recv(this->socket, reinterpret_cast<char *>(data),
+                             static_cast<int>(size), 0);
+  return (received > 0) ? static_cast<size_t>(received) : 0;
+}
+
+uint16_t UdpSocket::GetPort() const {
+  sockaddr_in address = {};
+  socklen_t length = sizeof(address);
+  getsockname(this->socket, reinterpret_cast<sockaddr *>(&address), &length);
+  return ntohs(address.sin_port);
+}
+
+namespace {
+sockaddr_in resolve(const std::string &host, uint16_t port) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  addrinfo *result = nullptr;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 ||
+      result == nullptr) {
+    throw std::runtime_error("Could not resolve the host: " + host);
+  }
+
+  sockaddr_in address;
+  std::memcpy(&address, result->ai_addr, sizeof(address));
+  address.sin_port = htons(port);
+  freeaddrinfo(result);
+  return address;
+}
+} // namespace
@@ -0,0 +1,45 @@
+#ifndef UDP_SOCKET_H_INCLUDED
+#define UDP_SOCKET_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Sends and receives datagrams, e.g. to a netplay peer
+class PacketChannel {
+public:
+  virtual ~PacketChannel() = default;
+
+  virtual void Send(const uint8_t *data, size_t size) = 0;
+
+  // Returns the size of the next datagram, or 0 if there is none yet
+  virtual size_t Receive(uint8_t *data, size_t size) = 0;
+};
+
+// A non-blocking UDP socket that talks to a single peer
+class UdpSocket : public PacketChannel {
+public:
+  // Binds to the port on all interfaces (0 for any free port)
+  explicit UdpSocket(uint16_t port);
+  ~UdpSocket() override;
+
+  UdpSocket(const UdpSocket &) = delete;
+  UdpSocket &operator=(const UdpSocket &) = delete;
+
+  // Sets the peer that datagrams are sent to and received from
+  void Connect(const std::string &host, uint16_t port);
+
+  void Send(const uint8_t *data, size_t size) override;
+  size_t Receive(uint8_t *data, size_t size) override;
+
+  [[nodiscard]] uint16_t GetPort() const;
+
+private:
+#ifdef _WIN32
+  uintptr_t socket;
+#else
+  int socket;
+#endif
+};
+
+#endif // UDP_SOCKET_H_INCLUDED
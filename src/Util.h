@@ -7,7 +7,16 @@
 #include <vector>
 
 namespace Util {
-std::vector<uint8_t> FileReadBinary(const std::string &path) {
+inline uint64_t HashFnv1a(const uint8_t *data, size_t size) {
+  uint64_t hash = 0xCBF29CE484222325;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001B3;
+  }
+
+  return hash;
+}
+
+inline std::vector<uint8_t> FileReadBinary(const std::string &path) {
   auto file = std::ifstream(path, std::ios::binary);
   if (!file) {
     throw std::runtime_error("Could not open the file: " + path);
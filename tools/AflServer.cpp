@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Chip8.h"
+#include "CpuBackend.h"
+#include "Interpreter.h"
+#include "Util.h"
+
+// AFL-compatible fuzzing harness
+//
+// Under afl-fuzz, the machine is set up once and a fork server forks it for
+// every test case, which loads the test case as a ROM and runs it. Coverage
+// is reported in AFL's shared-memory bitmap, one entry per (previous PC, PC)
+// edge. Faults of the emulated program (invalid opcodes, out-of-range
+// accesses) are normal exits; only crashes of the emulator itself are crashes.
+//
+// Usage: afl-fuzz -i seeds -o findings -- chip8_afl [-n instructions] @@
+
+namespace {
+// Local types
+struct Options {
+  uint64_t instructions = 100000;
+  std::string inputPath;
+};
+
+// Runs another backend one instruction at a time, recording the edges taken
+class CoverageBackend : public CpuBackend {
+public:
+  CoverageBackend(std::unique_ptr<CpuBackend> backend, uint8_t *bitmap)
+      : backend(std::move(backend)), bitmap(bitmap) {}
+
+  [[nodiscard]] const char *GetName() const override { return "coverage"; }
+
+  Fault Step(Chip8State &state) override {
+    const auto fault = this->backend->Step(state);
+
+    // As in AFL's instrumentation: the edge is the XOR of the two locations,
+    // with the previous one shifted so that A->B and B->A differ
+    const auto location = hashLocation(state.PC);
+    ++this->bitmap[location ^ this->previous];
+    this->previous = location >> 1;
+    return fault;
+  }
+
+  void Invalidate() override {
+    this->backend->Invalidate();
+    this->previous = 0;
+  }
+
+private:
+  static uint16_t hashLocation(uint16_t pc) {
+    return static_cast<uint16_t>((pc * 2654435761U) >> 16);
+  }
+
+private:
+  std::unique_ptr<CpuBackend> backend;
+  uint8_t *bitmap;
+  uint16_t previous = 0;
+};
+
+// Constants
+// Defined by AFL
+constexpr const char *kShmEnvironmentVariable = "__AFL_SHM_ID";
+constexpr size_t kMapSize = 1 << 16;
+constexpr int kForkServerFd = 198;
+
+// Functions
+Options parseArguments(int argc, char **argv);
+uint8_t *attachBitmap();
+std::vector<uint8_t> readInput(const std::string &path);
+void runTestCase(Chip8 &chip8, const Options &options);
+void serve(Chip8 &chip8, const Options &options);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+
+    // Outside of afl-fuzz, the edges are counted in a local bitmap
+    std::vector<uint8_t> localBitmap;
+    auto bitmap = attachBitmap();
+    if (bitmap == nullptr) {
+      localBitmap.resize(kMapSize);
+      bitmap = localBitmap.data();
+    }
+
+    // Everything up to here is done once, before forking
+    Chip8 chip8;
+    chip8.SetRandomSeed(1);
+    chip8.SetTrapPolicy(TrapPolicy::kHalt);
+    chip8.SetCpuBackend(std::make_unique<CoverageBackend>(
+        std::make_unique<InterpreterBackend>(), bitmap));
+
+    serve(chip8, options);
+
+    // Not under afl-fuzz: run the test case in this process
+    runTestCase(chip8, options);
+
+    if (!localBitmap.empty()) {
+      size_t edges = 0;
+      for (const auto count : localBitmap) {
+        edges += (count != 0) ? 1 : 0;
+      }
+
+      std::printf("%llu instructions, %zu edges\n",
+                  static_cast<unsigned long long>(chip8.GetState().cycles),
+                  edges);
+    }
+
+    return EXIT_SUCCESS;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    if (argument == "-n" && (i + 1) < argc) {
+      options.instructions = std::stoull(argv[++i]);
+    } else {
+      options.inputPath = argument;
+    }
+  }
+
+  return options;
+}
+
+uint8_t *attachBitmap() {
+  const auto id = std::getenv(kShmEnvironmentVariable);
+  if (id == nullptr) {
+    return nullptr;
+  }
+
+  auto bitmap = shmat(std::atoi(id), nullptr, 0);
+  if (bitmap == reinterpret_cast<void *>(-1)) {
+    throw std::runtime_error("Could not attach AFL's shared memory.");
+  }
+
+  return static_cast<uint8_t *>(bitmap);
+}
+
+std::vector<uint8_t> readInput(const std::string &path) {
+  // AFL passes the test case as a file (@@) or on stdin
+  if (!path.empty() && path != "-") {
+    return Util::FileReadBinary(path);
+  }
+
+  std::vector<uint8_t> input;
+  std::array<uint8_t, 4096> buffer;
+  size_t count;
+  while ((count = std::fread(buffer.data(), 1, buffer.size(), stdin)) > 0) {
+    input.insert(input.end(), buffer.begin(), buffer.begin() + count);
+  }
+
+  return input;
+}
+
+void runTestCase(Chip8 &chip8, const Options &options) {
+  auto rom = readInput(options.inputPath);
+  rom.resize(std::min<size_t>(rom.size(), Memory::kSize - 0x200));
+
+  // A fault of the emulated program halts it, which is a normal outcome
+  chip8.LoadRom(rom.data(), rom.size());
+  chip8.RunCycles(options.instructions);
+}
+
+void serve(Chip8 &chip8, const Options &options) {
+  // Say hello; if nobody is listening, this isn't a fork server run
+  uint32_t message = 0;
+  if (write(kForkServerFd + 1, &message, sizeof(message)) !=
+      sizeof(message)) {
+    return;
+  }
+
+  while (true) {
+    // Wait for the next test case
+    if (read(kForkServerFd, &message, sizeof(message)) != sizeof(message)) {
+      _exit(EXIT_SUCCESS);
+    }
+
+    const auto pid = fork();
+    if (pid < 0) {
+      _exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+      close(kForkServerFd);
+      close(kForkServerFd + 1);
+
+      runTestCase(chip8, options);
+      _exit(EXIT_SUCCESS);
+    }
+
+    int status = 0;
+    if (write(kForkServerFd + 1, &pid, sizeof(pid)) != sizeof(pid) ||
+        waitpid(pid, &status, 0) < 0 ||
+        write(kForkServerFd + 1, &status, sizeof(status)) != sizeof(status)) {
+      _exit(EXIT_FAILURE);
+    }
+  }
+}
+} // namespace
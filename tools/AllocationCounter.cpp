@@ -0,0 +1,30 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+// Kept in a translation unit of its own, so that the replaced operators are
+// never inlined into their callers
+
+namespace {
+std::atomic<uint64_t> allocationCount{0};
+} // namespace
+
+uint64_t GetAllocationCount() {
+  return allocationCount.load(std::memory_order_relaxed);
+}
+
+void *operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(std::max<size_t>(size, 1))) {
+    return pointer;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
@@ -0,0 +1,10 @@
+#ifndef ALLOCATION_COUNTER_H_INCLUDED
+#define ALLOCATION_COUNTER_H_INCLUDED
+
+#include <cstdint>
+
+// Number of calls to the global operator new so far
+// Linking AllocationCounter.cpp replaces the global operator new and delete
+[[nodiscard]] uint64_t GetAllocationCount();
+
+#endif // ALLOCATION_COUNTER_H_INCLUDED
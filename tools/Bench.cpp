@@ -0,0 +1,655 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "BoundsAnalysis.h"
+#include "Chip8.h"
+#include "CpuBackend.h"
+#include "Opcodes.h"
+#include "RomSet.h"
+#include "ScriptedInput.h"
+
+// Measures the throughput of a CPU backend on whole ROMs with scripted input
+// and on microbenchmarks of single instruction classes, and compares the
+// results against a baseline from an earlier run
+
+namespace {
+// Local types
+struct Options {
+  std::string backend = "interpreter";
+  uint64_t instructions = 5000000;
+  uint64_t microInstructions = 2000000;
+  uint64_t inputInterval = 5000;
+  unsigned repetitions = 3;
+  uint16_t cpuRate = 500;
+  uint32_t seed = 1;
+  unsigned int runAheadFrames = 2;
+  std::string outputPath;
+  std::string baselinePath;
+  double threshold = 10.0;
+  std::vector<std::string> romPaths;
+};
+
+struct Result {
+  std::string name;
+  uint64_t instructions = 0;
+  double seconds = 0.0;
+  uint64_t draws = 0;
+  uint64_t allocations = 0;
+
+  // Memory of a machine that was created from the state of another one
+  // running the same ROM, and isn't shared with it
+  std::optional<size_t> privateBytes;
+
+  // Chip8::Reset() between short runs
+  std::optional<double> resetsPerSecond;
+
+  // Mean cost of Chip8::RunAhead() per frame
+  std::optional<double> runAheadMicroseconds;
+
+  // Whether the verified backend runs the ROM without range checks, and if
+  // so, how much faster it does than the interpreter with them
+  std::optional<bool> proven;
+  std::optional<double> uncheckedSpeedup;
+
+  [[nodiscard]] double GetNsPerInstruction() const {
+    return (this->instructions != 0) ? this->seconds * 1e9 / this->instructions
+                                     : 0.0;
+  }
+};
+
+// A loop of the body instructions, preceded by the setup instructions
+// The data is placed at kDataAddress, e.g. sprites or a subroutine
+struct Microbenchmark {
+  std::string name;
+  std::vector<uint16_t> setup;
+  std::vector<uint16_t> body;
+  std::vector<uint8_t> data;
+  uint16_t loopJump = 0x1000;
+};
+
+// Constants
+constexpr uint16_t kDataAddress = 0x800;
+constexpr size_t kBodyRepeat = 64;
+
+// Resets measured per ROM, and the instructions run before each
+constexpr size_t kResetCount = 2000;
+constexpr uint64_t kResetInterval = 1000;
+
+// Frames run ahead of per ROM
+constexpr size_t kRunAheadCount = 600;
+
+// Functions
+Options parseArguments(int argc, char **argv);
+std::unique_ptr<Chip8> createChip8(const Options &options);
+Result benchmarkRom(const Options &options, const RomSet::Rom &rom);
+void replay(const Options &options, const RomSet::Rom &rom, Result &result);
+void benchmarkReset(const Options &options, const RomSet::Rom &rom,
+                    Result &result);
+void benchmarkRunAhead(const Options &options, const RomSet::Rom &rom,
+                       Result &result);
+void benchmarkProof(const Options &options, const RomSet::Rom &rom,
+                    Result &result);
+double getSecondsPerInstruction(const Options &options,
+                                const RomSet::Rom &rom);
+std::vector<Microbenchmark> createMicrobenchmarks();
+Result benchmarkMicro(const Options &options, const Microbenchmark &micro);
+void writeJson(const std::string &path, const Options &options,
+               const std::vector<Result> &results);
+std::string quoteJson(const std::string &text);
+std::string unquoteJson(const std::string &text);
+std::map<std::string, Result> readBaseline(const std::string &path);
+size_t compare(const Options &options, const std::vector<Result> &results);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+
+    std::vector<Result> results;
+    std::printf("%-28s %12s %10s %12s %8s %10s %10s %10s %7s %9s\n",
+                "benchmark", "instr/s", "ns/instr", "DXYN/s", "allocs",
+                "private B", "resets/s", "ahead us", "proven", "unchecked");
+
+    const auto print = [](const Result &result) {
+      const auto privateBytes =
+          result.privateBytes ? std::to_string(*result.privateBytes) : "-";
+      const auto resets =
+          result.resetsPerSecond
+              ? std::to_string(static_cast<uint64_t>(*result.resetsPerSecond))
+              : "-";
+      std::array<char, 16> runAhead = {"-"};
+      if (result.runAheadMicroseconds) {
+        std::snprintf(runAhead.data(), runAhead.size(), "%.2f",
+                      *result.runAheadMicroseconds);
+      }
+
+      const auto *proven =
+          result.proven ? (*result.proven ? "yes" : "no") : "-";
+      std::array<char, 16> speedup = {"-"};
+      if (result.uncheckedSpeedup) {
+        std::snprintf(speedup.data(), speedup.size(), "%.2fx",
+                      *result.uncheckedSpeedup);
+      }
+
+      std::printf("%-28s %12.0f %10.2f %12.0f %8llu %10s %10s %10s %7s %9s\n",
+                  result.name.c_str(), result.instructions / result.seconds,
+                  result.GetNsPerInstruction(), result.draws / result.seconds,
+                  static_cast<unsigned long long>(result.allocations),
+                  privateBytes.c_str(), resets.c_str(), runAhead.data(),
+                  proven, speedup.data());
+    };
+
+    const RomSet romSet(options.romPaths);
+    for (const auto &rom : romSet.GetRoms()) {
+      results.push_back(benchmarkRom(options, rom));
+      print(results.back());
+    }
+
+    for (const auto &micro : createMicrobenchmarks()) {
+      results.push_back(benchmarkMicro(options, micro));
+      print(results.back());
+    }
+
+    if (!options.outputPath.empty()) {
+      writeJson(options.outputPath, options, results);
+    }
+
+    if (!options.baselinePath.empty() && compare(options, results) != 0) {
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-b") {
+      options.backend = next();
+    } else if (argument == "-n") {
+      options.instructions = std::max<uint64_t>(std::stoull(next()), 1);
+    } else if (argument == "-m") {
+      options.microInstructions = std::max<uint64_t>(std::stoull(next()), 1);
+    } else if (argument == "-i") {
+      options.inputInterval = std::max<uint64_t>(std::stoull(next()), 1);
+    } else if (argument == "-k") {
+      options.repetitions =
+          static_cast<unsigned>(std::max(std::stoul(next()), 1ul));
+    } else if (argument == "-r") {
+      options.cpuRate = static_cast<uint16_t>(std::stoul(next()));
+    } else if (argument == "-s") {
+      options.seed = static_cast<uint32_t>(std::stoul(next()));
+    } else if (argument == "-a") {
+      options.runAheadFrames = static_cast<unsigned int>(std::stoul(next()));
+    } else if (argument == "-o") {
+      options.outputPath = next();
+    } else if (argument == "-c") {
+      options.baselinePath = next();
+    } else if (argument == "-t") {
+      options.threshold = std::stod(next());
+    } else if (argument == "-h") {
+      throw std::runtime_error(
+          "Usage: chip8_bench [-b backend] [-n instructions per ROM] [-m "
+          "instructions per microbenchmark] [-i input interval] [-k "
+          "repetitions] [-r cpu rate] [-s seed] [-a run-ahead frames] [-o "
+          "results.json] [-c "
+          "baseline.json] [-t regression threshold %] [ROM, directory or "
+          "pack]...");
+    } else {
+      options.romPaths.push_back(argument);
+    }
+  }
+
+  return options;
+}
+
+std::unique_ptr<Chip8> createChip8(const Options &options) {
+  auto chip8 = std::make_unique<Chip8>();
+  chip8->SetCpuBackend(CpuBackends::Create(options.backend));
+  chip8->SetCpuRate(options.cpuRate);
+  chip8->SetRandomSeed(options.seed);
+
+  // A ROM that faults stops there; what it ran up to then is still counted
+  chip8->SetTrapPolicy(TrapPolicy::kHalt);
+
+  return chip8;
+}
+
+Result benchmarkRom(const Options &options, const RomSet::Rom &rom) {
+  Result best;
+  best.name = "rom/" + std::filesystem::path(rom.name).filename().string();
+
+  // Best of several runs, each from power-on
+  for (unsigned i = 0; i < options.repetitions; i++) {
+    auto chip8 = createChip8(options);
+    chip8->LoadRom(rom.data, rom.size);
+    ScriptedInput input(options.seed, options.inputInterval);
+
+    const auto allocations = GetAllocationCount();
+    const auto start = std::chrono::steady_clock::now();
+
+    input.Run(*chip8, options.instructions);
+
+    const auto elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    if (i == 0 || elapsed < best.seconds) {
+      best.instructions = chip8->GetState().cycles;
+      best.seconds = elapsed;
+      best.allocations = GetAllocationCount() - allocations;
+    }
+  }
+
+  replay(options, rom, best);
+  benchmarkReset(options, rom, best);
+  benchmarkRunAhead(options, rom, best);
+  benchmarkProof(options, rom, best);
+  return best;
+}
+
+void replay(const Options &options, const RomSet::Rom &rom, Result &result) {
+  // The runs are deterministic, so an untimed replay that single-steps gives
+  // the exact DXYN count without slowing down the timed runs
+  // It starts from the state of another machine, as in a pool of machines,
+  // to measure how much memory stays shared
+  const auto loaded = createChip8(options);
+  loaded->LoadRom(rom.data, rom.size);
+
+  auto chip8 = createChip8(options);
+  chip8->SetState(loaded->GetState());
+  ScriptedInput input(options.seed, options.inputInterval);
+
+  uint64_t draws = 0;
+  for (uint64_t i = 0; i < options.instructions && !chip8->IsHalted(); i++) {
+    const auto &state = chip8->GetState();
+    if (Opcodes::Classify(state.memory.ReadWord(state.PC)) == Opcodes::kDXYN) {
+      ++draws;
+    }
+
+    input.Run(*chip8, 1);
+  }
+
+  result.draws = draws;
+  result.privateBytes =
+      chip8->GetState().memory.GetPrivatePageCount() * Memory::kPageSize;
+}
+
+void benchmarkReset(const Options &options, const RomSet::Rom &rom,
+                    Result &result) {
+  auto chip8 = createChip8(options);
+  chip8->LoadRom(rom.data, rom.size);
+  ScriptedInput input(options.seed, options.inputInterval);
+
+  // Only the resets are timed; the runs in between dirty the memory
+  std::chrono::steady_clock::duration elapsed{};
+  for (size_t i = 0; i < kResetCount; i++) {
+    input.Run(*chip8, kResetInterval);
+
+    const auto start = std::chrono::steady_clock::now();
+    chip8->Reset();
+    elapsed += std::chrono::steady_clock::now() - start;
+  }
+
+  result.resetsPerSecond =
+      kResetCount / std::chrono::duration<double>(elapsed).count();
+}
+
+void benchmarkRunAhead(const Options &options, const RomSet::Rom &rom,
+                       Result &result) {
+  auto chip8 = createChip8(options);
+  chip8->LoadRom(rom.data, rom.size);
+  ScriptedInput input(options.seed, options.inputInterval);
+
+  // Only the run-ahead is timed, once per frame as in the frontend
+  // A ROM that halts stops it early
+  std::chrono::steady_clock::duration elapsed{};
+  size_t frames = 0;
+  for (; frames < kRunAheadCount && !chip8->IsHalted(); frames++) {
+    input.Run(*chip8, std::max(options.cpuRate / 60, 1));
+
+    const auto start = std::chrono::steady_clock::now();
+    chip8->RunAhead(options.runAheadFrames);
+    elapsed += std::chrono::steady_clock::now() - start;
+  }
+
+  if (frames != 0) {
+    result.runAheadMicroseconds =
+        std::chrono::duration<double, std::micro>(elapsed).count() / frames;
+  }
+}
+
+void benchmarkProof(const Options &options, const RomSet::Rom &rom,
+                    Result &result) {
+  const auto loaded = createChip8(options);
+  loaded->LoadRom(rom.data, rom.size);
+  result.proven = BoundsAnalysis::Analyze(loaded->GetState()).proven;
+  if (!*result.proven) {
+    return;
+  }
+
+  // The same runs with the range checks (the interpreter) and without them,
+  // whichever backend is benchmarked
+  auto checked = options;
+  checked.backend = "interpreter";
+  auto unchecked = options;
+  unchecked.backend = "verified";
+  result.uncheckedSpeedup = getSecondsPerInstruction(checked, rom) /
+                            getSecondsPerInstruction(unchecked, rom);
+}
+
+double getSecondsPerInstruction(const Options &options,
+                                const RomSet::Rom &rom) {
+  // Best of several runs, each from power-on
+  double best = 0.0;
+  for (unsigned i = 0; i < options.repetitions; i++) {
+    auto chip8 = createChip8(options);
+    chip8->LoadRom(rom.data, rom.size);
+    ScriptedInput input(options.seed, options.inputInterval);
+
+    const auto start = std::chrono::steady_clock::now();
+    input.Run(*chip8, options.instructions);
+    const auto elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    const auto seconds =
+        elapsed / std::max<uint64_t>(chip8->GetState().cycles, 1);
+    if (i == 0 || seconds < best) {
+      best = seconds;
+    }
+  }
+
+  return best;
+}
+
+std::vector<Microbenchmark> createMicrobenchmarks() {
+  std::vector<Microbenchmark> micros = {
+      {"00E0", {}, {0x00E0}, {}},
+      {"1NNN", {}, {}, {}},
+      {"2NNN+00EE", {}, {0x2000 | kDataAddress}, {0x00, 0xEE}},
+      {"3XNN", {}, {0x3001}, {}},
+      {"4XNN", {}, {0x4000}, {}},
+      {"5XY0", {0x6101}, {0x5010}, {}},
+      {"6XNN", {}, {0x6012}, {}},
+      {"7XNN", {}, {0x7001}, {}},
+      {"8XY0", {}, {0x8010}, {}},
+      {"8XY1", {}, {0x8011}, {}},
+      {"8XY2", {}, {0x8012}, {}},
+      {"8XY3", {}, {0x8013}, {}},
+      {"8XY4", {0x6133}, {0x8014}, {}},
+      {"8XY5", {0x6133}, {0x8015}, {}},
+      {"8XY6", {}, {0x8016}, {}},
+      {"8XY7", {0x6133}, {0x8017}, {}},
+      {"8XYE", {}, {0x801E}, {}},
+      {"9XY0", {}, {0x9010}, {}},
+      {"ANNN", {}, {0xA000 | kDataAddress}, {}},
+      {"BNNN", {}, {}, {}, 0xB000},
+      {"CXNN", {}, {0xC0FF}, {}},
+      {"EX9E", {}, {0xE09E}, {}},
+      {"EXA1", {}, {0xE0A1}, {}},
+      {"F002", {0xA000 | kDataAddress}, {0xF002}, {}},
+      {"FX07", {}, {0xF007}, {}},
+      {"FX15", {}, {0xF015}, {}},
+      {"FX18", {}, {0xF018}, {}},
+      {"FX1E", {}, {0xF01E}, {}},
+      {"FX29", {}, {0xF029}, {}},
+      {"FX33", {0x6080, 0xA000 | kDataAddress}, {0xF033}, {}},
+      {"FX3A", {}, {0xF03A}, {}},
+      {"FX55", {0xA000 | kDataAddress}, {0xFF55}, {}},
+      {"FX65", {0xA000 | kDataAddress}, {0xFF65}, {}},
+  };
+
+  // DXYN across sprite heights, byte-aligned and unaligned columns, and
+  // wrapping at the right and bottom edges
+  const std::vector<uint8_t> sprite(15, 0xA5);
+  for (const auto height : {1, 5, 15}) {
+    for (const auto &[x, y] : {std::pair{0, 0}, std::pair{3, 0},
+                              std::pair{60, 0}, std::pair{8, 28}}) {
+      micros.push_back({"DXYN h=" + std::to_string(height) +
+                            " x=" + std::to_string(x) +
+                            " y=" + std::to_string(y),
+                        {static_cast<uint16_t>(0x6000 | x),
+                         static_cast<uint16_t>(0x6100 | y),
+                         0xA000 | kDataAddress},
+                        {static_cast<uint16_t>(0xD010 | height)},
+                        sprite});
+    }
+  }
+
+  return micros;
+}
+
+Result benchmarkMicro(const Options &options, const Microbenchmark &micro) {
+  // Assemble the setup, the repeated body and the jump back to the loop
+  std::vector<uint8_t> program;
+  const auto emit = [&program](uint16_t opcode) {
+    program.push_back(static_cast<uint8_t>(opcode >> 8));
+    program.push_back(static_cast<uint8_t>(opcode & 0xFF));
+  };
+
+  for (const auto opcode : micro.setup) {
+    emit(opcode);
+  }
+
+  const auto loop = static_cast<uint16_t>(0x200 + program.size());
+  for (size_t i = 0; i < kBodyRepeat; i++) {
+    for (const auto opcode : micro.body) {
+      emit(opcode);
+    }
+  }
+
+  emit(micro.loopJump | loop);
+
+  std::vector<uint8_t> image(kDataAddress - 0x200 + micro.data.size());
+  std::copy(program.begin(), program.end(), image.begin());
+  std::copy(micro.data.begin(), micro.data.end(),
+            image.begin() + (kDataAddress - 0x200));
+
+  Result best;
+  best.name = "micro/" + micro.name;
+
+  for (unsigned i = 0; i < options.repetitions; i++) {
+    auto chip8 = createChip8(options);
+    chip8->LoadRom(image.data(), image.size());
+
+    const auto allocations = GetAllocationCount();
+    const auto start = std::chrono::steady_clock::now();
+    chip8->RunCycles(options.microInstructions);
+    const auto elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    if (i == 0 || elapsed < best.seconds) {
+      best.instructions = options.microInstructions;
+      best.seconds = elapsed;
+      best.allocations = GetAllocationCount() - allocations;
+    }
+  }
+
+  // Every instruction in the body of the DXYN loops draws
+  if (micro.name.rfind("DXYN", 0) == 0) {
+    best.draws = best.instructions * kBodyRepeat / (kBodyRepeat + 1);
+  }
+
+  return best;
+}
+
+void writeJson(const std::string &path, const Options &options,
+               const std::vector<Result> &results) {
+  auto file = std::ofstream(path);
+  if (!file) {
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  // One result per line, which is all readBaseline() needs to parse
+  file << "{\n  \"backend\": " << quoteJson(options.backend) << ",\n"
+       << "  \"results\": [\n";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &result = results[i];
+    file << "    {\"name\": " << quoteJson(result.name)
+         << ", \"instructions\": " << result.instructions
+         << ", \"seconds\": " << result.seconds
+         << ", \"instructionsPerSecond\": "
+         << result.instructions / result.seconds
+         << ", \"nsPerInstruction\": " << result.GetNsPerInstruction()
+         << ", \"dxynPerSecond\": " << result.draws / result.seconds
+         << ", \"allocations\": " << result.allocations;
+
+    if (result.privateBytes) {
+      file << ", \"privateBytes\": " << *result.privateBytes;
+    }
+
+    if (result.resetsPerSecond) {
+      file << ", \"resetsPerSecond\": " << *result.resetsPerSecond;
+    }
+
+    if (result.runAheadMicroseconds) {
+      file << ", \"runAheadMicroseconds\": " << *result.runAheadMicroseconds;
+    }
+
+    if (result.proven) {
+      file << ", \"proven\": " << (*result.proven ? "true" : "false");
+    }
+
+    if (result.uncheckedSpeedup) {
+      file << ", \"uncheckedSpeedup\": " << *result.uncheckedSpeedup;
+    }
+
+    file << "}" << ((i + 1 < results.size()) ? ",\n" : "\n");
+  }
+
+  file << "  ]\n}\n";
+}
+
+std::string quoteJson(const std::string &text) {
+  std::string quoted = "\"";
+  for (const auto c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      std::array<char, 8> escape;
+      std::snprintf(escape.data(), escape.size(), "\\u%04X",
+                    static_cast<unsigned char>(c));
+      quoted += escape.data();
+    } else {
+      quoted += c;
+    }
+  }
+
+  return quoted + '"';
+}
+
+std::string unquoteJson(const std::string &text) {
+  // Only what quoteJson() writes, from the opening quote to the closing one
+  std::string unquoted;
+  for (size_t i = 1; i < text.size() && text[i] != '"'; i++) {
+    if (text[i] != '\\' || i + 1 == text.size()) {
+      unquoted += text[i];
+    } else if (text[++i] == 'u') {
+      unquoted += static_cast<char>(std::stoi(text.substr(i + 1, 4), nullptr,
+                                              16));
+      i += 4;
+    } else {
+      unquoted += text[i];
+    }
+  }
+
+  return unquoted;
+}
+
+std::map<std::string, Result> readBaseline(const std::string &path) {
+  auto file = std::ifstream(path);
+  if (!file) {
+    throw std::runtime_error("Could not open the file: " + path);
+  }
+
+  const auto field = [](const std::string &line, const std::string &key) {
+    const auto position = line.find("\"" + key + "\": ");
+    if (position == std::string::npos) {
+      throw std::runtime_error("Missing " + key + " in the baseline: " + line);
+    }
+
+    return line.substr(position + key.size() + 4);
+  };
+
+  std::map<std::string, Result> baseline;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find("\"name\": ") == std::string::npos) {
+      continue;
+    }
+
+    Result result;
+    result.name = unquoteJson(field(line, "name"));
+    result.instructions = std::stoull(field(line, "instructions"));
+    result.seconds = std::stod(field(line, "seconds"));
+    result.allocations = std::stoull(field(line, "allocations"));
+    baseline[result.name] = result;
+  }
+
+  return baseline;
+}
+
+size_t compare(const Options &options, const std::vector<Result> &results) {
+  const auto baseline = readBaseline(options.baselinePath);
+
+  std::printf("\n%-28s %10s %10s %8s\n", "vs baseline", "ns before",
+              "ns after", "change");
+
+  size_t regressions = 0;
+  for (const auto &result : results) {
+    const auto entry = baseline.find(result.name);
+    if (entry == baseline.end()) {
+      continue;
+    }
+
+    const auto before = entry->second.GetNsPerInstruction();
+    const auto after = result.GetNsPerInstruction();
+    const auto change = (before > 0.0) ? (after / before - 1.0) * 100.0 : 0.0;
+
+    // Slower beyond the noise threshold, or allocating more than before
+    const bool regressed = change > options.threshold ||
+                           result.allocations > entry->second.allocations;
+    regressions += regressed ? 1 : 0;
+
+    std::printf("%-28s %10.2f %10.2f %+7.1f%%%s\n", result.name.c_str(),
+                before, after, change, regressed ? "  REGRESSION" : "");
+  }
+
+  std::printf("%zu regressions (threshold %.1f%%)\n", regressions,
+              options.threshold);
+  return regressions;
+}
+} // namespace
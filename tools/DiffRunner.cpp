@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "CpuBackend.h"
+#include "Interpreter.h"
+#include "RomSet.h"
+#include "ScriptedInput.h"
+
+// Runs the reference interpreter and a candidate CPU backend in lockstep on
+// the same ROMs and inputs, and reports the first instruction where their
+// states diverge
+
+namespace {
+// Local types
+struct Options {
+  std::string backend = "interpreter";
+  uint64_t instructions = 1000000;
+  uint64_t compareInterval = 1000;
+  uint64_t inputInterval = 5000;
+  uint16_t cpuRate = 500;
+  uint32_t seed = 1;
+  std::vector<std::string> romPaths;
+};
+
+enum class Result { kMatched, kHalted, kDiverged };
+
+// Constants
+constexpr size_t kMaxMemoryDifferences = 16;
+
+// Functions
+Options parseArguments(int argc, char **argv);
+Result runRom(const Options &options, const RomSet::Rom &rom);
+std::optional<std::string> runCycles(Chip8 &chip8, uint64_t count);
+Result findDivergence(Chip8 &reference, Chip8 &candidate,
+                      const Chip8State &lastMatch, uint64_t count);
+void printStateDiff(const Chip8State &reference, const Chip8State &candidate);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+    const RomSet romSet(options.romPaths);
+    const auto &roms = romSet.GetRoms();
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t diverged = 0;
+
+    for (const auto &rom : roms) {
+      if (runRom(options, rom) == Result::kDiverged) {
+        ++diverged;
+      }
+    }
+
+    const auto elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    std::printf("%zu ROMs, %zu diverged, %.2f s\n", roms.size(), diverged,
+                elapsed);
+
+    return (diverged == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-b") {
+      options.backend = next();
+    } else if (argument == "-n") {
+      options.instructions = std::stoull(next());
+    } else if (argument == "-c") {
+      options.compareInterval = std::max<uint64_t>(std::stoull(next()), 1);
+    } else if (argument == "-i") {
+      options.inputInterval = std::max<uint64_t>(std::stoull(next()), 1);
+    } else if (argument == "-r") {
+      options.cpuRate = static_cast<uint16_t>(std::stoul(next()));
+    } else if (argument == "-s") {
+      options.seed = static_cast<uint32_t>(std::stoul(next()));
+    } else {
+      options.romPaths.push_back(argument);
+    }
+  }
+
+  if (options.romPaths.empty()) {
+    std::string backends;
+    for (const auto &name : CpuBackends::GetNames()) {
+      backends += " " + name;
+    }
+
+    throw std::runtime_error(
+        "Usage: chip8_diff [-b backend] [-n instructions] [-c compare "
+        "interval] [-i input interval] [-r cpu rate] [-s seed] <ROM, "
+        "directory or pack>...\nBackends:" +
+        backends);
+  }
+
+  return options;
+}
+
+Result runRom(const Options &options, const RomSet::Rom &rom) {
+  Chip8 reference;
+  Chip8 candidate;
+
+  reference.SetCpuBackend(CpuBackends::Create("interpreter"));
+  candidate.SetCpuBackend(CpuBackends::Create(options.backend));
+
+  for (auto chip8 : {&reference, &candidate}) {
+    chip8->SetTrapPolicy(TrapPolicy::kHalt);
+    chip8->LoadRom(rom.data, rom.size);
+    chip8->SetCpuRate(options.cpuRate);
+    chip8->SetRandomSeed(options.seed);
+  }
+
+  ScriptedInput input(options.seed, options.inputInterval);
+
+  uint64_t executed = 0;
+  while (executed < options.instructions) {
+    if (executed % options.inputInterval == 0) {
+      const auto key = input.NextKey();
+      const auto pressed = !reference.GetState().keys.at(key);
+      reference.SetKey(key, pressed);
+      candidate.SetKey(key, pressed);
+    }
+
+    // Run up to the next comparison or input, whichever comes first
+    const auto untilInput =
+        options.inputInterval - executed % options.inputInterval;
+    const auto count =
+        std::min({options.compareInterval, untilInput,
+                  options.instructions - executed});
+
+    const auto lastMatch = reference.GetState();
+    const auto referenceError = runCycles(reference, count);
+    const auto candidateError = runCycles(candidate, count);
+
+    if (referenceError || candidateError ||
+        reference.GetState() != candidate.GetState()) {
+      const auto result =
+          findDivergence(reference, candidate, lastMatch, count);
+      if (result == Result::kHalted) {
+        const auto cycles = reference.GetState().cycles;
+        std::printf("%-40s halted after %llu instructions: %s\n",
+                    rom.name.c_str(), static_cast<unsigned long long>(cycles),
+                    referenceError.value_or("").c_str());
+      } else {
+        std::printf("%-40s DIVERGED (%s)\n", rom.name.c_str(),
+                    options.backend.c_str());
+      }
+
+      return result;
+    }
+
+    executed += count;
+  }
+
+  std::printf("%-40s matched %llu instructions\n", rom.name.c_str(),
+              static_cast<unsigned long long>(executed));
+  return Result::kMatched;
+}
+
+std::optional<std::string> runCycles(Chip8 &chip8, uint64_t count) {
+  chip8.RunCycles(count);
+  if (chip8.IsHalted()) {
+    return chip8.GetTrap().GetMessage();
+  }
+
+  return std::nullopt;
+}
+
+Result findDivergence(Chip8 &reference, Chip8 &candidate,
+                      const Chip8State &lastMatch, uint64_t count) {
+  // Replay from the last matching state one instruction at a time
+  reference.SetState(lastMatch);
+  candidate.SetState(lastMatch);
+
+  for (uint64_t i = 0; i < count; i++) {
+    const auto before = reference.GetState();
+    const auto referenceError = runCycles(reference, 1);
+    const auto candidateError = runCycles(candidate, 1);
+
+    if (referenceError && candidateError &&
+        *referenceError == *candidateError) {
+      // Both faulted the same way (e.g. an invalid opcode): not a divergence
+      return Result::kHalted;
+    }
+
+    if (referenceError || candidateError ||
+        reference.GetState() != candidate.GetState()) {
+      // The PC may have been left anywhere, even past the end of memory
+      const auto pc = before.PC;
+      const auto opcode =
+          (pc < Memory::kSize - 1) ? before.memory.ReadWord(pc) : 0;
+      std::printf("First divergence at cycle %llu, PC %03X, opcode %04X\n",
+                  static_cast<unsigned long long>(before.cycles), pc, opcode);
+
+      if (referenceError != candidateError) {
+        std::printf("  fault: reference \"%s\", candidate \"%s\"\n",
+                    referenceError.value_or("none").c_str(),
+                    candidateError.value_or("none").c_str());
+      }
+
+      printStateDiff(reference.GetState(), candidate.GetState());
+      return Result::kDiverged;
+    }
+  }
+
+  // Only reachable if a backend isn't deterministic
+  std::printf("Divergence could not be reproduced by single-stepping\n");
+  return Result::kDiverged;
+}
+
+void printStateDiff(const Chip8State &reference, const Chip8State &candidate) {
+  const auto field = [](const char *name, unsigned long long a,
+                        unsigned long long b) {
+    if (a != b) {
+      std::printf("  %-12s reference %llX, candidate %llX\n", name, a, b);
+    }
+  };
+
+  std::array<char, 16> name;
+  for (size_t i = 0; i < reference.V.size(); i++) {
+    std::snprintf(name.data(), name.size(), "V%zX", i);
+    field(name.data(), reference.V[i], candidate.V[i]);
+  }
+
+  field("I", reference.I, candidate.I);
+  field("PC", reference.PC, candidate.PC);
+  field("SP", reference.SP, candidate.SP);
+  for (size_t i = 0; i < reference.stack.size(); i++) {
+    std::snprintf(name.data(), name.size(), "stack[%zu]", i);
+    field(name.data(), reference.stack[i], candidate.stack[i]);
+  }
+
+  field("delay timer", reference.delayTimer, candidate.delayTimer);
+  field("sound timer", reference.soundTimer, candidate.soundTimer);
+  field("random", reference.randomState, candidate.randomState);
+  field("pitch", reference.audioPitch, candidate.audioPitch);
+  field("cycles", reference.cycles, candidate.cycles);
+  field("timer phase", reference.timerPhase, candidate.timerPhase);
+
+  size_t memoryDifferences = 0;
+  for (size_t address = 0; address < reference.memory.size(); address++) {
+    if (reference.memory[address] != candidate.memory[address] &&
+        memoryDifferences++ < kMaxMemoryDifferences) {
+      std::snprintf(name.data(), name.size(), "mem[%03zX]", address);
+      field(name.data(), reference.memory[address], candidate.memory[address]);
+    }
+  }
+
+  size_t pixelDifferences = 0;
+  for (size_t i = 0; i < reference.pixels.size(); i++) {
+    pixelDifferences += (reference.pixels[i] != candidate.pixels[i]) ? 1 : 0;
+  }
+
+  if (memoryDifferences > kMaxMemoryDifferences) {
+    std::printf("  ... %zu memory bytes differ in total\n", memoryDifferences);
+  }
+
+  if (pixelDifferences != 0) {
+    std::printf("  %zu pixels differ\n", pixelDifferences);
+  }
+
+  if (reference.audioPattern != candidate.audioPattern ||
+      reference.audioPatternLoaded != candidate.audioPatternLoaded) {
+    std::printf("  audio pattern differs\n");
+  }
+
+  if (reference.keys != candidate.keys) {
+    std::printf("  keys differ\n");
+  }
+}
+} // namespace
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Chip8.h"
+#include "Opcodes.h"
+
+// libFuzzer target for the interpreter
+//
+// A test case is a ROM followed by a tail of key events:
+//   ROM bytes | event 0 | ... | event N-1 | N (1 byte)
+// Each event is 2 bytes: the instructions to run before it (in units of
+// kEventStep), then the key in the low nibble and whether it's pressed in the
+// high bit. A fault halts the machine (TrapPolicy::kHalt) instead of throwing.
+//
+// The custom mutator works on whole instructions, so that most mutants still
+// decode to valid opcodes and reach deeper into the program.
+//
+// Usage: chip8_fuzz [libFuzzer options] [corpus directory]
+
+namespace {
+// Local types
+struct KeyEvent {
+  uint8_t delay;
+  uint8_t key;
+};
+
+struct TestCase {
+  std::vector<uint8_t> rom;
+  std::vector<KeyEvent> events;
+};
+
+// Constants
+constexpr size_t kMaxRomSize = 4096 - 0x200;
+constexpr size_t kMaxEvents = 255;
+constexpr uint64_t kEventStep = 16;
+constexpr uint64_t kMaxInstructions = 50000;
+
+// Functions
+TestCase parse(const uint8_t *data, size_t size);
+size_t serialize(const TestCase &testCase, uint8_t *data, size_t maxSize);
+uint16_t randomInstruction(std::minstd_rand &random, size_t romSize);
+void mutate(TestCase &testCase, std::minstd_rand &random, size_t maxSize);
+} // namespace
+
+extern "C" size_t LLVMFuzzerMutate(uint8_t *data, size_t size, size_t maxSize);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  // The machine is set up once, and every test case starts from its blank
+  // state, sharing the font page
+  static const auto chip8 = [] {
+    auto chip8 = std::make_unique<Chip8>();
+    chip8->SetRandomSeed(1);
+    chip8->SetTrapPolicy(TrapPolicy::kHalt);
+    return chip8;
+  }();
+  static const auto blank = chip8->GetState();
+
+  const auto testCase = parse(data, size);
+  chip8->SetState(blank);
+  chip8->LoadRom(testCase.rom.data(), testCase.rom.size());
+
+  uint64_t executed = 0;
+  for (const auto &event : testCase.events) {
+    const auto count = std::min<uint64_t>(event.delay * kEventStep,
+                                          kMaxInstructions - executed);
+    chip8->RunCycles(count);
+    if (chip8->IsHalted()) {
+      return 0;
+    }
+
+    executed += count;
+    chip8->SetKey(event.key & 0x0F, (event.key & 0x80) != 0);
+  }
+
+  chip8->RunCycles(kMaxInstructions - executed);
+  return 0;
+}
+
+extern "C" size_t LLVMFuzzerCustomMutator(uint8_t *data, size_t size,
+                                          size_t maxSize, unsigned int seed) {
+  std::minstd_rand random(seed);
+  auto testCase = parse(data, size);
+
+  // Leave some mutations to libFuzzer's byte-level mutators, which also
+  // find the opcodes that no template produces
+  if (random() % 8 == 0) {
+    const auto romSize = testCase.rom.size();
+    const auto tailSize = size - romSize;
+    if (maxSize <= tailSize) {
+      return LLVMFuzzerMutate(data, size, maxSize);
+    }
+
+    // Mutate the ROM in place, then put the tail back after it
+    std::vector<uint8_t> tail(data + romSize, data + size);
+    const auto newSize = LLVMFuzzerMutate(data, romSize, maxSize - tailSize);
+    std::copy(tail.begin(), tail.end(), data + newSize);
+    return newSize + tailSize;
+  }
+
+  mutate(testCase, random, maxSize);
+  return serialize(testCase, data, maxSize);
+}
+
+namespace {
+TestCase parse(const uint8_t *data, size_t size) {
+  TestCase testCase;
+  if (size == 0) {
+    return testCase;
+  }
+
+  // The event count is the last byte, as long as the events fit
+  const auto count = std::min<size_t>(data[size - 1], (size - 1) / 2);
+  const auto romSize = std::min(size - 1 - count * 2, kMaxRomSize);
+  const auto events = data + size - 1 - count * 2;
+
+  testCase.rom.assign(data, data + romSize);
+  for (size_t i = 0; i < count; i++) {
+    testCase.events.push_back({events[i * 2], events[i * 2 + 1]});
+  }
+
+  return testCase;
+}
+
+size_t serialize(const TestCase &testCase, uint8_t *data, size_t maxSize) {
+  const auto tailSize = testCase.events.size() * 2 + 1;
+  if (maxSize < tailSize) {
+    return 0;
+  }
+
+  // Drop the end of the ROM if the test case doesn't fit
+  const auto romSize = std::min(testCase.rom.size(), maxSize - tailSize);
+  std::copy_n(testCase.rom.begin(), romSize, data);
+
+  auto tail = data + romSize;
+  for (const auto &event : testCase.events) {
+    *tail++ = event.delay;
+    *tail++ = event.key;
+  }
+
+  *tail = static_cast<uint8_t>(testCase.events.size());
+  return romSize + tailSize;
+}
+
+uint16_t randomInstruction(std::minstd_rand &random, size_t romSize) {
+  const auto opcodeClass =
+      static_cast<Opcodes::Class>(random() % Opcodes::kInvalid);
+
+  // Fill in the operands of the class's name, e.g. "8XY4"
+  const auto name = Opcodes::GetName(opcodeClass);
+  uint16_t opcode = 0;
+  for (int i = 0; i < 4; i++) {
+    const auto c = name[i];
+    const auto nibble = (c >= '0' && c <= '9')   ? c - '0'
+                        : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+                                                 : random() % 16;
+    opcode = static_cast<uint16_t>((opcode << 4) | nibble);
+  }
+
+  // Jumps and calls mostly land on an instruction of the ROM
+  if ((opcodeClass == Opcodes::k1NNN || opcodeClass == Opcodes::k2NNN) &&
+      romSize >= 2 && random() % 4 != 0) {
+    const auto target = 0x200 + (random() % (romSize / 2)) * 2;
+    opcode = static_cast<uint16_t>((opcode & 0xF000) | target);
+  }
+
+  return opcode;
+}
+
+void mutate(TestCase &testCase, std::minstd_rand &random, size_t maxSize) {
+  auto &rom = testCase.rom;
+  auto &events = testCase.events;
+
+  // Instructions are aligned to 2 bytes, as the ROM is loaded at 0x200
+  const auto instructions = rom.size() / 2;
+  const auto position = (instructions != 0) ? random() % instructions * 2 : 0;
+  const auto opcode = randomInstruction(random, rom.size());
+  const std::array<uint8_t, 2> bytes = {static_cast<uint8_t>(opcode >> 8),
+                                       static_cast<uint8_t>(opcode)};
+
+  switch (random() % 6) {
+  case 0:
+    // Replace an instruction
+    if (instructions != 0) {
+      std::copy(bytes.begin(), bytes.end(), rom.begin() + position);
+      break;
+    }
+    [[fallthrough]];
+
+  case 1:
+    // Insert an instruction
+    if (rom.size() + 2 <= std::min(kMaxRomSize, maxSize)) {
+      rom.insert(rom.begin() + position, bytes.begin(), bytes.end());
+    }
+    break;
+
+  case 2:
+    // Delete an instruction
+    if (instructions != 0) {
+      rom.erase(rom.begin() + position, rom.begin() + position + 2);
+    }
+    break;
+
+  case 3:
+    // Swap two instructions
+    if (instructions != 0) {
+      const auto other = random() % instructions * 2;
+      std::swap_ranges(rom.begin() + position, rom.begin() + position + 2,
+                       rom.begin() + other);
+    }
+    break;
+
+  case 4:
+    // Change one operand nibble, keeping the instruction's class
+    if (instructions != 0) {
+      const auto nibble = 1 + random() % 3;
+      auto &byte = rom[position + nibble / 2];
+      const auto shift = (nibble % 2 == 0) ? 4 : 0;
+      byte = static_cast<uint8_t>((byte & ~(0x0F << shift)) |
+                                  ((random() % 16) << shift));
+    }
+    break;
+
+  default: {
+    // Add, change or remove a key event
+    const KeyEvent event = {static_cast<uint8_t>(random()),
+                            static_cast<uint8_t>(random() & 0x8F)};
+    const auto index = events.empty() ? 0 : random() % events.size();
+    const auto action = random() % 3;
+    if (action == 0 && events.size() < kMaxEvents) {
+      events.insert(events.begin() + index, event);
+    } else if (action == 1 && !events.empty()) {
+      events[index] = event;
+    } else if (!events.empty()) {
+      events.erase(events.begin() + index);
+    }
+  } break;
+  }
+}
+} // namespace
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "Chip8.h"
+#include "Movie.h"
+#include "MoviePlayer.h"
+#include "ScriptedInput.h"
+#include "Util.h"
+
+// Plays input movies back headless and checks that they end in the recorded
+// state, seeks in them, or records one from a ROM with scripted input
+
+namespace {
+// Local types
+struct Options {
+  std::string moviePath;
+  std::optional<uint64_t> seekCycle;
+
+  // Recording
+  std::string romPath;
+  uint64_t instructions = 1000000;
+  uint64_t inputInterval = 5000;
+  uint64_t keyframeInterval = MovieRecorder::kDefaultKeyframeInterval;
+  uint16_t cpuRate = 500;
+  uint32_t seed = 1;
+};
+
+// Functions
+Options parseArguments(int argc, char **argv);
+void record(const Options &options);
+bool play(const Options &options);
+bool seek(const Options &options);
+double getSeconds(std::chrono::steady_clock::time_point start);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+
+    if (!options.romPath.empty()) {
+      record(options);
+      return EXIT_SUCCESS;
+    }
+
+    const auto ok = options.seekCycle ? seek(options) : play(options);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-g") {
+      options.seekCycle = std::stoull(next());
+    } else if (argument == "-R") {
+      options.romPath = next();
+    } else if (argument == "-n") {
+      options.instructions = std::stoull(next());
+    } else if (argument == "-i") {
+      options.inputInterval = std::max<uint64_t>(std::stoull(next()), 1);
+    } else if (argument == "-k") {
+      options.keyframeInterval = std::stoull(next());
+    } else if (argument == "-r") {
+      options.cpuRate = static_cast<uint16_t>(std::stoul(next()));
+    } else if (argument == "-s") {
+      options.seed = static_cast<uint32_t>(std::stoul(next()));
+    } else {
+      options.moviePath = argument;
+    }
+  }
+
+  if (options.moviePath.empty()) {
+    throw std::runtime_error(
+        "Usage: chip8_movie [-g cycle] <movie>\n"
+        "       chip8_movie -R <ROM> [-n instructions] [-i input interval] "
+        "[-k keyframe interval] [-r cpu rate] [-s seed] <movie>");
+  }
+
+  return options;
+}
+
+void record(const Options &options) {
+  auto rom = Util::FileReadBinary(options.romPath);
+
+  Chip8 chip8;
+  chip8.SetCpuRate(options.cpuRate);
+  chip8.SetRandomSeed(options.seed);
+  chip8.SetTrapPolicy(TrapPolicy::kHalt);
+  chip8.LoadRom(rom.data(), rom.size());
+
+  MovieRecorder recorder(std::move(rom), chip8.GetState(), chip8.GetCpuRate(),
+                         options.keyframeInterval);
+  chip8.SetMovieRecorder(&recorder);
+
+  ScriptedInput input(options.seed, options.inputInterval);
+  input.Run(chip8, options.instructions);
+
+  const auto movie = recorder.Finish(chip8.GetState());
+  movie.Write(options.moviePath);
+
+  std::printf("%llu cycles, %zu events, %zu frames, %zu keyframes, checksum "
+              "%016llX\n",
+              static_cast<unsigned long long>(movie.length),
+              movie.events.size(), movie.frames.size(), movie.keyframes.size(),
+              static_cast<unsigned long long>(movie.finalChecksum));
+}
+
+bool play(const Options &options) {
+  const auto movie = InputMovie::Read(options.moviePath);
+  std::printf("%zu-byte ROM, seed %u, CPU rate %u, %llu cycles, %zu events, "
+              "%zu keyframes\n",
+              movie.rom.size(), movie.seed, movie.cpuRate,
+              static_cast<unsigned long long>(movie.length),
+              movie.events.size(), movie.keyframes.size());
+
+  Chip8 chip8;
+  chip8.SetTrapPolicy(TrapPolicy::kHalt);
+
+  const auto start = std::chrono::steady_clock::now();
+  MoviePlayer player(movie, chip8);
+  player.RunTo(movie.length);
+  const auto elapsed = getSeconds(start);
+
+  const auto checksum = chip8.GetState().GetChecksum();
+  const auto ok = checksum == movie.finalChecksum;
+  std::printf("%s: checksum %016llX, %.3f s\n", ok ? "ok" : "MISMATCH",
+              static_cast<unsigned long long>(checksum), elapsed);
+
+  if (chip8.IsHalted()) {
+    std::printf("halted at cycle %llu: %s\n",
+                static_cast<unsigned long long>(player.GetCycle()),
+                chip8.GetTrap().GetMessage().c_str());
+  }
+
+  return ok;
+}
+
+bool seek(const Options &options) {
+  const auto movie = InputMovie::Read(options.moviePath);
+
+  // Seeking only replays from the last keyframe, while playing replays
+  // everything up to the cycle; both must end in the same state
+  Chip8 sought;
+  sought.SetTrapPolicy(TrapPolicy::kHalt);
+  MoviePlayer seeker(movie, sought);
+
+  auto start = std::chrono::steady_clock::now();
+  seeker.Seek(*options.seekCycle);
+  const auto seekTime = getSeconds(start);
+
+  Chip8 played;
+  played.SetTrapPolicy(TrapPolicy::kHalt);
+  MoviePlayer player(movie, played);
+
+  start = std::chrono::steady_clock::now();
+  player.RunTo(*options.seekCycle);
+  const auto playTime = getSeconds(start);
+
+  const auto checksum = sought.GetState().GetChecksum();
+  const auto ok = checksum == played.GetState().GetChecksum();
+  std::printf("cycle %llu: checksum %016llX, seek %.6f s, play %.6f s%s\n",
+              static_cast<unsigned long long>(seeker.GetCycle()),
+              static_cast<unsigned long long>(checksum), seekTime, playTime,
+              ok ? "" : ", MISMATCH with playing");
+
+  return ok;
+}
+
+double getSeconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+} // namespace
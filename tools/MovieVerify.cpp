@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Chip8.h"
+#include "Movie.h"
+#include "MoviePlayer.h"
+
+// Replays a library of input movies in parallel, headless and uncapped, and
+// checks that each one still ends in its recorded state
+//
+// A movie is played straight through, comparing the machine with each
+// keyframe on the way and with the final checksum, framebuffer and memory
+// hashes at the end. Only a movie that doesn't match is played again, frame
+// by frame from the last keyframe that matched, to find the first frame
+// whose framebuffer differs from the recorded one; if none does before a
+// keyframe that differs, the parts of its state that do are reported.
+//
+// Usage: chip8_verify [-j threads] <movies or directories of movies>...
+
+namespace {
+// Local types
+struct Options {
+  std::vector<std::string> paths;
+  unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+struct Result {
+  // Empty if the movie matches
+  std::string error;
+  uint64_t instructions = 0;
+};
+
+// Constants
+constexpr const char *kExtension = ".c8m";
+
+// Functions
+Options parseArguments(int argc, char **argv);
+std::vector<std::string> findMovies(const std::vector<std::string> &paths);
+Result verify(const std::string &path);
+std::string findDivergentFrame(const InputMovie &movie, size_t keyframe,
+                               size_t end);
+std::string compare(const Chip8 &chip8, const InputMovie::Keyframe &keyframe);
+std::string getHaltMessage(const Chip8 &chip8);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+    const auto movies = findMovies(options.paths);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Result> results(movies.size());
+    std::atomic<size_t> next = 0;
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < options.threads; i++) {
+      threads.emplace_back([&] {
+        for (auto index = next++; index < movies.size(); index = next++) {
+          results[index] = verify(movies[index]);
+        }
+      });
+    }
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    size_t mismatches = 0;
+    uint64_t instructions = 0;
+    for (size_t i = 0; i < movies.size(); i++) {
+      instructions += results[i].instructions;
+      if (!results[i].error.empty()) {
+        std::printf("MISMATCH %s: %s\n", movies[i].c_str(),
+                    results[i].error.c_str());
+        mismatches++;
+      }
+    }
+
+    std::printf("%zu movies, %zu mismatched, %u threads, %.3f s, %.0f "
+                "movies/s, %.0f instructions/s\n",
+                movies.size(), mismatches, options.threads, seconds,
+                static_cast<double>(movies.size()) / seconds,
+                static_cast<double>(instructions) / seconds);
+
+    return (mismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-j") {
+      options.threads = std::max(static_cast<unsigned int>(std::stoul(next())),
+                                 1u);
+    } else {
+      options.paths.push_back(argument);
+    }
+  }
+
+  if (options.paths.empty()) {
+    throw std::runtime_error(
+        "Usage: chip8_verify [-j threads] <movies or directories>...");
+  }
+
+  return options;
+}
+
+std::vector<std::string> findMovies(const std::vector<std::string> &paths) {
+  std::vector<std::string> movies;
+
+  // Directories are searched recursively for movies, in name order
+  for (const auto &path : paths) {
+    if (!std::filesystem::is_directory(path)) {
+      movies.push_back(path);
+      continue;
+    }
+
+    std::vector<std::string> directoryMovies;
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file() && entry.path().extension() == kExtension) {
+        directoryMovies.push_back(entry.path().string());
+      }
+    }
+
+    std::sort(directoryMovies.begin(), directoryMovies.end());
+    movies.insert(movies.end(), directoryMovies.begin(),
+                  directoryMovies.end());
+  }
+
+  return movies;
+}
+
+Result verify(const std::string &path) {
+  Result result;
+
+  try {
+    const auto movie = InputMovie::Read(path);
+
+    Chip8 chip8;
+    chip8.SetTrapPolicy(TrapPolicy::kHalt);
+    MoviePlayer player(movie, chip8);
+
+    // The first keyframe is power-on, which always matches, and edit
+    // keyframes are restored by playback
+    const auto &keyframes = movie.keyframes;
+    for (size_t i = 1; i < keyframes.size(); i++) {
+      player.RunToKeyframe(i);
+      const auto differences = compare(chip8, keyframes[i]);
+      if (differences.empty()) {
+        continue;
+      }
+
+      // Only the frames that end before the keyframe are checked
+      auto divergence = findDivergentFrame(movie, i - 1, keyframes[i].frame);
+      if (divergence.empty()) {
+        divergence = "the framebuffer matches, but not the " + differences;
+      }
+
+      result.instructions = chip8.GetState().cycles;
+      result.error = "keyframe " + std::to_string(i) + " at cycle " +
+                     std::to_string(keyframes[i].state.cycles) + " differs" +
+                     getHaltMessage(chip8) + "; " + divergence;
+      return result;
+    }
+
+    player.RunTo(movie.length);
+
+    const auto &state = chip8.GetState();
+    result.instructions = state.cycles;
+
+    std::string differences;
+    const auto check = [&](bool matches, const char *name) {
+      if (!matches) {
+        differences += (differences.empty() ? "" : ", ") + std::string(name);
+      }
+    };
+
+    check(state.cycles == movie.length, "length");
+    check(Movie::HashFramebuffer(state) == movie.finalFramebufferHash,
+          "framebuffer");
+    check(Movie::HashMemory(state) == movie.finalMemoryHash, "memory");
+    check(state.GetChecksum() == movie.finalChecksum, "checksum");
+
+    if (!differences.empty()) {
+      auto divergence = findDivergentFrame(movie, keyframes.size() - 1,
+                                           movie.frames.size());
+      if (divergence.empty()) {
+        divergence = "the framebuffer matches in every frame";
+      }
+
+      result.error = "final " + differences + " differ" +
+                     getHaltMessage(chip8) + "; " + divergence;
+    }
+  } catch (const std::exception &e) {
+    // The path is already on the report line
+    result.error = e.what();
+    const auto suffix = ": " + path;
+    if (result.error.size() > suffix.size() &&
+        result.error.compare(result.error.size() - suffix.size(),
+                             suffix.size(), suffix) == 0) {
+      result.error.resize(result.error.size() - suffix.size());
+    }
+  }
+
+  return result;
+}
+
+std::string findDivergentFrame(const InputMovie &movie, size_t keyframe,
+                               size_t end) {
+  // The state at the keyframe matched, so the divergence is after it; empty
+  // if every frame up to the end matches
+  Chip8 chip8;
+  chip8.SetTrapPolicy(TrapPolicy::kHalt);
+  MoviePlayer player(movie, chip8);
+  player.Seek(movie.keyframes[keyframe].state.cycles);
+
+  for (auto frame = movie.keyframes[keyframe].frame; frame < end; frame++) {
+    const auto ended = !player.RunFrame();
+    const auto cycle = std::to_string(player.GetCycle());
+    if (ended) {
+      return "ended before frame " + std::to_string(frame) + " at cycle " +
+             cycle + getHaltMessage(chip8);
+    }
+
+    if (Movie::HashFramebuffer(chip8.GetState()) != movie.frames[frame]) {
+      return "first divergent frame " + std::to_string(frame) +
+             " at cycle " + cycle;
+    }
+  }
+
+  return "";
+}
+
+std::string compare(const Chip8 &chip8, const InputMovie::Keyframe &keyframe) {
+  const auto &state = chip8.GetState();
+  const auto &recorded = keyframe.state;
+
+  // Every part of the state, so that the keyframe matches if this is empty
+  std::string differences;
+  const auto check = [&](bool matches, const char *name) {
+    if (!matches) {
+      differences += (differences.empty() ? "" : ", ") + std::string(name);
+    }
+  };
+
+  check(state.V == recorded.V && state.I == recorded.I &&
+            state.PC == recorded.PC &&
+            state.randomState == recorded.randomState,
+        "registers");
+  check(state.stack == recorded.stack && state.SP == recorded.SP, "stack");
+  check(state.memory == recorded.memory, "memory");
+  check(state.delayTimer == recorded.delayTimer &&
+            state.soundTimer == recorded.soundTimer &&
+            state.timerPhase == recorded.timerPhase &&
+            chip8.GetCpuRate() == keyframe.cpuRate,
+        "timers");
+  check(state.cycles == recorded.cycles, "cycles");
+  check(state.keys == recorded.keys, "keys");
+  check(state.pixels == recorded.pixels, "framebuffer");
+  check(state.audioPattern == recorded.audioPattern &&
+            state.audioPatternLoaded == recorded.audioPatternLoaded &&
+            state.audioPitch == recorded.audioPitch,
+        "audio");
+  return differences;
+}
+
+std::string getHaltMessage(const Chip8 &chip8) {
+  return chip8.IsHalted() ? " (halted: " + chip8.GetTrap().GetMessage() + ")"
+                          : "";
+}
+} // namespace
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "Netplay.h"
+#include "UdpSocket.h"
+#include "Util.h"
+
+// Plays a ROM with rollback netplay between two peers in this process, over
+// UDP on the loopback interface, with simulated latency, jitter and loss
+//
+// Time is simulated in 1 ms steps, so a run takes as long as the emulation
+// and the resimulations, not the latency. Each player toggles pseudo-random
+// keys of their half of the keypad (player 1: 0-7, player 2: 8-F). At the
+// end, both peers must be in the state of a run without netplay.
+//
+// Usage: chip8_netplay [-n frames] [-l latency ms] [-j jitter ms]
+//                      [-p loss %] [-d max rollback] [-r cpu rate] [-s seed]
+//                      <ROM>
+
+namespace {
+// Local types
+struct Options {
+  std::string romPath;
+  uint64_t frames = 3600;
+  double latency = 50.0;
+  double jitter = 10.0;
+  double loss = 5.0;
+  size_t maxRollback = Netplay::kDefaultMaxRollback;
+  uint16_t cpuRate = 500;
+  uint32_t seed = 1;
+};
+
+// Delays, reorders and drops the datagrams sent through a socket
+class ImpairedChannel : public PacketChannel {
+public:
+  ImpairedChannel(UdpSocket &socket, const Options &options, uint32_t seed)
+      : socket(socket), options(options), random(seed) {}
+
+  void Send(const uint8_t *data, size_t size) override {
+    if (std::uniform_real_distribution<double>(0.0, 100.0)(this->random) <
+        this->options.loss) {
+      return;
+    }
+
+    const auto jitter = std::uniform_real_distribution<double>(
+        -this->options.jitter, this->options.jitter)(this->random);
+    this->queue.push_back({this->time + std::max(this->options.latency + jitter,
+                                                 0.0),
+                           std::vector<uint8_t>(data, data + size)});
+  }
+
+  size_t Receive(uint8_t *data, size_t size) override {
+    return this->socket.Receive(data, size);
+  }
+
+  // Sends the datagrams due by the time, in milliseconds
+  void Flush(double time) {
+    this->time = time;
+
+    std::stable_sort(
+        this->queue.begin(), this->queue.end(),
+        [](const auto &a, const auto &b) { return a.time < b.time; });
+    while (!this->queue.empty() && this->queue.front().time <= time) {
+      const auto &datagram = this->queue.front().data;
+      this->socket.Send(datagram.data(), datagram.size());
+      this->queue.pop_front();
+    }
+  }
+
+private:
+  struct Datagram {
+    double time;
+    std::vector<uint8_t> data;
+  };
+
+private:
+  UdpSocket &socket;
+  const Options &options;
+  std::minstd_rand random;
+  std::deque<Datagram> queue;
+  double time = 0.0;
+};
+
+struct Peer {
+  Peer(const Options &options, const std::vector<uint8_t> &rom, uint32_t seed)
+      : socket(0), channel(this->socket, options, seed) {
+    this->chip8.SetCpuRate(options.cpuRate);
+    this->chip8.SetRandomSeed(options.seed);
+    this->chip8.SetTrapPolicy(TrapPolicy::kHalt);
+    this->chip8.LoadRom(rom.data(), rom.size());
+    this->session = std::make_unique<RollbackSession>(
+        this->chip8, this->channel, options.maxRollback);
+  }
+
+  Chip8 chip8;
+  UdpSocket socket;
+  ImpairedChannel channel;
+  std::unique_ptr<RollbackSession> session;
+  double nextFrameTime = 0.0;
+};
+
+// Constants
+constexpr double kFrameTime = 1000.0 / 60.0;
+
+// Frames between key changes of a player
+constexpr uint64_t kInputInterval = 12;
+
+// Simulated time allowed for the last inputs to arrive after the last frame
+constexpr double kDrainTime = 10000.0;
+
+// Functions
+Options parseArguments(int argc, char **argv);
+uint16_t getKeys(const Options &options, int player, uint64_t frame);
+uint64_t runReference(const Options &options, const std::vector<uint8_t> &rom);
+void report(const Options &options, int player, const Peer &peer);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+    const auto rom = Util::FileReadBinary(options.romPath);
+
+    std::array<std::unique_ptr<Peer>, 2> peers = {
+        std::make_unique<Peer>(options, rom, options.seed),
+        std::make_unique<Peer>(options, rom, options.seed + 1)};
+    peers[0]->socket.Connect("127.0.0.1", peers[1]->socket.GetPort());
+    peers[1]->socket.Connect("127.0.0.1", peers[0]->socket.GetPort());
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Run both peers until the last frame, then until they have each other's
+    // last inputs
+    const auto done = [&] {
+      return std::all_of(peers.begin(), peers.end(), [&](const auto &peer) {
+        return peer->session->GetConfirmedFrame() == options.frames;
+      });
+    };
+
+    double time = 0.0;
+    double endTime = 0.0;
+    for (; !done(); time += 1.0) {
+      for (int player = 0; player < 2; player++) {
+        auto &peer = *peers[player];
+        auto &session = *peer.session;
+        peer.channel.Flush(time);
+        session.Poll();
+
+        if (time < peer.nextFrameTime) {
+          continue;
+        }
+
+        // A stalled frame is skipped, as in the frontend
+        peer.nextFrameTime += kFrameTime;
+        if (session.GetFrame() < options.frames) {
+          session.AdvanceFrame(getKeys(options, player, session.GetFrame()));
+        } else {
+          session.SendInputs();
+        }
+      }
+
+      if (endTime == 0.0 && peers[0]->session->GetFrame() == options.frames &&
+          peers[1]->session->GetFrame() == options.frames) {
+        endTime = time;
+      }
+
+      if (endTime != 0.0 && time > endTime + kDrainTime) {
+        throw std::runtime_error("The last inputs never arrived.");
+      }
+    }
+
+    const auto elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    std::printf("%llu frames, latency %.1f ms, jitter %.1f ms, loss %.1f%%, "
+                "max rollback %zu: %.1f s simulated, %.3f s real\n",
+                static_cast<unsigned long long>(options.frames),
+                options.latency, options.jitter, options.loss,
+                options.maxRollback, time / 1000.0, elapsed);
+    for (int player = 0; player < 2; player++) {
+      report(options, player, *peers[player]);
+    }
+
+    const auto reference = runReference(options, rom);
+    const auto inSync = std::all_of(
+        peers.begin(), peers.end(), [&](const auto &peer) {
+          return peer->chip8.GetState().GetChecksum() == reference;
+        });
+    std::printf("%s: checksum %016llX\n", inSync ? "in sync" : "DESYNC",
+                static_cast<unsigned long long>(reference));
+
+    return inSync ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-n") {
+      options.frames = std::stoull(next());
+    } else if (argument == "-l") {
+      options.latency = std::stod(next());
+    } else if (argument == "-j") {
+      options.jitter = std::stod(next());
+    } else if (argument == "-p") {
+      options.loss = std::stod(next());
+    } else if (argument == "-d") {
+      options.maxRollback = std::stoul(next());
+    } else if (argument == "-r") {
+      options.cpuRate = static_cast<uint16_t>(std::stoul(next()));
+    } else if (argument == "-s") {
+      options.seed = static_cast<uint32_t>(std::stoul(next()));
+    } else {
+      options.romPath = argument;
+    }
+  }
+
+  if (options.romPath.empty()) {
+    throw std::runtime_error(
+        "Usage: chip8_netplay [-n frames] [-l latency ms] [-j jitter ms] [-p "
+        "loss %] [-d max rollback] [-r cpu rate] [-s seed] <ROM>");
+  }
+
+  if (options.loss >= 100.0) {
+    throw std::runtime_error("The loss must be below 100%.");
+  }
+
+  return options;
+}
+
+uint16_t getKeys(const Options &options, int player, uint64_t frame) {
+  // Hold one key of the player's half of the keypad (or none) for each
+  // interval of frames
+  auto random = static_cast<uint32_t>(
+      (frame / kInputInterval) * 2654435761u ^ options.seed ^
+      static_cast<uint32_t>(player) * 0x9E3779B9u);
+
+  // xorshift32
+  random |= 1;
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+
+  const auto key = random % 9;
+  return (key == 8) ? 0 : static_cast<uint16_t>(1u << (player * 8 + key));
+}
+
+uint64_t runReference(const Options &options, const std::vector<uint8_t> &rom) {
+  Chip8 chip8;
+  chip8.SetCpuRate(options.cpuRate);
+  chip8.SetRandomSeed(options.seed);
+  chip8.SetTrapPolicy(TrapPolicy::kHalt);
+  chip8.LoadRom(rom.data(), rom.size());
+
+  for (uint64_t frame = 0; frame < options.frames; frame++) {
+    const auto keys = getKeys(options, 0, frame) | getKeys(options, 1, frame);
+    for (uint8_t key = 0; key < 16; key++) {
+      chip8.SetKey(key, ((keys >> key) & 1) != 0);
+    }
+
+    chip8.RunFrame();
+  }
+
+  return chip8.GetState().GetChecksum();
+}
+
+void report(const Options &options, int player, const Peer &peer) {
+  const auto &stats = peer.session->GetStats();
+  const auto frames = static_cast<double>(options.frames);
+  const auto resimulation =
+      std::chrono::duration<double, std::micro>(stats.resimulationTime)
+          .count();
+
+  std::printf(
+      "player %d: %llu rollbacks, depth %.2f mean, %llu max, %.3f "
+      "resimulated frames per frame, resimulation %.2f us per frame (%.2f us "
+      "per rollback), %llu stalls\n",
+      player + 1, static_cast<unsigned long long>(stats.rollbacks),
+      (stats.rollbacks != 0)
+          ? static_cast<double>(stats.resimulatedFrames) / stats.rollbacks
+          : 0.0,
+      static_cast<unsigned long long>(stats.maxRollback),
+      stats.resimulatedFrames / frames, resimulation / frames,
+      (stats.rollbacks != 0) ? resimulation / stats.rollbacks : 0.0,
+      static_cast<unsigned long long>(stats.stalls));
+}
+} // namespace
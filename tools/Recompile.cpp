@@ -0,0 +1,661 @@
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Memory.h"
+#include "Opcodes.h"
+#include "RomAnalysis.h"
+#include "Util.h"
+
+// Compiles a ROM ahead of time into a C++ translation unit for the
+// "recompiled" CPU backend, with one function per basic block
+//
+// The blocks are those found by RomAnalysis, split after FX33 and FX55 so
+// that a write over code is seen before the code runs. Each instruction is
+// translated to the interpreter's semantics; DXYN, CXNN, 2NNN and the rare
+// ones call the interpreter instead. VF is set by 8XY4-8XYE only when it's
+// read or the block returns, so a flag that is overwritten first is never
+// computed. A run function chains the blocks, going
+// straight to a known successor while it's still valid. Linking the file into
+// a program registers the module, which the backend selects when its ROM is
+// loaded.
+//
+// Usage: chip8_recompile <ROM> <output.cpp>
+
+namespace {
+// Local types
+struct Block {
+  uint16_t start;
+  uint16_t end;
+
+  // Bytes written by the last instruction (FX33, FX55), or 0
+  uint16_t writeSize;
+
+  // Where the block goes on when it runs to its end, if known
+  std::vector<uint16_t> exits;
+};
+
+// The VF of the last flag-producing instruction, while it's only held in the
+// locals of its operands
+struct Flag {
+  // Empty if VF is up to date
+  std::string expression;
+  uint16_t address = 0;
+};
+
+struct Output {
+  std::string code;
+  size_t blocks = 0;
+  size_t instructions = 0;
+  size_t interpreted = 0;
+
+  // Flag-producing instructions compiled, and those whose VF is overwritten
+  // before anything reads it
+  size_t flags = 0;
+  size_t unusedFlags = 0;
+};
+
+// Constants
+constexpr uint16_t kStart = 0x200;
+constexpr size_t kBytesPerLine = 12;
+
+// Functions
+Output generate(const std::string &name, const std::vector<uint8_t> &rom);
+bool generateInstruction(Output &output, uint16_t address, uint16_t opcode,
+                         size_t index, Flag &flag, uint16_t &writeSize);
+std::string materialize(const Flag &flag, const char *indent);
+bool needsFlag(uint16_t opcode);
+bool overwritesFlag(uint16_t opcode);
+template <typename... Values>
+std::string format(const char *pattern, Values... values);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    if (argc != 3) {
+      throw std::runtime_error("Usage: chip8_recompile <ROM> <output.cpp>");
+    }
+
+    const std::string romPath = argv[1];
+    const std::string outputPath = argv[2];
+    const auto rom = Util::FileReadBinary(romPath);
+    const auto output = generate(
+        std::filesystem::path(romPath).filename().string(), rom);
+
+    auto file = std::ofstream(outputPath);
+    if (!file) {
+      throw std::runtime_error("Could not open the file: " + outputPath);
+    }
+
+    file << output.code;
+
+    std::printf("%s: %zu blocks, %zu instructions, %zu through the "
+                "interpreter, VF of %zu of %zu flag instructions never "
+                "computed\n",
+                romPath.c_str(), output.blocks, output.instructions,
+                output.interpreted, output.unusedFlags, output.flags);
+
+    return EXIT_SUCCESS;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Output generate(const std::string &name, const std::vector<uint8_t> &rom) {
+  const auto analysis = RomAnalysis::Analyze(rom.data(), rom.size());
+  if (analysis.blocks.empty()) {
+    throw std::runtime_error("No code was found in " + name + ".");
+  }
+
+  std::string cName;
+  for (const auto c : name) {
+    cName += (c == '"' || c == '\\' || c < ' ') ? '_' : c;
+  }
+
+  Output output;
+  output.code = "// Generated by chip8_recompile from " + cName +
+                "; don't edit\n"
+                "#include <cstdint>\n"
+                "\n"
+                "#include \"Interpreter.h\"\n"
+                "#include \"RecompiledBackend.h\"\n"
+                "\n"
+                "namespace {\n"
+                "const uint8_t kRom[] = {";
+
+  for (size_t i = 0; i < rom.size(); i++) {
+    output.code +=
+        format((i % kBytesPerLine == 0) ? "\n    0x%02X," : " 0x%02X,", rom[i]);
+  }
+
+  output.code += "\n};\n";
+
+  std::bitset<Memory::kSize> starts;
+  std::vector<Block> blocks;
+  for (const auto &analyzed : analysis.blocks) {
+    auto address = analyzed.start;
+    while (address < analyzed.end) {
+      Block block = {address, 0, 0, {}};
+      output.code += format("\n"
+                            "uint32_t block%03X(Chip8State &state,\n"
+                            "                  [[maybe_unused]] uint32_t "
+                            "limit,\n"
+                            "                  [[maybe_unused]] Fault "
+                            "&fault) {\n",
+                            block.start);
+
+      // Falls into the next block, unless an instruction ends it before
+      auto goesOn = true;
+      uint16_t opcode = 0;
+      Flag flag;
+      for (size_t index = 0; goesOn && address < analyzed.end; index++) {
+        const auto offset = address - kStart;
+        opcode = static_cast<uint16_t>((rom[offset] << 8) | rom[offset + 1]);
+        goesOn = generateInstruction(output, address, opcode, index, flag,
+                                     block.writeSize);
+        address += 2;
+
+        if (goesOn && address >= analyzed.end) {
+          output.code += materialize(flag, "  ");
+          output.code += format("  state.PC = 0x%03X;\n"
+                                "  return %zu;\n",
+                                address, index + 1);
+        }
+      }
+
+      output.code += "}\n";
+      block.end = address;
+
+      // Where the block goes on when it runs to its end, if known
+      if (goesOn) {
+        block.exits = {address};
+      } else {
+        switch (Opcodes::Classify(opcode)) {
+        case Opcodes::k1NNN:
+        case Opcodes::k2NNN:
+          block.exits = {static_cast<uint16_t>(opcode & 0x0FFF)};
+          break;
+
+        case Opcodes::k3XNN:
+        case Opcodes::k4XNN:
+        case Opcodes::k5XY0:
+        case Opcodes::k9XY0:
+        case Opcodes::kEX9E:
+        case Opcodes::kEXA1:
+          block.exits = {address, static_cast<uint16_t>(address + 2)};
+          break;
+
+        default:
+          break;
+        }
+      }
+
+      starts.set(block.start);
+      blocks.push_back(std::move(block));
+    }
+  }
+
+  // The run function goes from block to block directly where the next one is
+  // known and still valid, and through a switch on the PC otherwise
+  output.code += "\n"
+                 "Recompiled::Exit run(Chip8State &state, const uint16_t "
+                 "*entries,\n"
+                 "                     uint32_t limit) {\n"
+                 "  Recompiled::Exit result;\n"
+                 "\n"
+                 "dispatch:\n"
+                 "  if (state.PC >= Memory::kSize || entries[state.PC] == 0) "
+                 "{\n"
+                 "    return result;\n"
+                 "  }\n"
+                 "\n"
+                 "  switch (state.PC) {\n";
+
+  for (const auto &block : blocks) {
+    output.code += format("  case 0x%03X:\n"
+                          "    goto at%03X;\n",
+                          block.start, block.start);
+  }
+
+  output.code += "  default:\n"
+                 "    return result;\n"
+                 "  }\n";
+
+  for (const auto &block : blocks) {
+    output.code += format("\n"
+                          "at%03X:\n"
+                          "  result.executed +=\n"
+                          "      block%03X(state, limit - result.executed, "
+                          "result.fault);\n",
+                          block.start, block.start);
+
+    // Also if the limit stopped the block before the write
+    if (block.writeSize != 0) {
+      output.code += format("  result.writeSize = %u;\n"
+                            "  return result;\n",
+                            block.writeSize);
+      continue;
+    }
+
+    output.code += "  if (result.fault != Fault::kNone || "
+                   "result.executed == limit) {\n"
+                   "    return result;\n"
+                   "  }\n";
+
+    for (const auto exit : block.exits) {
+      if (exit < Memory::kSize && starts.test(exit)) {
+        output.code += format("  if (state.PC == 0x%03X && entries[0x%03X] != "
+                              "0) {\n"
+                              "    goto at%03X;\n"
+                              "  }\n",
+                              exit, exit, exit);
+      }
+    }
+
+    output.code += "  goto dispatch;\n";
+  }
+
+  output.code += "}\n"
+                 "\n"
+                 "const Recompiled::Block kBlocks[] = {\n";
+  for (const auto &block : blocks) {
+    output.code += format("    {0x%03X, 0x%03X},\n", block.start, block.end);
+  }
+
+  output.code += "};\n"
+                 "\n"
+                 "const Recompiled::Module kModule = {\n"
+                 "    \"" +
+                 cName +
+                 "\", kRom, sizeof(kRom), kBlocks,\n"
+                 "    sizeof(kBlocks) / sizeof(kBlocks[0]), run};\n"
+                 "\n"
+                 "struct Registration {\n"
+                 "  Registration() { Recompiled::Register(kModule); }\n"
+                 "} registration;\n"
+                 "} // namespace\n";
+
+  output.blocks = blocks.size();
+  return output;
+}
+
+bool generateInstruction(Output &output, uint16_t address, uint16_t opcode,
+                         size_t index, Flag &flag, uint16_t &writeSize) {
+  const unsigned int x = (opcode & 0x0F00) >> 8;
+  const unsigned int y = (opcode & 0x00F0) >> 4;
+  const unsigned int nn = opcode & 0x00FF;
+  const unsigned int nnn = opcode & 0x0FFF;
+  const unsigned int next = address + 2;
+  auto &code = output.code;
+
+  // The limit can only be reached between instructions
+  if (index != 0) {
+    code += format("  if (limit == %zu) {\n"
+                   "%s"
+                   "    state.PC = 0x%03X;\n"
+                   "    return %zu;\n"
+                   "  }\n",
+                   index, materialize(flag, "    ").c_str(), address, index);
+  }
+
+  code += format("  // %03X  %04X  %s\n", address, opcode,
+                 Opcodes::Disassemble(opcode).c_str());
+
+  output.instructions++;
+
+  if (needsFlag(opcode)) {
+    code += materialize(flag, "  ");
+    flag.expression.clear();
+  } else if (overwritesFlag(opcode) && !flag.expression.empty()) {
+    // Still set if the instruction faults or waits
+    code += format("  // VF of %03X is never read\n", flag.address);
+    output.unusedFlags++;
+  }
+
+  // The flag of an instruction that doesn't write VX = VF, from locals named
+  // after its address
+  const auto defer = [&](const std::string &expression) {
+    output.flags++;
+    flag.expression = expression;
+    flag.address = address;
+  };
+
+  // Clears the flag once it's overwritten
+  const auto overwrite = [&]() {
+    if (overwritesFlag(opcode)) {
+      flag.expression.clear();
+    }
+
+    return true;
+  };
+
+  const auto fail = [&](const char *condition, const char *fault) {
+    code += format("  if (%s) {\n"
+                   "%s"
+                   "    state.PC = 0x%03X;\n"
+                   "    fault = Fault::%s;\n"
+                   "    return %zu;\n"
+                   "  }\n",
+                   condition, materialize(flag, "    ").c_str(), address,
+                   fault, index);
+  };
+
+  const auto jump = [&](const std::string &target) {
+    code += format("  state.PC = %s;\n"
+                   "  return %zu;\n",
+                   target.c_str(), index + 1);
+    return false;
+  };
+
+  const auto skip = [&](const std::string &condition) {
+    return jump(format("(%s) ? 0x%03X : 0x%03X", condition.c_str(), next + 2,
+                       next));
+  };
+
+  switch (Opcodes::Classify(opcode)) {
+  case Opcodes::k00E0:
+    code += "  state.pixels.fill(false);\n";
+    return true;
+
+  case Opcodes::k00EE:
+    fail("state.SP == 0", "kStackUnderflow");
+    return jump("state.stack[--state.SP]");
+
+  case Opcodes::k0NNN:
+    return true;
+
+  case Opcodes::k1NNN:
+    return jump(format("0x%03X", nnn));
+
+  case Opcodes::k3XNN:
+    return skip(format("state.V[0x%X] == 0x%02X", x, nn));
+
+  case Opcodes::k4XNN:
+    return skip(format("state.V[0x%X] != 0x%02X", x, nn));
+
+  case Opcodes::k5XY0:
+    return skip(format("state.V[0x%X] == state.V[0x%X]", x, y));
+
+  case Opcodes::k6XNN:
+    code += format("  state.V[0x%X] = 0x%02X;\n", x, nn);
+    return overwrite();
+
+  case Opcodes::k7XNN:
+    code += format("  state.V[0x%X] += 0x%02X;\n", x, nn);
+    return true;
+
+  case Opcodes::k8XY0:
+    code += format("  state.V[0x%X] = state.V[0x%X];\n", x, y);
+    return overwrite();
+
+  case Opcodes::k8XY1:
+    code += format("  state.V[0x%X] |= state.V[0x%X];\n", x, y);
+    return true;
+
+  case Opcodes::k8XY2:
+    code += format("  state.V[0x%X] &= state.V[0x%X];\n", x, y);
+    return true;
+
+  case Opcodes::k8XY3:
+    code += format("  state.V[0x%X] ^= state.V[0x%X];\n", x, y);
+    return true;
+
+  case Opcodes::k8XY4:
+    if (x != 0xF) {
+      code += format("  const auto sum%03X = state.V[0x%X] + state.V[0x%X];\n"
+                     "  state.V[0x%X] = static_cast<uint8_t>(sum%03X);\n",
+                     address, x, y, x, address);
+      defer(format("static_cast<uint8_t>(sum%03X >> 8)", address));
+      return true;
+    }
+
+    // VF is written before VX, as by the interpreter
+    code += format("  {\n"
+                   "    const auto sum = state.V[0x%X] + state.V[0x%X];\n"
+                   "    state.V[0xF] = static_cast<uint8_t>(sum >> 8);\n"
+                   "    state.V[0x%X] = static_cast<uint8_t>(sum);\n"
+                   "  }\n",
+                   x, y, x);
+    return true;
+
+  case Opcodes::k8XY5:
+  case Opcodes::k8XY7: {
+    const auto subtract = Opcodes::Classify(opcode) == Opcodes::k8XY5;
+    if (x != 0xF) {
+      code += format("  const uint8_t a%03X = state.V[0x%X];\n"
+                     "  const uint8_t b%03X = state.V[0x%X];\n"
+                     "  state.V[0x%X] = static_cast<uint8_t>(a%03X - b%03X);\n",
+                     address, subtract ? x : y, address, subtract ? y : x, x,
+                     address, address);
+      defer(format("(a%03X >= b%03X) ? 1 : 0", address, address));
+      return true;
+    }
+
+    code += format("  {\n"
+                   "    const auto a = state.V[0x%X];\n"
+                   "    const auto b = state.V[0x%X];\n"
+                   "    state.V[0xF] = (a >= b) ? 1 : 0;\n"
+                   "    state.V[0x%X] = static_cast<uint8_t>(a - b);\n"
+                   "  }\n",
+                   subtract ? x : y, subtract ? y : x, x);
+    return true;
+  }
+
+  case Opcodes::k8XY6:
+  case Opcodes::k8XYE: {
+    const auto right = Opcodes::Classify(opcode) == Opcodes::k8XY6;
+    const auto *bit = right ? "0x1" : "0x80";
+    const auto *shift = right ? ">>" : "<<";
+    if (x != 0xF) {
+      code += format("  const uint8_t v%03X = state.V[0x%X];\n"
+                     "  state.V[0x%X] = static_cast<uint8_t>(v%03X %s 1);\n",
+                     address, x, x, address, shift);
+      defer(format("v%03X & %s", address, bit));
+      return true;
+    }
+
+    code += format("  state.V[0xF] = state.V[0xF] & %s;\n"
+                   "  state.V[0xF] %s= 1;\n",
+                   bit, shift);
+    return true;
+  }
+
+  case Opcodes::k9XY0:
+    return skip(format("state.V[0x%X] != state.V[0x%X]", x, y));
+
+  case Opcodes::kANNN:
+    code += format("  state.I = 0x%03X;\n", nnn);
+    return true;
+
+  case Opcodes::kBNNN:
+    return jump(format("static_cast<uint16_t>(0x%03X + state.V[0x0])", nnn));
+
+  case Opcodes::kEX9E:
+  case Opcodes::kEXA1:
+    fail(format("state.V[0x%X] >= state.keys.size()", x).c_str(),
+         "kInvalidKey");
+    return skip(format("%sstate.keys[state.V[0x%X]]",
+                       (Opcodes::Classify(opcode) == Opcodes::kEX9E) ? ""
+                                                                      : "!",
+                       x));
+
+  case Opcodes::kFX07:
+    code += format("  state.V[0x%X] = state.delayTimer;\n", x);
+    return overwrite();
+
+  case Opcodes::kFX0A:
+    // The keys can't change during a run, so waiting takes the rest of it
+    code += format("  {\n"
+                   "    uint8_t key = 0;\n"
+                   "    while (key < state.keys.size() && !state.keys[key]) "
+                   "{\n"
+                   "      key++;\n"
+                   "    }\n"
+                   "\n"
+                   "    if (key == state.keys.size()) {\n"
+                   "%s"
+                   "      state.PC = 0x%03X;\n"
+                   "      return limit;\n"
+                   "    }\n"
+                   "\n"
+                   "    state.V[0x%X] = key;\n"
+                   "  }\n",
+                   materialize(flag, "      ").c_str(), address, x);
+    return overwrite();
+
+  case Opcodes::kFX15:
+    code += format("  state.delayTimer = state.V[0x%X];\n", x);
+    return true;
+
+  case Opcodes::kFX18:
+    code += format("  state.soundTimer = state.V[0x%X];\n", x);
+    return true;
+
+  case Opcodes::kFX1E:
+    code += format("  state.I += state.V[0x%X];\n", x);
+    return true;
+
+  case Opcodes::kFX29:
+    code += format("  state.I = state.V[0x%X] * 5;\n", x);
+    return true;
+
+  case Opcodes::kFX55:
+    fail(format("state.I + %uu > Memory::kSize", x + 1).c_str(),
+         "kMemoryAccess");
+    code += format("  state.memory.Write(state.I, state.V.data(), %u);\n",
+                   x + 1);
+    writeSize = static_cast<uint16_t>(x + 1);
+    return jump(format("0x%03X", next));
+
+  case Opcodes::kFX65:
+    fail(format("state.I + %uu > Memory::kSize", x + 1).c_str(),
+         "kMemoryAccess");
+    code += format("  state.memory.Read(state.I, state.V.data(), %u);\n",
+                   x + 1);
+    return overwrite();
+
+  case Opcodes::kInvalid:
+    code += format("  state.PC = 0x%03X;\n"
+                   "  fault = Fault::kInvalidOpcode;\n"
+                   "  return %zu;\n",
+                   address, index);
+    return false;
+
+  default:
+    break;
+  }
+
+  // Everything else runs through the interpreter, and the block goes on only
+  // if the instruction did
+  output.interpreted++;
+  code += format("  state.PC = 0x%03X;\n"
+                 "  fault = Interpreter::ExecuteOneInstruction(state);\n"
+                 "  if (fault != Fault::kNone) {\n"
+                 "    return %zu;\n"
+                 "  }\n",
+                 address, index);
+
+  switch (Opcodes::Classify(opcode)) {
+  case Opcodes::k2NNN:
+  case Opcodes::kFX33:
+    writeSize = (opcode & 0xF0FF) == 0xF033 ? 3 : 0;
+    code += format("  return %zu;\n", index + 1);
+    return false;
+
+  default:
+    code += format("  if (state.PC != 0x%03X) {\n"
+                   "    return %zu;\n"
+                   "  }\n",
+                   next, index + 1);
+    return true;
+  }
+}
+
+std::string materialize(const Flag &flag, const char *indent) {
+  return flag.expression.empty() ? ""
+                                 : format("%sstate.V[0xF] = %s;\n", indent,
+                                          flag.expression.c_str());
+}
+
+bool needsFlag(uint16_t opcode) {
+  // Whether the instruction may read VF, or leave the block, which then
+  // returns with VF up to date
+  const unsigned int x = (opcode & 0x0F00) >> 8;
+  const unsigned int y = (opcode & 0x00F0) >> 4;
+
+  switch (Opcodes::Classify(opcode)) {
+  case Opcodes::k00E0:
+  case Opcodes::k0NNN:
+  case Opcodes::k6XNN:
+  case Opcodes::kANNN:
+  case Opcodes::kFX07:
+  case Opcodes::kFX0A:
+  case Opcodes::kFX65:
+    return false;
+
+  case Opcodes::k7XNN:
+  case Opcodes::k8XY6:
+  case Opcodes::k8XYE:
+  case Opcodes::kFX15:
+  case Opcodes::kFX18:
+  case Opcodes::kFX1E:
+  case Opcodes::kFX29:
+    return x == 0xF;
+
+  case Opcodes::k8XY0:
+    return y == 0xF;
+
+  case Opcodes::k8XY1:
+  case Opcodes::k8XY2:
+  case Opcodes::k8XY3:
+  case Opcodes::k8XY4:
+  case Opcodes::k8XY5:
+  case Opcodes::k8XY7:
+    return x == 0xF || y == 0xF;
+
+  default:
+    return true;
+  }
+}
+
+bool overwritesFlag(uint16_t opcode) {
+  // Without reading it first
+  const unsigned int x = (opcode & 0x0F00) >> 8;
+
+  switch (Opcodes::Classify(opcode)) {
+  case Opcodes::k6XNN:
+  case Opcodes::k8XY0:
+  case Opcodes::kFX07:
+  case Opcodes::kFX0A:
+  case Opcodes::kFX65:
+    return x == 0xF && !needsFlag(opcode);
+
+  case Opcodes::k8XY4:
+  case Opcodes::k8XY5:
+  case Opcodes::k8XY6:
+  case Opcodes::k8XY7:
+  case Opcodes::k8XYE:
+    return !needsFlag(opcode);
+
+  default:
+    return false;
+  }
+}
+
+template <typename... Values>
+std::string format(const char *pattern, Values... values) {
+  const auto size = std::snprintf(nullptr, 0, pattern, values...);
+  std::string text(static_cast<size_t>(size) + 1, '\0');
+  std::snprintf(text.data(), text.size(), pattern, values...);
+  text.resize(static_cast<size_t>(size));
+  return text;
+}
+} // namespace
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Opcodes.h"
+#include "RomAnalysis.h"
+#include "RomSet.h"
+
+// Static analysis of ROMs: their control-flow graph from 0x200, the opcodes
+// they can reach, the variant those need, BNNN jumps and writes over code
+//
+// By default, prints one line per ROM, analyzed in parallel, then the use of
+// each opcode class across the corpus. With -d, prints the disassembly of
+// each ROM instead, block by block.
+//
+// Usage: chip8_analyze [-d] [-j threads] <ROMs, directories or packs>...
+
+namespace {
+// Local types
+struct Options {
+  std::vector<std::string> paths;
+  bool disassemble = false;
+  unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+struct Result {
+  // Empty if the ROM was analyzed
+  std::string error;
+  RomAnalysis analysis;
+};
+
+// Constants
+constexpr uint16_t kStart = 0x200;
+
+// Functions
+Options parseArguments(int argc, char **argv);
+void printReport(const std::vector<RomSet::Rom> &roms,
+                 const std::vector<Result> &results);
+void printDisassembly(const RomSet::Rom &rom, const RomAnalysis &analysis);
+uint16_t readOpcode(const RomSet::Rom &rom, size_t address);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+    const RomSet romSet(options.paths);
+    const auto &roms = romSet.GetRoms();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Result> results(roms.size());
+    std::atomic<size_t> next = 0;
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < options.threads; i++) {
+      threads.emplace_back([&] {
+        for (auto index = next++; index < roms.size(); index = next++) {
+          try {
+            results[index].analysis =
+                RomAnalysis::Analyze(roms[index].data, roms[index].size);
+          } catch (const std::exception &e) {
+            results[index].error = e.what();
+          }
+        }
+      });
+    }
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    size_t failures = 0;
+    for (size_t i = 0; i < roms.size(); i++) {
+      if (!results[i].error.empty()) {
+        std::printf("ERROR %s: %s\n", roms[i].name.c_str(),
+                    results[i].error.c_str());
+        failures++;
+      } else if (options.disassemble) {
+        printDisassembly(roms[i], results[i].analysis);
+      }
+    }
+
+    if (!options.disassemble) {
+      printReport(roms, results);
+      std::printf("%zu ROMs, %zu failed, %u threads, %.3f s\n", roms.size(),
+                  failures, options.threads, seconds);
+    }
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-d") {
+      options.disassemble = true;
+    } else if (argument == "-j") {
+      options.threads = std::max(static_cast<unsigned int>(std::stoul(next())),
+                                 1u);
+    } else {
+      options.paths.push_back(argument);
+    }
+  }
+
+  if (options.paths.empty()) {
+    throw std::runtime_error("Usage: chip8_analyze [-d] [-j threads] <ROMs, "
+                             "directories or packs>...");
+  }
+
+  return options;
+}
+
+void printReport(const std::vector<RomSet::Rom> &roms,
+                 const std::vector<Result> &results) {
+  std::printf("%-32s %6s %6s %5s %5s %5s %7s  %s\n", "ROM", "instrs",
+              "blocks", "BNNN", "self", "anyI", "invalid", "variant");
+
+  std::array<uint64_t, Opcodes::kClassCount> counts = {};
+  std::array<size_t, Opcodes::kClassCount> romCounts = {};
+  for (size_t i = 0; i < roms.size(); i++) {
+    if (!results[i].error.empty()) {
+      continue;
+    }
+
+    const auto &analysis = results[i].analysis;
+    std::printf("%-32s %6zu %6zu %5zu %5zu %5zu %7zu  %s\n",
+                roms[i].name.c_str(), analysis.instructions.count(),
+                analysis.blocks.size(), analysis.indirectJumps.size(),
+                analysis.selfModifyingWrites.size(), analysis.unknownWrites,
+                analysis.invalidOpcodes.size(),
+                Analysis::GetVariantName(analysis.variant));
+
+    for (size_t j = 0; j < Opcodes::kClassCount; j++) {
+      counts[j] += analysis.classCounts[j];
+      romCounts[j] += (analysis.classCounts[j] != 0) ? 1 : 0;
+    }
+  }
+
+  // Opcodes of later variants are counted in the class they decode to here
+  std::printf("\n%-8s %10s %6s\n", "class", "reached", "ROMs");
+  for (size_t i = 0; i < Opcodes::kClassCount; i++) {
+    std::printf("%-8s %10llu %6zu\n",
+                Opcodes::GetName(static_cast<Opcodes::Class>(i)),
+                static_cast<unsigned long long>(counts[i]), romCounts[i]);
+  }
+
+  std::printf("\n");
+}
+
+void printDisassembly(const RomSet::Rom &rom, const RomAnalysis &analysis) {
+  std::printf("%s: %zu instructions, %zu blocks, %s\n", rom.name.c_str(),
+              analysis.instructions.count(), analysis.blocks.size(),
+              Analysis::GetVariantName(analysis.variant));
+
+  for (const auto &block : analysis.blocks) {
+    std::printf("\n%03X-%03X ->", block.start, block.end);
+    for (const auto successor : block.successors) {
+      std::printf(" %03X", successor);
+    }
+
+    std::printf("%s\n", block.successors.empty() ? " (none)" : "");
+
+    for (size_t address = block.start; address < block.end;) {
+      const auto opcode = readOpcode(rom, address);
+      const auto variant = Analysis::GetVariant(opcode);
+
+      // XO-CHIP's F000 NNNN takes its address from the next word
+      auto text = Opcodes::Disassemble(opcode);
+      if (opcode == 0xF000) {
+        std::array<char, 16> operand;
+        std::snprintf(operand.data(), operand.size(), "LD I, %04X",
+                      readOpcode(rom, address + 2));
+        text = operand.data();
+      }
+
+      if (variant == Analysis::kChip8) {
+        std::printf("  %03zX  %04X  %s\n", address, opcode, text.c_str());
+      } else {
+        std::printf("  %03zX  %04X  %-16s; %s\n", address, opcode,
+                    text.c_str(), Analysis::GetVariantName(variant));
+      }
+
+      address += Analysis::GetSize(opcode);
+    }
+  }
+
+  for (const auto &write : analysis.selfModifyingWrites) {
+    std::printf("\nself-modifying write at %03X: %u bytes at %03X",
+                write.address, write.size, write.target);
+  }
+
+  std::printf("\n\n");
+}
+
+uint16_t readOpcode(const RomSet::Rom &rom, size_t address) {
+  const auto offset = address - kStart;
+  const auto high = (offset < rom.size) ? rom.data[offset] : 0;
+  const auto low = (offset + 1 < rom.size) ? rom.data[offset + 1] : 0;
+  return static_cast<uint16_t>((high << 8) | low);
+}
+} // namespace
@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "RomPack.h"
+#include "RomSet.h"
+
+// Builds a ROM pack from ROM files, directories and other packs, or lists the
+// entries of a pack and verifies their hashes
+
+namespace {
+// Local types
+struct Options {
+  bool list = false;
+  uint32_t quirks = Pack::kQuirksDefault;
+  std::string packPath;
+  std::vector<std::string> romPaths;
+};
+
+// Functions
+Options parseArguments(int argc, char **argv);
+void pack(const Options &options);
+size_t list(const Options &options);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+
+    if (options.list) {
+      return (list(options) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    pack(options);
+    return EXIT_SUCCESS;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-l") {
+      options.list = true;
+    } else if (argument == "-q") {
+      options.quirks = static_cast<uint32_t>(std::stoul(next(), nullptr, 0));
+    } else if (options.packPath.empty()) {
+      options.packPath = argument;
+    } else {
+      options.romPaths.push_back(argument);
+    }
+  }
+
+  if (options.packPath.empty() || (!options.list && options.romPaths.empty())) {
+    throw std::runtime_error(
+        "Usage: chip8_pack [-q quirks] <output.c8pack> <ROM, directory or "
+        "pack>...\n"
+        "       chip8_pack -l <pack.c8pack>");
+  }
+
+  return options;
+}
+
+void pack(const Options &options) {
+  const RomSet romSet(options.romPaths);
+
+  std::vector<RomPack::Image> images;
+  size_t size = 0;
+  for (const auto &rom : romSet.GetRoms()) {
+    images.push_back(
+        {std::filesystem::path(rom.name).filename().string(),
+         std::vector<uint8_t>(rom.data, rom.data + rom.size), options.quirks});
+    size += rom.size;
+  }
+
+  RomPack::Write(options.packPath, images);
+  std::printf("%zu ROMs, %zu bytes\n", images.size(), size);
+}
+
+size_t list(const Options &options) {
+  const RomPack pack(options.packPath);
+
+  size_t corrupted = 0;
+  for (size_t i = 0; i < pack.GetCount(); i++) {
+    const auto &entry = pack.GetEntry(i);
+    const bool valid = pack.Verify(i);
+    corrupted += valid ? 0 : 1;
+
+    std::printf("%-40s %6u bytes  %016llX  quirks %X%s\n",
+                pack.GetName(i).c_str(), entry.size,
+                static_cast<unsigned long long>(entry.hash), entry.quirks,
+                valid ? "" : "  CORRUPTED");
+  }
+
+  return corrupted;
+}
+} // namespace
@@ -0,0 +1,78 @@
+#ifndef ROM_SET_H_INCLUDED
+#define ROM_SET_H_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "RomPack.h"
+#include "Util.h"
+
+// The ROMs named on a command line: ROM files, directories of ROM files and
+// ROM packs (.c8pack)
+// Directories are expanded in name order, and text files in them (e.g. the
+// checksums written by chip8_gen) are skipped
+// Packs stay mapped, and their ROMs point into the mapping
+class RomSet {
+public:
+  struct Rom {
+    std::string name;
+    const uint8_t *data;
+    size_t size;
+    uint32_t quirks;
+  };
+
+public:
+  explicit RomSet(const std::vector<std::string> &paths) {
+    std::vector<std::string> files;
+
+    for (const auto &path : paths) {
+      if (std::filesystem::path(path).extension() == ".c8pack") {
+        this->packs.emplace_back(path);
+        continue;
+      }
+
+      if (!std::filesystem::is_directory(path)) {
+        files.push_back(path);
+        continue;
+      }
+
+      std::vector<std::string> directoryFiles;
+      for (const auto &entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file() && entry.path().extension() != ".txt") {
+          directoryFiles.push_back(entry.path().string());
+        }
+      }
+
+      std::sort(directoryFiles.begin(), directoryFiles.end());
+      files.insert(files.end(), directoryFiles.begin(), directoryFiles.end());
+    }
+
+    // Collect the pointers once nothing is added anymore
+    for (const auto &file : files) {
+      this->images.push_back(Util::FileReadBinary(file));
+      this->roms.push_back({file, this->images.back().data(),
+                            this->images.back().size(),
+                            Pack::kQuirksDefault});
+    }
+
+    for (const auto &pack : this->packs) {
+      for (size_t i = 0; i < pack.GetCount(); i++) {
+        const auto &entry = pack.GetEntry(i);
+        this->roms.push_back(
+            {pack.GetName(i), pack.GetData(i), entry.size, entry.quirks});
+      }
+    }
+  }
+
+  [[nodiscard]] const std::vector<Rom> &GetRoms() const { return this->roms; }
+
+private:
+  std::vector<RomPack> packs;
+  std::vector<std::vector<uint8_t>> images;
+  std::vector<Rom> roms;
+};
+
+#endif // ROM_SET_H_INCLUDED
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Opcodes.h"
+#include "TraceRecorder.h"
+
+// Prints a trace written by TraceRecorder (chip8 -t) in human-readable form
+
+namespace {
+// Functions
+void dumpChunk(const Trace::ChunkHeader &chunk, const uint8_t *records);
+uint16_t readUint16(const uint8_t *&in);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    if (argc != 2) {
+      throw std::runtime_error("Usage: chip8_trace <trace file>");
+    }
+
+    const auto file = MappedFile::OpenReadOnly(argv[1]);
+
+    Trace::FileHeader header;
+    if (file.GetSize() < Trace::kFileHeaderSize) {
+      throw std::runtime_error("Not a trace file.");
+    }
+
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (header.magic != Trace::kMagic ||
+        header.chunkSize < sizeof(Trace::ChunkHeader) ||
+        file.GetSize() < Trace::kFileHeaderSize +
+                             static_cast<size_t>(header.chunkSize) *
+                                 header.chunkCount) {
+      throw std::runtime_error("Not a trace file.");
+    }
+
+    // The ring may have wrapped; decode the chunks from oldest to newest
+    std::vector<Trace::ChunkHeader> chunks;
+    std::vector<const uint8_t *> records;
+
+    for (uint32_t i = 0; i < header.chunkCount; i++) {
+      const auto data = file.GetData() + Trace::kFileHeaderSize +
+                        static_cast<size_t>(i) * header.chunkSize;
+
+      Trace::ChunkHeader chunk;
+      std::memcpy(&chunk, data, sizeof(chunk));
+      if (chunk.sequence != 0 &&
+          chunk.used <= header.chunkSize - sizeof(chunk)) {
+        chunks.push_back(chunk);
+        records.push_back(data + sizeof(chunk));
+      }
+    }
+
+    std::vector<size_t> order(chunks.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return chunks[a].sequence < chunks[b].sequence;
+    });
+
+    for (const auto index : order) {
+      dumpChunk(chunks[index], records[index]);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+namespace {
+void dumpChunk(const Trace::ChunkHeader &chunk, const uint8_t *records) {
+  uint16_t PC = chunk.PC;
+  uint16_t I = chunk.I;
+  auto V = chunk.V;
+  uint64_t cycle = chunk.cycle;
+
+  const auto end = records + chunk.used;
+  auto in = records;
+
+  while (in < end) {
+    // A record cut off by the end of the chunk isn't decoded
+    const auto flags = in[0];
+    size_t size = 3;
+    size += (flags & Trace::kExplicitPC) ? 2 : 0;
+    size += (flags & Trace::kChangedI) ? 2 : 0;
+    size += (flags & Trace::kChangedV) ? 2 : 0;
+    if (static_cast<size_t>(end - in) < size) {
+      break;
+    }
+
+    if (flags & Trace::kChangedV) {
+      auto maskIn = in + size - 2;
+      size += std::bitset<16>(readUint16(maskIn)).count();
+      if (static_cast<size_t>(end - in) < size) {
+        break;
+      }
+    }
+
+    in++;
+    const auto opcode = readUint16(in);
+
+    PC = (flags & Trace::kExplicitPC) ? readUint16(in)
+                                      : static_cast<uint16_t>(PC + 2);
+
+    std::printf("%10llu  %03X  %04X  %-4s",
+                static_cast<unsigned long long>(cycle), PC, opcode,
+                Opcodes::GetName(Opcodes::Classify(opcode)));
+
+    if (flags & Trace::kChangedI) {
+      I = readUint16(in);
+      std::printf("  I=%03X", I);
+    }
+
+    if (flags & Trace::kChangedV) {
+      const auto mask = readUint16(in);
+      for (int i = 0; i < 16; i++) {
+        if (mask & (1 << i)) {
+          V[i] = *in++;
+          std::printf("  V%X=%02X", i, V[i]);
+        }
+      }
+    }
+
+    std::printf("\n");
+    ++cycle;
+  }
+}
+
+uint16_t readUint16(const uint8_t *&in) {
+  const auto value = static_cast<uint16_t>(in[0] | (in[1] << 8));
+  in += 2;
+  return value;
+}
+} // namespace
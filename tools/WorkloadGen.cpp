@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Chip8.h"
+#include "CpuBackend.h"
+#include "Util.h"
+
+// Generates CHIP-8 programs with a controlled instruction mix for the
+// benchmarks and the differential runner
+// Every program halts, and the checksum of the state it halts in is written
+// along with it so that any backend can be checked against it
+
+namespace {
+// Local types
+struct Options {
+  std::string outputPath;
+  std::string checkPath;
+  std::string backend = "interpreter";
+  uint32_t seed = 1;
+  size_t bodyLength = 128;
+  uint8_t outerIterations = 16;
+};
+
+// Builds a ROM image, instruction by instruction
+class Assembler {
+public:
+  explicit Assembler(uint32_t seed) : random(seed | 1) {}
+
+  uint16_t Emit(uint16_t opcode) {
+    const auto address = this->address;
+    this->Patch(address, opcode);
+    this->address += 2;
+    return address;
+  }
+
+  void Patch(uint16_t address, uint16_t opcode) {
+    this->EmitByte(address, static_cast<uint8_t>(opcode >> 8));
+    this->EmitByte(address + 1, static_cast<uint8_t>(opcode & 0xFF));
+  }
+
+  void EmitByte(uint16_t address, uint8_t value) {
+    if (address < 0x200 || address >= 0x1000) {
+      throw std::runtime_error("The program doesn't fit in memory.");
+    }
+
+    if (address - 0x200U >= this->image.size()) {
+      this->image.resize(address - 0x200U + 1);
+    }
+
+    this->image[address - 0x200U] = value;
+  }
+
+  [[nodiscard]] uint16_t GetAddress() const { return this->address; }
+  void SetAddress(uint16_t address) { this->address = address; }
+
+  // Uniform in [0, limit)
+  uint16_t Random(uint16_t limit) {
+    this->random ^= this->random << 13;
+    this->random ^= this->random >> 17;
+    this->random ^= this->random << 5;
+    return static_cast<uint16_t>(this->random % limit);
+  }
+
+  [[nodiscard]] const std::vector<uint8_t> &GetImage() const {
+    return this->image;
+  }
+
+private:
+  std::vector<uint8_t> image;
+  uint16_t address = 0x200;
+  uint32_t random;
+};
+
+struct Workload {
+  const char *name;
+
+  // Emits one instruction (or a short group) of the loop body
+  std::function<void(Assembler &)> emitBody;
+
+  // Emits the subroutines and data the body refers to at their fixed
+  // addresses, and the instructions that run before the loop
+  std::function<void(Assembler &)> emitSetup;
+};
+
+// Constants
+// V0-VC are free for the bodies; VD and VE count the loop iterations and VF
+// holds the flags
+constexpr uint16_t kBodyRegisters = 13;
+
+// Memory layout: the loop starts at 0x200, the subroutines and sprites come
+// after it, and the scratch memory is outside of the ROM image
+constexpr uint16_t kSubroutineAddress = 0xA00;
+constexpr uint16_t kSubroutineCount = 8;
+constexpr uint16_t kSpriteAddress = 0xB00;
+constexpr uint16_t kSpriteSize = 32;
+constexpr uint16_t kScratchAddress = 0xC00;
+
+// The checksums are taken at this rate and seed
+constexpr uint16_t kCpuRate = 500;
+constexpr uint32_t kRandomSeed = 1;
+
+// A program that doesn't halt after this many instructions is broken
+constexpr uint64_t kMaxInstructions = 100000000;
+
+constexpr const char *kChecksumFile = "checksums.txt";
+
+// Functions
+Options parseArguments(int argc, char **argv);
+std::vector<Workload> createWorkloads();
+std::vector<uint8_t> generate(const Options &options,
+                              const Workload &workload);
+uint64_t runToHalt(const std::string &backend,
+                   const std::vector<uint8_t> &image, uint64_t &instructions);
+void write(const Options &options);
+size_t check(const Options &options);
+
+uint16_t randomRegister(Assembler &assembler);
+void emitAlu(Assembler &assembler);
+void emitSprites(Assembler &assembler);
+void emitSubroutines(Assembler &assembler);
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    const auto options = parseArguments(argc, argv);
+
+    if (!options.checkPath.empty()) {
+      return (check(options) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    write(options);
+    return EXIT_SUCCESS;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+namespace {
+Options parseArguments(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const auto next = [&]() -> std::string {
+      if ((i + 1) == argc) {
+        throw std::runtime_error("Missing argument after " + argument + ".");
+      }
+
+      return argv[++i];
+    };
+
+    if (argument == "-c") {
+      options.checkPath = next();
+    } else if (argument == "-b") {
+      options.backend = next();
+    } else if (argument == "-s") {
+      options.seed = static_cast<uint32_t>(std::stoul(next()));
+    } else if (argument == "-l") {
+      options.bodyLength = std::max<size_t>(std::stoul(next()), 1);
+    } else if (argument == "-n") {
+      options.outerIterations = static_cast<uint8_t>(
+          std::clamp(std::stoul(next()), 1ul, 255ul));
+    } else {
+      options.outputPath = argument;
+    }
+  }
+
+  if (options.outputPath.empty() && options.checkPath.empty()) {
+    throw std::runtime_error(
+        "Usage: chip8_gen [-s seed] [-l body length] [-n iterations / 256] "
+        "<output directory>\n"
+        "       chip8_gen -c <directory> [-b backend]");
+  }
+
+  return options;
+}
+
+std::vector<Workload> createWorkloads() {
+  const auto none = [](Assembler &) {};
+
+  return {
+      {"ALU", emitAlu, none},
+
+      {"DRAW",
+       [](Assembler &assembler) {
+         const auto choice = assembler.Random(20);
+         if (choice < 8) {
+           assembler.Emit(0xD000 | (randomRegister(assembler) << 8) |
+                          (randomRegister(assembler) << 4) |
+                          (1 + assembler.Random(15)));
+         } else if (choice < 12) {
+           assembler.Emit(0xA000 | (kSpriteAddress + assembler.Random(
+                                                         kSpriteSize - 15)));
+         } else if (choice < 17) {
+           assembler.Emit(0x7000 | (randomRegister(assembler) << 8) |
+                          assembler.Random(256));
+         } else if (choice < 19) {
+           assembler.Emit(0xF029 | (randomRegister(assembler) << 8));
+         } else {
+           assembler.Emit(0x00E0);
+         }
+       },
+       [](Assembler &assembler) {
+         emitSprites(assembler);
+         assembler.Emit(0xA000 | kSpriteAddress);
+       }},
+
+      {"CALL",
+       [](Assembler &assembler) {
+         if (assembler.Random(5) < 3) {
+           assembler.Emit(0x2000 |
+                          (kSubroutineAddress +
+                           assembler.Random(kSubroutineCount) * 0x20));
+         } else {
+           emitAlu(assembler);
+         }
+       },
+       emitSubroutines},
+
+      {"MEMORY",
+       [](Assembler &assembler) {
+         // I stays within the scratch memory, even after FX1E
+         assembler.Emit(0xA000 | (kScratchAddress + assembler.Random(0xF0)));
+         if (assembler.Random(4) == 0) {
+           assembler.Emit(0xF01E | (randomRegister(assembler) << 8));
+         }
+
+         constexpr std::array<uint16_t, 3> operations = {0xF033, 0xF055,
+                                                         0xF065};
+         assembler.Emit(operations[assembler.Random(3)] |
+                        (randomRegister(assembler) << 8));
+       },
+       none},
+
+      {"SELFMOD",
+       [](Assembler &assembler) {
+         if (assembler.Random(2) == 0) {
+           emitAlu(assembler);
+           return;
+         }
+
+         // Rewrite the immediate of a 6XNN or 7XNN further down with V2,
+         // which changes on every pass
+         const auto target = 3 + assembler.Random(kBodyRegisters - 3);
+         const uint16_t opcode = (assembler.Random(2) == 0) ? 0x60 : 0x70;
+
+         const auto load = assembler.Emit(0xA000);
+         assembler.Emit(0x6000 | opcode | target);
+         assembler.Emit(0x8120);
+         assembler.Emit(0xF155);
+         assembler.Emit(0x7207);
+
+         for (auto i = assembler.Random(3); i > 0; i--) {
+           emitAlu(assembler);
+         }
+
+         const auto slot = assembler.Emit(((opcode | target) << 8));
+         assembler.Patch(load, 0xA000 | slot);
+       },
+       none},
+  };
+}
+
+std::vector<uint8_t> generate(const Options &options,
+                              const Workload &workload) {
+  Assembler assembler(options.seed);
+
+  workload.emitSetup(assembler);
+
+  // Loop: the body, 256 * outer iterations times
+  const auto loop = assembler.GetAddress();
+  for (size_t i = 0; i < options.bodyLength; i++) {
+    workload.emitBody(assembler);
+  }
+
+  // A skip at the end of the body must not skip the loop counter
+  emitAlu(assembler);
+
+  assembler.Emit(0x7E01);
+  assembler.Emit(0x3E00);
+  assembler.Emit(0x1000 | loop);
+  assembler.Emit(0x7D01);
+  assembler.Emit(0x3D00 | options.outerIterations);
+  assembler.Emit(0x1000 | loop);
+
+  // Halt
+  assembler.Emit(0x1000 | assembler.GetAddress());
+
+  if (assembler.GetAddress() > kSubroutineAddress) {
+    throw std::runtime_error("The body of " + std::string(workload.name) +
+                             " is too long.");
+  }
+
+  return assembler.GetImage();
+}
+
+uint64_t runToHalt(const std::string &backend,
+                   const std::vector<uint8_t> &image, uint64_t &instructions) {
+  Chip8 chip8;
+  chip8.SetCpuBackend(CpuBackends::Create(backend));
+  chip8.SetCpuRate(kCpuRate);
+  chip8.SetRandomSeed(kRandomSeed);
+  chip8.LoadRom(image.data(), image.size());
+
+  // The program halts in a jump to itself
+  const auto &state = chip8.GetState();
+  while (true) {
+    const auto pc = state.PC;
+    const auto opcode = state.memory.ReadWord(pc);
+    if (opcode == (0x1000 | pc)) {
+      break;
+    }
+
+    if (state.cycles >= kMaxInstructions) {
+      throw std::runtime_error("The program doesn't halt.");
+    }
+
+    chip8.RunCycles(1);
+  }
+
+  instructions = state.cycles;
+  return state.GetChecksum();
+}
+
+void write(const Options &options) {
+  std::filesystem::create_directories(options.outputPath);
+  const auto directory = std::filesystem::path(options.outputPath);
+
+  auto checksums = std::ofstream(directory / kChecksumFile);
+  if (!checksums) {
+    throw std::runtime_error("Could not open the file: " +
+                             (directory / kChecksumFile).string());
+  }
+
+  for (const auto &workload : createWorkloads()) {
+    const auto image = generate(options, workload);
+
+    const auto path = directory / workload.name;
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Could not open the file: " + path.string());
+    }
+
+    file.write(reinterpret_cast<const char *>(image.data()),
+               static_cast<std::streamsize>(image.size()));
+
+    // The reference interpreter defines the expected final state
+    uint64_t instructions = 0;
+    const auto checksum = runToHalt("interpreter", image, instructions);
+
+    std::array<char, 64> line;
+    std::snprintf(line.data(), line.size(), "%s %016llX %llu\n",
+                  workload.name, static_cast<unsigned long long>(checksum),
+                  static_cast<unsigned long long>(instructions));
+    checksums << line.data();
+    std::printf("%s", line.data());
+  }
+}
+
+size_t check(const Options &options) {
+  const auto directory = std::filesystem::path(options.checkPath);
+  auto checksums = std::ifstream(directory / kChecksumFile);
+  if (!checksums) {
+    throw std::runtime_error("Could not open the file: " +
+                             (directory / kChecksumFile).string());
+  }
+
+  size_t mismatches = 0;
+  std::string line;
+  while (std::getline(checksums, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    std::string expected;
+    uint64_t expectedInstructions = 0;
+    if (!(fields >> name >> expected >> expectedInstructions)) {
+      continue;
+    }
+
+    const auto image = Util::FileReadBinary((directory / name).string());
+
+    uint64_t instructions = 0;
+    const auto checksum = runToHalt(options.backend, image, instructions);
+    const bool matched = checksum == std::stoull(expected, nullptr, 16) &&
+                         instructions == expectedInstructions;
+    mismatches += matched ? 0 : 1;
+
+    std::printf("%-10s %016llX %10llu %s\n", name.c_str(),
+                static_cast<unsigned long long>(checksum),
+                static_cast<unsigned long long>(instructions),
+                matched ? "ok" : "MISMATCH");
+  }
+
+  return mismatches;
+}
+
+uint16_t randomRegister(Assembler &assembler) {
+  return assembler.Random(kBodyRegisters);
+}
+
+void emitAlu(Assembler &assembler) {
+  const auto x = randomRegister(assembler);
+  const auto y = randomRegister(assembler);
+  const auto choice = assembler.Random(20);
+
+  if (choice < 14) {
+    constexpr std::array<uint16_t, 9> operations = {0x0, 0x1, 0x2, 0x3, 0x4,
+                                                    0x5, 0x6, 0x7, 0xE};
+    assembler.Emit(0x8000 | (x << 8) | (y << 4) |
+                   operations[assembler.Random(9)]);
+  } else if (choice < 17) {
+    assembler.Emit(0x7000 | (x << 8) | assembler.Random(256));
+  } else if (choice < 19) {
+    // A skip, followed by an instruction that may be skipped
+    constexpr std::array<uint16_t, 4> skips = {0x3000, 0x4000, 0x5000,
+                                               0x9000};
+    const auto skip = skips[assembler.Random(4)];
+    if (skip == 0x3000 || skip == 0x4000) {
+      assembler.Emit(skip | (x << 8) | assembler.Random(256));
+    } else {
+      assembler.Emit(skip | (x << 8) | (y << 4));
+    }
+
+    assembler.Emit(0x7000 | (y << 8) | assembler.Random(256));
+  } else {
+    assembler.Emit(0x6000 | (x << 8) | assembler.Random(256));
+  }
+}
+
+void emitSprites(Assembler &assembler) {
+  for (uint16_t i = 0; i < kSpriteSize; i++) {
+    assembler.EmitByte(kSpriteAddress + i,
+                       static_cast<uint8_t>(assembler.Random(256)));
+  }
+}
+
+void emitSubroutines(Assembler &assembler) {
+  // A few ALU instructions each, and a call to a later subroutine, so that
+  // the nesting depth is bounded by the number of subroutines
+  const auto address = assembler.GetAddress();
+
+  for (uint16_t i = 0; i < kSubroutineCount; i++) {
+    assembler.SetAddress(kSubroutineAddress + i * 0x20);
+    for (auto count = 1 + assembler.Random(4); count > 0; count--) {
+      emitAlu(assembler);
+    }
+
+    if (i + 1 < kSubroutineCount && assembler.Random(2) == 0) {
+      assembler.Emit(0x2000 |
+                     (kSubroutineAddress +
+                      (i + 1 + assembler.Random(kSubroutineCount - i - 1)) *
+                          0x20));
+    }
+
+    assembler.Emit(0x00EE);
+  }
+
+  assembler.SetAddress(address);
+}
+} // namespace